@@ -855,6 +855,7 @@ static const uint16_t kPledgeDns[] = {
     __NR_linux_socket | INET,          //
     __NR_linux_bind,                   //
     __NR_linux_sendto,                 //
+    __NR_linux_sendmmsg,               //
     __NR_linux_connect,                //
     __NR_linux_recvfrom,               //
     __NR_linux_setsockopt | RESTRICT,  //
@@ -149,7 +149,8 @@
  * - "unix" allows socket(AF_UNIX), listen, bind, connect, accept,
  *   accept4, getpeername, getsockname, setsockopt, getsockopt.
  *
- * - "dns" allows socket(AF_INET), sendto, recvfrom, connect.
+ * - "dns" allows socket(AF_INET), sendto, sendmmsg, recvfrom,
+ *   connect.
  *
  * - "proc" allows fork, vfork, clone, kill, tgkill, getpriority,
  *   setpriority, prlimit, setrlimit, setpgid, setsid.
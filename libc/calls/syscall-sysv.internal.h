@@ -59,6 +59,9 @@ i32 sys_getresgid(u32 *, u32 *, u32 *);
 i32 sys_getresuid(u32 *, u32 *, u32 *);
 i32 sys_getsid(i32);
 i32 sys_gettid(void);
+i32 sys_io_uring_enter(i32, u32, u32, u32, const void *, u64);
+i32 sys_io_uring_register(i32, u32, const void *, u32);
+i32 sys_io_uring_setup(u32, void *);
 i32 sys_ioctl(i32, u64, ...);
 i32 sys_ioctl_cp(i32, u64, ...);
 i32 sys_issetugid(void);
@@ -25,6 +25,7 @@
 #include "libc/intrin/describeflags.h"
 #include "libc/intrin/strace.h"
 #include "libc/intrin/weaken.h"
+#include "libc/macros.h"
 #include "libc/runtime/internal.h"
 #include "libc/thread/lock.h"
 #include "libc/thread/thread.h"
@@ -47,22 +48,68 @@ static void pthread_mutex_lock_spin(atomic_int *word) {
   }
 }
 
+// upper bound on how long we'll spin for normal mutexes before parking
+#define PTHREAD_MUTEX_SPIN_MAX 1000
+
+// spins while the thread that owns the lock is expected to release it
+//
+// we only spin on one owner. if the lock changes hands to some other
+// thread before we get it, then it's contended by several waiters and
+// we park, since spinning through a queue of owners just burns a cpu.
+// the kernel doesn't offer a cheap way to ask if the owner is on a cpu
+// so it's considered descheduled once it's held the lock for longer
+// than our budget, which is a moving average of how long it took to
+// acquire the lock by spinning. it's stored in the otherwise unused
+// `_spins` field of the mutex, so it adapts to each lock's hold time
+static bool pthread_mutex_lock_adaptive(pthread_mutex_t *mutex, int me) {
+  int lock, owner, count, limit, spins;
+  owner =
+      MUTEX_OWNER(atomic_load_explicit(&mutex->_word, memory_order_relaxed));
+  if (owner == me)
+    return false;  // we'd just be spinning on our own deadlock
+  spins = atomic_load_explicit(&mutex->_spins, memory_order_relaxed);
+  limit = MIN(spins * 2 + 10, PTHREAD_MUTEX_SPIN_MAX);
+  for (count = 0; count < limit; ++count) {
+    pthread_pause_np();
+    lock = atomic_load_explicit(&mutex->_futex, memory_order_relaxed);
+    if (!lock && atomic_compare_exchange_weak_explicit(
+                     &mutex->_futex, &lock, 1, memory_order_acquire,
+                     memory_order_relaxed)) {
+      atomic_store_explicit(&mutex->_spins, spins + (count - spins) / 8,
+                            memory_order_relaxed);
+      return true;
+    }
+    if (MUTEX_OWNER(atomic_load_explicit(&mutex->_word,
+                                         memory_order_relaxed)) != owner)
+      return false;  // lock changed hands to another waiter
+  }
+  atomic_store_explicit(&mutex->_spins, spins + (limit - spins) / 8,
+                        memory_order_relaxed);
+  return false;
+}
+
 // see "take 3" algorithm in "futexes are tricky" by ulrich drepper
-// slightly improved to attempt acquiring multiple times b4 syscall
-static void pthread_mutex_lock_drepper(atomic_int *futex, char pshare) {
-  int word = 0;
-  if (atomic_compare_exchange_strong_explicit(
-          futex, &word, 1, memory_order_acquire, memory_order_acquire))
-    return;
-  LOCKTRACE("acquiring pthread_mutex_lock_drepper(%t)...", futex);
-  if (word == 1)
-    word = atomic_exchange_explicit(futex, 2, memory_order_acquire);
-  BLOCK_CANCELATION;
-  while (word > 0) {
-    _weaken(nsync_futex_wait_)(futex, 2, pshare, 0, 0);
-    word = atomic_exchange_explicit(futex, 2, memory_order_acquire);
+// improved to spin adaptively before making the futex wait syscall
+static void pthread_mutex_lock_drepper(pthread_mutex_t *mutex,
+                                       uint64_t word) {
+  int lock = 0;
+  int me = gettid();
+  if (!atomic_compare_exchange_strong_explicit(&mutex->_futex, &lock, 1,
+                                               memory_order_acquire,
+                                               memory_order_acquire) &&
+      !pthread_mutex_lock_adaptive(mutex, me)) {
+    LOCKTRACE("acquiring pthread_mutex_lock_drepper(%t)...", mutex);
+    lock = atomic_exchange_explicit(&mutex->_futex, 2, memory_order_acquire);
+    BLOCK_CANCELATION;
+    while (lock > 0) {
+      _weaken(nsync_futex_wait_)(&mutex->_futex, 2, MUTEX_PSHARED(word), 0,
+                                 0);
+      lock = atomic_exchange_explicit(&mutex->_futex, 2, memory_order_acquire);
+    }
+    ALLOW_CANCELATION;
   }
-  ALLOW_CANCELATION;
+  atomic_store_explicit(&mutex->_word, MUTEX_SET_OWNER(word, me),
+                        memory_order_relaxed);
 }
 
 static errno_t pthread_mutex_lock_recursive(pthread_mutex_t *mutex,
@@ -165,7 +212,7 @@ static errno_t pthread_mutex_lock_impl(pthread_mutex_t *mutex) {
   // handle normal mutexes
   if (MUTEX_TYPE(word) == PTHREAD_MUTEX_NORMAL) {
     if (_weaken(nsync_futex_wait_)) {
-      pthread_mutex_lock_drepper(&mutex->_futex, MUTEX_PSHARED(word));
+      pthread_mutex_lock_drepper(mutex, word);
     } else {
       pthread_mutex_lock_spin(&mutex->_futex);
     }
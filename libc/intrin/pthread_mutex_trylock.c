@@ -33,11 +33,16 @@ static errno_t pthread_mutex_trylock_spin(atomic_int *word) {
   return EBUSY;
 }
 
-static errno_t pthread_mutex_trylock_drepper(atomic_int *futex) {
-  int word = 0;
-  if (atomic_compare_exchange_strong_explicit(
-          futex, &word, 1, memory_order_acquire, memory_order_acquire))
+static errno_t pthread_mutex_trylock_drepper(pthread_mutex_t *mutex,
+                                             uint64_t word) {
+  int lock = 0;
+  if (atomic_compare_exchange_strong_explicit(&mutex->_futex, &lock, 1,
+                                              memory_order_acquire,
+                                              memory_order_acquire)) {
+    atomic_store_explicit(&mutex->_word, MUTEX_SET_OWNER(word, gettid()),
+                          memory_order_relaxed);
     return 0;
+  }
   return EBUSY;
 }
 
@@ -144,7 +149,7 @@ errno_t pthread_mutex_trylock(pthread_mutex_t *mutex) {
   // handle normal mutexes
   if (MUTEX_TYPE(word) == PTHREAD_MUTEX_NORMAL) {
     if (_weaken(nsync_futex_wait_)) {
-      return pthread_mutex_trylock_drepper(&mutex->_futex);
+      return pthread_mutex_trylock_drepper(mutex, word);
     } else {
       return pthread_mutex_trylock_spin(&mutex->_futex);
     }
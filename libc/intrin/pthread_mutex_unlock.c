@@ -34,11 +34,14 @@ static void pthread_mutex_unlock_spin(atomic_int *word) {
 }
 
 // see "take 3" algorithm in "futexes are tricky" by ulrich drepper
-static void pthread_mutex_unlock_drepper(atomic_int *futex, char pshare) {
-  int word = atomic_fetch_sub_explicit(futex, 1, memory_order_release);
-  if (word == 2) {
-    atomic_store_explicit(futex, 0, memory_order_release);
-    _weaken(nsync_futex_wake_)(futex, 1, pshare);
+static void pthread_mutex_unlock_drepper(pthread_mutex_t *mutex,
+                                         uint64_t word) {
+  int lock;
+  // the owner is left as is, since waiters only watch it for changes
+  lock = atomic_fetch_sub_explicit(&mutex->_futex, 1, memory_order_release);
+  if (lock == 2) {
+    atomic_store_explicit(&mutex->_futex, 0, memory_order_release);
+    _weaken(nsync_futex_wake_)(&mutex->_futex, 1, MUTEX_PSHARED(word));
   }
 }
 
@@ -138,7 +141,7 @@ errno_t pthread_mutex_unlock(pthread_mutex_t *mutex) {
   // implement barebones normal mutexes
   if (MUTEX_TYPE(word) == PTHREAD_MUTEX_NORMAL) {
     if (_weaken(nsync_futex_wake_)) {
-      pthread_mutex_unlock_drepper(&mutex->_futex, MUTEX_PSHARED(word));
+      pthread_mutex_unlock_drepper(mutex, word);
     } else {
       pthread_mutex_unlock_spin(&mutex->_futex);
     }
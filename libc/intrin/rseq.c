@@ -0,0 +1,69 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/intrin/rseq.h"
+#include "libc/dce.h"
+#include "libc/errno.h"
+#include "libc/intrin/strace.h"
+
+int sys_rseq(struct rseq *, uint32_t, int, uint32_t);
+
+/**
+ * Restartable sequences area of calling thread.
+ *
+ * The Linux kernel writes the current CPU number to this memory each
+ * time the thread is scheduled on a different processor, and rewinds
+ * critical sections referenced by `rseq_cs` when they get preempted.
+ */
+_Thread_local struct rseq __rseq = {
+    .cpu_id_start = 0,
+    .cpu_id = RSEQ_CPU_ID_UNINITIALIZED,
+};
+
+/**
+ * Indicates at least one thread in process has registered its area.
+ *
+ * Per-CPU data structures need to know this, because threads that fail
+ * to register (e.g. due to seccomp) must not perform non-atomic writes
+ * to memory which is being modified by restartable sequences.
+ */
+bool __rseq_ok;
+
+/**
+ * Registers restartable sequences area for calling thread.
+ *
+ * This is called automatically for the main thread at startup, and for
+ * each thread created by pthread_create(), so long as `__rseq` has been
+ * linked into the program, which malloc() always does. It's a no-op on platforms other than
+ * Linux 4.18+ in which case __rseq_cpu() will return a negative number.
+ */
+void __rseq_register(void) {
+  int e;
+  if (!IsLinux())
+    return;
+  e = errno;
+  if (!sys_rseq(&__rseq, sizeof(__rseq), 0, RSEQ_SIG)) {
+    __rseq_ok = true;
+  } else if (errno == EBUSY) {
+    errno = e;  // this thread was already registered
+  } else {
+    STRACE("rseq() failed %m");
+    __rseq.cpu_id = RSEQ_CPU_ID_REGISTRATION_FAILED;
+    errno = e;
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef COSMOPOLITAN_LIBC_INTRIN_RSEQ_H_
+#define COSMOPOLITAN_LIBC_INTRIN_RSEQ_H_
+
+#ifdef __x86_64__
+#define RSEQ_SIG 0x53053053
+#elif defined(__aarch64__)
+#define RSEQ_SIG 0xd428bc00 /* brk #0x45e0 */
+#endif
+
+#define RSEQ_CPU_ID_UNINITIALIZED       -1
+#define RSEQ_CPU_ID_REGISTRATION_FAILED -2
+
+#if !(__ASSEMBLER__ + __LINKER__ + 0)
+COSMOPOLITAN_C_START_
+
+/* linux restartable sequences thread area (32 bytes) */
+struct rseq {
+  uint32_t cpu_id_start; /* 0x00 */
+  uint32_t cpu_id;       /* 0x04 kernel updates this on migration */
+  uint64_t rseq_cs;      /* 0x08 points to active critical section */
+  uint32_t flags;        /* 0x10 */
+  uint32_t node_id;      /* 0x14 linux 6.3+ */
+  uint32_t mm_cid;       /* 0x18 linux 6.3+ */
+  uint32_t __pad;        /* 0x1c */
+} __attribute__((__aligned__(32)));
+
+extern _Thread_local struct rseq __rseq;
+extern bool __rseq_ok;
+
+void __rseq_register(void) libcesque;
+int __rseq_addv(struct rseq *, long *, long, int) libcesque;
+
+/**
+ * Returns CPU on which calling thread is running.
+ *
+ * This is a single load from thread local storage that the Linux kernel
+ * keeps up to date whenever it migrates this thread to a different CPU.
+ * The result is only a hint unless it's validated inside a restartable
+ * sequence, e.g. using __rseq_addv().
+ *
+ * @return cpu number, or negative if this thread isn't registered
+ */
+forceinline int __rseq_cpu(void) {
+  return (int)__atomic_load_n(&__rseq.cpu_id, __ATOMIC_RELAXED);
+}
+
+COSMOPOLITAN_C_END_
+#endif /* !(__ASSEMBLER__ + __LINKER__ + 0) */
+#endif /* COSMOPOLITAN_LIBC_INTRIN_RSEQ_H_ */
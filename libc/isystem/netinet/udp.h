@@ -1,4 +1,5 @@
 #ifndef COSMOPOLITAN_LIBC_ISYSTEM_NETINET_UDP_H_
 #define COSMOPOLITAN_LIBC_ISYSTEM_NETINET_UDP_H_
 #include "libc/sysv/consts/sol.h"
+#include "libc/sysv/consts/udp.h"
 #endif /* COSMOPOLITAN_LIBC_ISYSTEM_NETINET_UDP_H_ */
@@ -4,6 +4,7 @@
 #include "libc/sock/sock.h"
 #include "libc/sock/struct/cmsghdr.h"
 #include "libc/sock/struct/linger.h"
+#include "libc/sock/struct/mmsghdr.h"
 #include "libc/sock/struct/msghdr.h"
 #include "libc/sock/struct/sockaddr.h"
 #include "libc/sysv/consts/af.h"
@@ -23,3 +23,12 @@ char __tls_enabled;
 #endif
 
 unsigned __tls_index;
+
+/**
+ * Becomes true once the process has created a thread.
+ *
+ * This is set by clone() before the first thread sharing our memory is
+ * created, and never goes back to false, so that code like stdio may
+ * skip locking while the process is still single-threaded.
+ */
+bool __isthreaded;
@@ -746,6 +746,9 @@ errno_t clone(void *func, void *stk, size_t stksz, int flags, void *arg,
               void *ptid, void *tls, void *ctid) {
   int rc;
 
+  if (flags & CLONE_VM)
+    __isthreaded = true;
+
   if (!func) {
     rc = EINVAL;
   } else if (IsLinux()) {
@@ -25,6 +25,7 @@
 #include "libc/intrin/getenv.h"
 #include "libc/intrin/kprintf.h"
 #include "libc/intrin/maps.h"
+#include "libc/intrin/rseq.h"
 #include "libc/intrin/weaken.h"
 #include "libc/macros.h"
 #include "libc/nt/files.h"
@@ -264,4 +265,9 @@ textstartup void __enable_tls(void) {
 
   // we are now allowed to use tls
   __tls_enabled_set(true);
+
+  // tell linux where to publish our cpu number, if anything reads it,
+  // e.g. malloc() picking its arena or the per-cpu counter apis
+  if (_weaken(__rseq_register))
+    _weaken(__rseq_register)();
 }
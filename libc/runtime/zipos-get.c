@@ -120,6 +120,7 @@ static void __zipos_init(void) {
         if (!progpath)
           progpath = GetProgramExecutableName();
         fd = open(progpath, O_RDONLY);
+        __zipos.path = progpath;  // so mmap() can reopen aligned assets
       }
       if (fd != -1) {
         if (!fstat(fd, &st) && (map = mmap(0, st.st_size, PROT_READ, MAP_SHARED,
@@ -130,6 +131,7 @@ static void __zipos_init(void) {
             __zipos.map = map;
             __zipos.cdir = cdir;
             __zipos.dev = st.st_ino;
+            __zipos.pathdev = st.st_dev;
             __zipos.pagesz = pagesz;
             __zipos_generate_index(&__zipos);
             msg = kZipOk;
@@ -18,14 +18,18 @@
 ╚─────────────────────────────────────────────────────────────────────────────*/
 #include "libc/calls/calls.h"
 #include "libc/calls/struct/iovec.h"
+#include "libc/calls/struct/stat.h"
 #include "libc/dce.h"
 #include "libc/errno.h"
 #include "libc/intrin/maps.h"
 #include "libc/intrin/strace.h"
+#include "libc/macros.h"
 #include "libc/runtime/internal.h"
 #include "libc/runtime/runtime.h"
 #include "libc/runtime/zipos.internal.h"
+#include "libc/str/str.h"
 #include "libc/sysv/consts/map.h"
+#include "libc/sysv/consts/o.h"
 #include "libc/sysv/consts/prot.h"
 #include "libc/sysv/consts/s.h"
 #include "libc/sysv/errfuns.h"
@@ -34,6 +38,63 @@
 #define IP(X)  (intptr_t)(X)
 #define VIP(X) (void *)IP(X)
 
+// maps stored asset straight out of the executable when its content is
+// suitably aligned (see zipcopy -a) so every process that maps it will
+// share the page cache rather than getting its own copy. only granules
+// lying wholly within the asset are mapped from the file, since pages
+// past that would expose the zip records which follow it, or fault if
+// they're past the end of the executable. the remainder of a private
+// mapping is anonymous memory that the rest of the asset is copied to.
+// returns null if the asset isn't eligible, so it should be copied.
+static void *__zipos_mmap_file(void *addr, size_t size, int prot, int flags,
+                               struct ZiposHandle *h, int64_t off) {
+  int fd, e;
+  char *res;
+  struct stat st;
+  size_t have, mapped, fileoff;
+  struct Zipos *zipos = h->zipos;
+  if (h->blob || !zipos->path || off >= h->size)
+    return 0;
+  if (h->mem < zipos->map)
+    return 0;
+  fileoff = (h->mem - zipos->map) + off;
+  if (fileoff & (__gransize - 1))
+    return 0;
+  have = h->size - off;
+  if (!(mapped = ROUNDDOWN(have, __gransize)))
+    return 0;
+  if (size > mapped && (flags & MAP_SHARED))
+    return 0;  // can't hide the zip records which follow the asset
+  if ((fd = open(zipos->path, O_RDONLY | O_CLOEXEC)) == -1)
+    return 0;
+  if (fstat(fd, &st) || st.st_ino != zipos->dev ||
+      st.st_dev != zipos->pathdev) {
+    close(fd);
+    return 0;  // executable was replaced since we loaded it
+  }
+  flags &= MAP_FIXED | MAP_FIXED_NOREPLACE | MAP_SHARED;
+  if (!(flags & MAP_SHARED))
+    flags |= MAP_PRIVATE;
+  res = mmap(addr, size, prot, flags, fd, fileoff);
+  e = errno;
+  close(fd);
+  errno = e;
+  if (res != MAP_FAILED && size > mapped) {
+    if (mmap(res + mapped, size - mapped, prot | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+      goto Fail;
+    memcpy(res + mapped, h->mem + off + mapped, MIN(size, have) - mapped);
+    if (!(prot & PROT_WRITE) && mprotect(res + mapped, size - mapped, prot))
+      goto Fail;
+  }
+  return res;
+Fail:
+  e = errno;
+  munmap(res, size);
+  errno = e;
+  return MAP_FAILED;
+}
+
 /**
  * Map zipos file into memory. See mmap.
  *
@@ -41,10 +102,11 @@
  * @param size must be >0 and will be rounded up to granularity
  *     automatically.
  * @param prot can have PROT_READ/PROT_WRITE/PROT_EXEC/PROT_NONE/etc.
- * @param flags cannot have `MAP_SHARED` or `MAP_ANONYMOUS`, there is
- *     no actual file backing for zipos files. `MAP_SHARED` could be
- *     simulated for non-writable mappings, but that would require
- *     tracking zipos mappings to prevent making it PROT_WRITE.
+ * @param flags cannot have `MAP_ANONYMOUS`. `MAP_SHARED` is only allowed
+ *     for stored assets that were aligned when the zip was packed, in
+ *     which case the executable itself gets mapped, and only when the
+ *     mapping doesn't extend into the asset's final partial granule.
+ *     Other assets have no actual file backing, so they're copied.
  * @param h is a zip store object
  * @param off specifies absolute byte index of h's file for mapping,
  *     it does not need to be 64kb aligned.
@@ -63,7 +125,7 @@ void *__zipos_mmap(void *addr, size_t size, int prot, int flags,
     return VIP(eisdir());
   }
 
-  if (flags & (MAP_SHARED | MAP_ANONYMOUS)) {
+  if (flags & MAP_ANONYMOUS) {
     STRACE("ZipOS bad flags");
     return VIP(einval());
   }
@@ -73,6 +135,16 @@ void *__zipos_mmap(void *addr, size_t size, int prot, int flags,
     return VIP(einval());
   }
 
+  void *res;
+  if ((res = __zipos_mmap_file(addr, size, prot, flags, h, off))) {
+    return res;
+  }
+
+  if (flags & MAP_SHARED) {
+    STRACE("ZipOS can't share unaligned or compressed asset");
+    return VIP(einval());
+  }
+
   flags &= MAP_FIXED | MAP_FIXED_NOREPLACE;
   flags |= MAP_PRIVATE | MAP_ANONYMOUS;
 
@@ -38,6 +38,20 @@
 #include "libc/sysv/consts/s.h"
 #include "libc/sysv/errfuns.h"
 #include "libc/zip.h"
+#include "third_party/zstd/zstd.h"
+
+static struct ZiposCache {
+  size_t bytes;
+  uint64_t tick;
+  struct ZiposBlob *p[ZIPOS_CACHE_SLOTS];
+} __zipos_cache;
+
+static void __zipos_unref(struct ZiposBlob *b) {
+  if (atomic_fetch_sub_explicit(&b->refs, 1, memory_order_release) != 1)
+    return;
+  atomic_thread_fence(memory_order_acquire);
+  munmap(b, b->mapsize);
+}
 
 struct ZiposHandle *__zipos_keep(struct ZiposHandle *h) {
   atomic_fetch_add_explicit(&h->refs, 1, memory_order_relaxed);
@@ -48,6 +62,10 @@ void __zipos_drop(struct ZiposHandle *h) {
   if (atomic_fetch_sub_explicit(&h->refs, 1, memory_order_release))
     return;
   atomic_thread_fence(memory_order_acquire);
+  if (h->blob)
+    __zipos_unref(h->blob);
+  if (h->zran)
+    __zipos_zran_unref(h->zran);
   munmap((char *)h, h->mapsize);
 }
 
@@ -64,6 +82,114 @@ static struct ZiposHandle *__zipos_alloc(struct Zipos *zipos, size_t size) {
   return h;
 }
 
+// returns cached inflated content of central directory entry cf
+// must be called while holding __fds_lock()
+static struct ZiposBlob *__zipos_lookup(size_t cf) {
+  int i;
+  struct ZiposBlob *b;
+  for (i = 0; i < ZIPOS_CACHE_SLOTS; ++i) {
+    if ((b = __zipos_cache.p[i]) && b->cfile == cf) {
+      b->used = ++__zipos_cache.tick;
+      atomic_fetch_add_explicit(&b->refs, 1, memory_order_relaxed);
+      return b;
+    }
+  }
+  return 0;
+}
+
+// adds freshly inflated content to cache, evicting least recently used
+// entries until it fits in the budget. evicted entries are returned in
+// victims so they can be unmapped once the lock has been released. any
+// handles still using an evicted entry keep it alive.
+// must be called while holding __fds_lock()
+static int __zipos_insert(struct ZiposBlob *b,
+                          struct ZiposBlob *victims[ZIPOS_CACHE_SLOTS]) {
+  int i, j, n, slot;
+  struct ZiposBlob **p = __zipos_cache.p;
+  for (n = 0;;) {
+    for (slot = j = -1, i = 0; i < ZIPOS_CACHE_SLOTS; ++i) {
+      if (!p[i]) {
+        slot = i;
+      } else if (j == -1 || p[i]->used < p[j]->used) {
+        j = i;
+      }
+    }
+    if (slot != -1 && __zipos_cache.bytes + b->size <= ZIPOS_CACHE_BYTES)
+      break;
+    victims[n++] = p[j];
+    __zipos_cache.bytes -= p[j]->size;
+    p[j] = 0;
+  }
+  b->used = ++__zipos_cache.tick;
+  atomic_fetch_add_explicit(&b->refs, 1, memory_order_relaxed);
+  __zipos_cache.bytes += b->size;
+  p[slot] = b;
+  return n;
+}
+
+// decompresses zip local file content. zstd needs the program to link
+// ZSTD_decompress(), otherwise those assets fail to open with EIO.
+static int __zipos_decompress(void *out, size_t size, const uint8_t *lfile) {
+  size_t rc;
+  const void *in = ZIP_LFILE_CONTENT(lfile);
+  size_t insize = GetZipLfileCompressedSize(lfile);
+  if (ZIP_LFILE_COMPRESSIONMETHOD(lfile) != kZipCompressionZstd)
+    return __inflate(out, size, in, insize);
+  if (!_weaken(ZSTD_decompress) ||  //
+      !_weaken(ZSTD_isError) ||     //
+      __runlevel < RUNLEVEL_MALLOC)
+    return -1;
+  rc = _weaken(ZSTD_decompress)(out, size, in, insize);
+  return _weaken(ZSTD_isError)(rc) || rc != size ? -1 : 0;
+}
+
+// returns decompressed content of zip file, shared between every open()
+// of the same asset. the caller owns a reference to the result.
+static struct ZiposBlob *__zipos_inflate(struct Zipos *zipos, size_t cf,
+                                         size_t lf, size_t size) {
+  int i, n;
+  size_t mapsize;
+  struct ZiposBlob *b, *c;
+  struct ZiposBlob *victims[ZIPOS_CACHE_SLOTS];
+  bool cacheable = size <= ZIPOS_CACHE_BYTES / 4;
+  if (cacheable) {
+    __fds_lock();
+    b = __zipos_lookup(cf);
+    __fds_unlock();
+    if (b)
+      return b;
+  }
+  mapsize = sizeof(struct ZiposBlob) + size;
+  if ((b = mmap(0, mapsize, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+    return 0;
+  b->cfile = cf;
+  b->size = size;
+  b->mapsize = mapsize;
+  b->refs = 1;
+  if (__zipos_decompress(b->data, size, zipos->map + lf)) {
+    munmap(b, mapsize);
+    eio();
+    return 0;
+  }
+  if (cacheable) {
+    __fds_lock();
+    if ((c = __zipos_lookup(cf))) {
+      n = 0;  // another thread inflated it first
+    } else {
+      n = __zipos_insert(b, victims);
+    }
+    __fds_unlock();
+    for (i = 0; i < n; ++i)
+      __zipos_unref(victims[i]);
+    if (c) {
+      munmap(b, mapsize);
+      b = c;
+    }
+  }
+  return b;
+}
+
 static int __zipos_mkfd(int minfd) {
   int fd, e = errno;
   if ((fd = __sys_fcntl(2, F_DUPFD_CLOEXEC, minfd)) != -1) {
@@ -111,17 +237,30 @@ static int __zipos_load(struct Zipos *zipos, size_t cf, int flags,
           return -1;
         h->mem = ZIP_LFILE_CONTENT(zipos->map + lf);
         break;
-      case kZipCompressionDeflate:
-        if (!(h = __zipos_alloc(zipos, size)))
+      case kZipCompressionDeflate: {
+        struct ZiposZran *z;
+        if ((z = __zipos_zran_open(zipos, cf, lf, size))) {
+          if (!(h = __zipos_alloc(zipos, 0))) {
+            __zipos_zran_unref(z);
+            return -1;
+          }
+          h->zran = z;
+          break;
+        }
+      }
+        // fallthrough
+      case kZipCompressionZstd: {
+        struct ZiposBlob *b;
+        if (!(b = __zipos_inflate(zipos, cf, lf, size)))
+          return -1;
+        if (!(h = __zipos_alloc(zipos, 0))) {
+          __zipos_unref(b);
           return -1;
-        if (!__inflate(h->data, size, ZIP_LFILE_CONTENT(zipos->map + lf),
-                       GetZipLfileCompressedSize(zipos->map + lf))) {
-          h->mem = h->data;
-        } else {
-          h->mem = 0;
-          eio();
         }
+        h->blob = b;
+        h->mem = b->data;
         break;
+      }
       default:
         return eio();
     }
@@ -130,7 +269,7 @@ static int __zipos_load(struct Zipos *zipos, size_t cf, int flags,
   atomic_store_explicit(&h->pos, 0, memory_order_relaxed);
   h->cfile = cf;
   h->size = size;
-  if (h->mem) {
+  if (h->mem || h->zran) {
     minfd = 3;
     __fds_lock();
   TryAgain:
@@ -51,8 +51,20 @@ static ssize_t __zipos_read_impl(struct ZiposHandle *h, const struct iovec *iov,
   }
   for (i = 0; i < iovlen && y < h->size; ++i, y += b) {
     b = MIN(iov[i].iov_len, h->size - y);
-    if (b)
+    if (!b)
+      continue;
+    if (!h->zran) {
       memcpy(iov[i].iov_base, h->mem + y, b);
+    } else if (__zipos_zran_pread(h->zran, iov[i].iov_base, b, y) == -1) {
+      if (y == x)
+        y = -1;
+      break;
+    }
+  }
+  if (y == -1) {
+    if (opt_offset == -1)
+      atomic_store_explicit(&h->pos, x, memory_order_release);
+    return -1;
   }
   if (opt_offset == -1) {
     unassert(y != SIZE_MAX);
@@ -0,0 +1,318 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/calls/state.internal.h"
+#include "libc/calls/struct/sigset.internal.h"
+#include "libc/intrin/atomic.h"
+#include "libc/intrin/weaken.h"
+#include "libc/runtime/internal.h"
+#include "libc/runtime/runtime.h"
+#include "libc/runtime/zipos.internal.h"
+#include "libc/stdio/sysparam.h"
+#include "libc/str/str.h"
+#include "libc/sysv/errfuns.h"
+#include "libc/thread/thread.h"
+#include "libc/zip.h"
+#include "third_party/zlib/zlib.h"
+
+#define WINSIZE 32768
+
+// inflates large deflated assets lazily
+//
+// rather than inflating a whole member on open(), we remember where in
+// the compressed stream each ZIPOS_ZRAN_SPAN of output begins, along
+// with the 32kb of history a deflate decoder needs to resume there, as
+// described by Mark Adler's zran.c. the checkpoint index is only built
+// as far as reads have reached, so open() costs nothing and a pread()
+// near the start of a huge file only inflates what it needs. recently
+// read spans are kept in a small cache.
+
+struct ZiposPoint {
+  uint64_t out;   // offset in uncompressed output
+  uint64_t in;    // offset of first full byte in compressed input
+  int bits;       // unused bits from byte preceding `in`
+  uint8_t *window;
+};
+
+struct ZiposSpan {
+  uint64_t index;
+  uint64_t used;
+  size_t size;
+  uint8_t *data;
+};
+
+struct ZiposZran {
+  _Atomic(size_t) refs;
+  pthread_mutex_t lock;
+  size_t cfile;
+  size_t size;
+  size_t compsize;
+  const uint8_t *comp;
+  uint64_t used;
+  uint64_t tick;
+  size_t npoints;
+  size_t cappoints;
+  struct ZiposPoint *points;
+  z_stream zs;
+  uint8_t *win;
+  struct ZiposSpan spans[ZIPOS_ZRAN_SPANS];
+};
+
+static struct {
+  uint64_t tick;
+  struct ZiposZran *p[ZIPOS_ZRAN_SLOTS];
+} __zipos_zrans;
+
+static bool __zipos_zran_linked(void) {
+  return _weaken(inflateInit2) &&          //
+         _weaken(inflate) &&               //
+         _weaken(inflateEnd) &&            //
+         _weaken(inflateReset2) &&         //
+         _weaken(inflatePrime) &&          //
+         _weaken(inflateSetDictionary) &&  //
+         __runlevel >= RUNLEVEL_MALLOC;
+}
+
+static void __zipos_zran_free(struct ZiposZran *z) {
+  size_t i;
+  for (i = 0; i < z->npoints; ++i)
+    if (z->points[i].window)
+      munmap(z->points[i].window, WINSIZE);
+  for (i = 0; i < ZIPOS_ZRAN_SPANS; ++i)
+    if (z->spans[i].data)
+      munmap(z->spans[i].data, ZIPOS_ZRAN_SPAN);
+  if (z->points)
+    munmap(z->points, z->cappoints * sizeof(*z->points));
+  if (z->win)
+    munmap(z->win, WINSIZE);
+  _weaken(inflateEnd)(&z->zs);
+  pthread_mutex_destroy(&z->lock);
+  munmap(z, sizeof(*z));
+}
+
+void __zipos_zran_unref(struct ZiposZran *z) {
+  if (atomic_fetch_sub_explicit(&z->refs, 1, memory_order_release) != 1)
+    return;
+  atomic_thread_fence(memory_order_acquire);
+  __zipos_zran_free(z);
+}
+
+static struct ZiposZran *__zipos_zran_new(struct Zipos *zipos, size_t cf,
+                                          size_t lf, size_t size) {
+  struct ZiposZran *z;
+  if (!(z = _mapanon(sizeof(*z))))
+    return 0;
+  z->refs = 1;
+  z->cfile = cf;
+  z->size = size;
+  z->comp = ZIP_LFILE_CONTENT(zipos->map + lf);
+  z->compsize = GetZipLfileCompressedSize(zipos->map + lf);
+  pthread_mutex_init(&z->lock, 0);
+  if (_weaken(inflateInit2)(&z->zs, -MAX_WBITS) != Z_OK) {
+    pthread_mutex_destroy(&z->lock);
+    munmap(z, sizeof(*z));
+    return 0;
+  }
+  z->cappoints = __pagesize / sizeof(*z->points);
+  if (!(z->win = _mapanon(WINSIZE)) ||
+      !(z->points = _mapanon(z->cappoints * sizeof(*z->points)))) {
+    __zipos_zran_free(z);
+    return 0;
+  }
+  z->npoints = 1;  // start of stream needs no history
+  return z;
+}
+
+/**
+ * Returns lazy inflater for deflated zip asset.
+ *
+ * Indexes are shared between opens of the same asset, so checkpoints
+ * and inflated spans carry over. This returns null if the asset is too
+ * small to bother or zlib isn't linked, in which case the caller ought
+ * to inflate the whole thing.
+ */
+struct ZiposZran *__zipos_zran_open(struct Zipos *zipos, size_t cf, size_t lf,
+                                    size_t size) {
+  int i, j;
+  struct ZiposZran *z, *victim;
+  struct ZiposZran **p = __zipos_zrans.p;
+  if (size < ZIPOS_ZRAN_BYTES || !__zipos_zran_linked())
+    return 0;
+  victim = 0;
+  __fds_lock();
+  for (j = -1, i = 0; i < ZIPOS_ZRAN_SLOTS; ++i) {
+    if (p[i] && p[i]->cfile == cf) {
+      z = p[i];
+      z->used = ++__zipos_zrans.tick;
+      atomic_fetch_add_explicit(&z->refs, 1, memory_order_relaxed);
+      __fds_unlock();
+      return z;
+    }
+    if (j == -1 || !p[i] || (p[j] && p[i]->used < p[j]->used))
+      j = i;
+  }
+  if ((z = __zipos_zran_new(zipos, cf, lf, size))) {
+    victim = p[j];
+    z->used = ++__zipos_zrans.tick;
+    z->refs = 2;
+    p[j] = z;
+  }
+  __fds_unlock();
+  if (victim)
+    __zipos_zran_unref(victim);
+  return z;
+}
+
+static struct ZiposPoint *__zipos_zran_find(struct ZiposZran *z,
+                                            uint64_t off) {
+  size_t lo, hi, mid;
+  for (lo = 0, hi = z->npoints; hi - lo > 1;) {
+    mid = lo + (hi - lo) / 2;
+    if (z->points[mid].out <= off) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return z->points + lo;
+}
+
+static void __zipos_zran_checkpoint(struct ZiposZran *z, uint64_t out,
+                                    size_t winpos) {
+  size_t n;
+  struct ZiposPoint *p, *p2;
+  if (z->npoints == z->cappoints) {
+    n = z->cappoints * sizeof(*z->points);
+    if (!(p2 = _mapanon(n * 2)))
+      return;  // checkpoints are an optimization
+    memcpy(p2, z->points, n);
+    munmap(z->points, n);
+    z->points = p2;
+    z->cappoints *= 2;
+  }
+  p = z->points + z->npoints;
+  if (!(p->window = _mapanon(WINSIZE)))
+    return;
+  p->out = out;
+  p->in = z->zs.next_in - z->comp;
+  p->bits = z->zs.data_type & 7;
+  memcpy(p->window, z->win + winpos, WINSIZE - winpos);
+  memcpy(p->window + (WINSIZE - winpos), z->win, winpos);
+  ++z->npoints;
+}
+
+// inflates [start,start+size) into buf, resuming at nearest checkpoint
+// and adding new checkpoints whenever we pass the end of the index.
+static int __zipos_zran_extract(struct ZiposZran *z, uint64_t start,
+                                uint8_t *buf, size_t size) {
+  int rc;
+  size_t n, winpos;
+  uint64_t out, lo, hi, end;
+  struct ZiposPoint *p;
+  p = __zipos_zran_find(z, start);
+  if (_weaken(inflateReset2)(&z->zs, -MAX_WBITS) != Z_OK)
+    return -1;
+  z->zs.next_in = (uint8_t *)z->comp + p->in;
+  z->zs.avail_in = z->compsize - p->in;
+  if (p->bits)
+    _weaken(inflatePrime)(&z->zs, p->bits, z->comp[p->in - 1] >> (8 - p->bits));
+  if (p->out) {
+    _weaken(inflateSetDictionary)(&z->zs, p->window, WINSIZE);
+    memcpy(z->win, p->window, WINSIZE);
+  }
+  out = p->out;
+  end = start + size;
+  winpos = 0;
+  while (out < end) {
+    if (winpos == WINSIZE)
+      winpos = 0;
+    z->zs.next_out = z->win + winpos;
+    z->zs.avail_out = WINSIZE - winpos;
+    rc = _weaken(inflate)(&z->zs, Z_BLOCK);
+    n = (WINSIZE - winpos) - z->zs.avail_out;
+    lo = MAX(out, start);
+    hi = MIN(out + n, end);
+    if (lo < hi)
+      memcpy(buf + (lo - start), z->win + winpos + (lo - out), hi - lo);
+    out += n;
+    winpos += n;
+    if (rc == Z_STREAM_END)
+      break;
+    if (rc != Z_OK || (!n && !z->zs.avail_in))
+      return -1;
+    if ((z->zs.data_type & 128) && !(z->zs.data_type & 64) &&
+        out >= z->points[z->npoints - 1].out + ZIPOS_ZRAN_SPAN)
+      __zipos_zran_checkpoint(z, out, winpos % WINSIZE);
+  }
+  return out >= end ? 0 : -1;
+}
+
+static struct ZiposSpan *__zipos_zran_span(struct ZiposZran *z,
+                                           uint64_t index) {
+  int i, j;
+  struct ZiposSpan *s;
+  for (j = i = 0; i < ZIPOS_ZRAN_SPANS; ++i) {
+    s = z->spans + i;
+    if (s->data && s->index == index) {
+      s->used = ++z->tick;
+      return s;
+    }
+    if (!s->data || (z->spans[j].data && s->used < z->spans[j].used))
+      j = i;
+  }
+  s = z->spans + j;
+  if (!s->data && !(s->data = _mapanon(ZIPOS_ZRAN_SPAN)))
+    return 0;
+  s->used = 0;
+  s->index = index;
+  s->size = MIN(ZIPOS_ZRAN_SPAN, z->size - index * ZIPOS_ZRAN_SPAN);
+  if (__zipos_zran_extract(z, index * ZIPOS_ZRAN_SPAN, s->data, s->size)) {
+    s->index = -1;
+    return 0;
+  }
+  s->used = ++z->tick;
+  return s;
+}
+
+/**
+ * Reads from lazily inflated zip asset.
+ *
+ * @return bytes read, which is only short at end of file, or -1 w/ errno
+ */
+ssize_t __zipos_zran_pread(struct ZiposZran *z, void *buf, size_t size,
+                           uint64_t off) {
+  size_t n, i = 0;
+  struct ZiposSpan *s;
+  if (off >= z->size)
+    return 0;
+  size = MIN(size, z->size - off);
+  BLOCK_SIGNALS;
+  pthread_mutex_lock(&z->lock);
+  while (i < size) {
+    if (!(s = __zipos_zran_span(z, (off + i) / ZIPOS_ZRAN_SPAN)))
+      break;
+    n = MIN(size - i, s->size - (off + i) % ZIPOS_ZRAN_SPAN);
+    memcpy((char *)buf + i, s->data + (off + i) % ZIPOS_ZRAN_SPAN, n);
+    i += n;
+  }
+  pthread_mutex_unlock(&z->lock);
+  ALLOW_SIGNALS;
+  if (i < size)
+    return eio();
+  return i;
+}
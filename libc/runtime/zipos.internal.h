@@ -6,6 +6,14 @@ COSMOPOLITAN_C_START_
 
 #define ZIPOS_SYNTHETIC_DIRECTORY 0
 
+#define ZIPOS_CACHE_SLOTS 64                 /* inflated members to share */
+#define ZIPOS_CACHE_BYTES (32 * 1024 * 1024) /* budget for inflated bytes */
+
+#define ZIPOS_ZRAN_BYTES  (16 * 1024 * 1024) /* inflate larger lazily */
+#define ZIPOS_ZRAN_SPAN   (1024 * 1024)      /* checkpoint interval */
+#define ZIPOS_ZRAN_SPANS  8                  /* inflated spans to cache */
+#define ZIPOS_ZRAN_SLOTS  8                  /* lazy members to index */
+
 #ifndef __cplusplus
 #define _ZIPOS_ATOMIC(x) _Atomic(x)
 #else
@@ -15,14 +23,26 @@ COSMOPOLITAN_C_START_
 struct stat;
 struct iovec;
 struct Zipos;
+struct ZiposZran;
 
 struct ZiposUri {
   uint32_t len;
   char path[ZIPOS_PATH_MAX];
 };
 
+struct ZiposBlob {
+  size_t cfile;
+  size_t size;
+  size_t mapsize;
+  uint64_t used;
+  _ZIPOS_ATOMIC(size_t) refs;
+  uint8_t data[];
+};
+
 struct ZiposHandle {
   struct ZiposHandle *next;
+  struct ZiposBlob *blob;
+  struct ZiposZran *zran;
   struct Zipos *zipos;
   size_t size;
   size_t mapsize;
@@ -35,9 +55,11 @@ struct ZiposHandle {
 
 struct Zipos {
   long pagesz;
+  const char *path;
   uint8_t *map;
   uint8_t *cdir;
   uint64_t dev;
+  uint64_t pathdev;
   size_t *index;
   size_t records;
 };
@@ -62,6 +84,9 @@ ssize_t __zipos_read(struct ZiposHandle *, const struct iovec *, size_t,
 int64_t __zipos_seek(struct ZiposHandle *, int64_t, unsigned);
 int __zipos_fcntl(int, int, uintptr_t);
 int __zipos_notat(int, const char *);
+struct ZiposZran *__zipos_zran_open(struct Zipos *, size_t, size_t, size_t);
+ssize_t __zipos_zran_pread(struct ZiposZran *, void *, size_t, uint64_t);
+void __zipos_zran_unref(struct ZiposZran *);
 void *__zipos_mmap(void *, uint64_t, int32_t, int32_t, struct ZiposHandle *,
                    int64_t);
 
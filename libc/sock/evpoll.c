@@ -0,0 +1,465 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/calls/calls.h"
+#include "libc/calls/cp.internal.h"
+#include "libc/calls/struct/timespec.h"
+#include "libc/calls/syscall-sysv.internal.h"
+#include "libc/dce.h"
+#include "libc/errno.h"
+#include "libc/intrin/strace.h"
+#include "libc/macros.h"
+#include "libc/mem/mem.h"
+#include "libc/sock/evpoll.h"
+#include "libc/sock/evpoll.internal.h"
+#include "libc/sock/struct/pollfd.h"
+#include "libc/str/str.h"
+#include "libc/sysv/consts/poll.h"
+#include "libc/sysv/errfuns.h"
+#include "libc/thread/thread.h"
+
+#define kEvpollEpoll  1
+#define kEvpollKqueue 2
+#define kEvpollPoll   3
+
+#define EV_ADD      0x0001
+#define EV_DELETE   0x0002
+#define EV_ENABLE   0x0004
+#define EV_CLEAR    0x0020
+#define EV_DISPATCH 0x0080
+#define EV_ERROR    0x4000
+#define EV_EOF      0x8000
+
+#define EVFILT_READ  (IsNetbsd() ? 0 : -1)
+#define EVFILT_WRITE (IsNetbsd() ? 1 : -2)
+
+#define EVPOLL_KEVENTS 64
+
+struct EvpollEntry {
+  int fd;
+  bool disabled;
+  uint32_t events;
+  evpoll_data_t data;
+};
+
+struct evpoll {
+  int kind;
+  int fd;
+  pthread_mutex_t lock;
+  size_t n, c;
+  struct EvpollEntry *p;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// kqueue
+
+static size_t evpoll_kevent_size(void) {
+  if (IsXnu())
+    return 48;
+  if (IsFreebsd())
+    return 64;
+  if (IsNetbsd())
+    return sizeof(struct kevent_netbsd);
+  return 32;
+}
+
+static void evpoll_kevent_put(void *p, uint64_t ident, int filter,
+                              unsigned flags, uint64_t udata) {
+  if (IsNetbsd()) {
+    struct kevent_netbsd *k = p;
+    bzero(k, sizeof(*k));
+    k->ident = ident;
+    k->filter = filter;
+    k->flags = flags;
+    k->udata = udata;
+  } else {
+    struct kevent_bsd *k = p;
+    bzero(k, evpoll_kevent_size());
+    k->ident = ident;
+    k->filter = filter;
+    k->flags = flags;
+    k->udata = udata;
+  }
+}
+
+static void evpoll_kevent_get(const void *p, uint64_t *ident, int *filter,
+                              unsigned *flags, uint64_t *udata) {
+  if (IsNetbsd()) {
+    const struct kevent_netbsd *k = p;
+    *ident = k->ident;
+    *filter = k->filter;
+    *flags = k->flags;
+    *udata = k->udata;
+  } else {
+    const struct kevent_bsd *k = p;
+    *ident = k->ident;
+    *filter = k->filter;
+    *flags = k->flags;
+    *udata = k->udata;
+  }
+}
+
+static int evpoll_kevent(int kq, const void *changes, int nchanges,
+                         void *events, int nevents, const struct timespec *ts) {
+  if (IsXnu()) {
+    return sys_kevent(kq, changes, nchanges, events, nevents, 0, ts);
+  } else {
+    return sys_kevent(kq, changes, nchanges, events, nevents, ts, 0);
+  }
+}
+
+static int evpoll_kqueue_change(struct evpoll *ep, int fd, int filter,
+                                unsigned flags, uint64_t udata) {
+  struct kevent_bsd k;
+  evpoll_kevent_put(&k, fd, filter, flags, udata);
+  return evpoll_kevent(ep->fd, &k, 1, 0, 0, 0);
+}
+
+static int evpoll_kqueue_ctl(struct evpoll *ep, int op, int fd,
+                             const struct evpoll_event *ev) {
+  int i, rc, filter;
+  unsigned flags;
+  uint32_t want;
+  errno_t olderr;
+  bool removed = false;
+  olderr = errno;
+  for (i = 0; i < 2; ++i) {
+    filter = i ? EVFILT_WRITE : EVFILT_READ;
+    want = i ? EVPOLLOUT : EVPOLLIN;
+    if (op != EVPOLL_CTL_DEL && (ev->events & want)) {
+      flags = EV_ADD | EV_ENABLE;
+      if (ev->events & EVPOLLET)
+        flags |= EV_CLEAR;
+      if (ev->events & EVPOLLONESHOT)
+        flags |= EV_DISPATCH;
+      if (evpoll_kqueue_change(ep, fd, filter, flags, ev->data.u64) == -1)
+        return -1;
+    } else if (op != EVPOLL_CTL_ADD) {
+      // epoll registers an fd once for all events whereas kqueue needs
+      // a separate filter for each, which may or may not exist already
+      rc = evpoll_kqueue_change(ep, fd, filter, EV_DELETE, 0);
+      if (rc != -1) {
+        removed = true;
+      } else if (errno == ENOENT) {
+        errno = olderr;
+      } else {
+        return -1;
+      }
+    }
+  }
+  if (op == EVPOLL_CTL_DEL && !removed)
+    return enoent();
+  return 0;
+}
+
+static int evpoll_kqueue_wait(struct evpoll *ep, struct evpoll_event *events,
+                              int maxevents, int timeout_ms) {
+  int i, n, rc, filter;
+  unsigned flags;
+  uint32_t got;
+  uint64_t ident, udata, lastident;
+  struct timespec ts, *tsp;
+  char buf[EVPOLL_KEVENTS * sizeof(struct kevent_bsd)];
+  size_t size = evpoll_kevent_size();
+  if (timeout_ms >= 0) {
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = timeout_ms % 1000 * 1000000;
+    tsp = &ts;
+  } else {
+    tsp = 0;
+  }
+  rc = evpoll_kevent(ep->fd, 0, 0, buf, MIN(maxevents, EVPOLL_KEVENTS), tsp);
+  if (rc == -1)
+    return -1;
+  for (lastident = -1, n = i = 0; i < rc; ++i) {
+    evpoll_kevent_get(buf + i * size, &ident, &filter, &flags, &udata);
+    if (flags & EV_ERROR) {
+      got = EVPOLLERR;
+    } else if (filter == EVFILT_READ) {
+      got = EVPOLLIN;
+      if (flags & EV_EOF)
+        got |= EVPOLLRDHUP;
+    } else {
+      got = EVPOLLOUT;
+      if (flags & EV_EOF)
+        got |= EVPOLLHUP;
+    }
+    // the read and write filters for the same fd are usually returned
+    // next to each other, in which case we merge them like epoll does
+    if (n && ident == lastident) {
+      events[n - 1].events |= got;
+    } else {
+      events[n].events = got;
+      events[n].data.u64 = udata;
+      lastident = ident;
+      ++n;
+    }
+  }
+  return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// poll() emulation
+
+static int evpoll_poll_ctl(struct evpoll *ep, int op, int fd,
+                           const struct evpoll_event *ev) {
+  size_t i;
+  struct EvpollEntry *p;
+  for (i = 0; i < ep->n; ++i)
+    if (ep->p[i].fd == fd)
+      break;
+  if (op == EVPOLL_CTL_ADD) {
+    if (i < ep->n)
+      return eexist();
+    if (ep->n == ep->c) {
+      if (!(p = realloc(ep->p, (ep->c * 2 + 8) * sizeof(*p))))
+        return -1;
+      ep->p = p;
+      ep->c = ep->c * 2 + 8;
+    }
+    ep->n++;
+  } else if (i == ep->n) {
+    return enoent();
+  } else if (op == EVPOLL_CTL_DEL) {
+    ep->p[i] = ep->p[--ep->n];
+    return 0;
+  }
+  ep->p[i].fd = fd;
+  ep->p[i].disabled = false;
+  ep->p[i].events = ev->events;
+  ep->p[i].data = ev->data;
+  return 0;
+}
+
+static int evpoll_poll_wait(struct evpoll *ep, struct evpoll_event *events,
+                            int maxevents, int timeout_ms) {
+  int rc;
+  size_t i, j, n;
+  uint32_t got;
+  struct pollfd *fds;
+  pthread_mutex_lock(&ep->lock);
+  n = ep->n;
+  if (!(fds = malloc((n + 1) * sizeof(*fds)))) {
+    pthread_mutex_unlock(&ep->lock);
+    return -1;
+  }
+  for (i = 0; i < n; ++i) {
+    fds[i].fd = ep->p[i].disabled ? -1 : ep->p[i].fd;
+    fds[i].events = 0;
+    fds[i].revents = 0;
+    if (ep->p[i].events & EVPOLLIN)
+      fds[i].events |= POLLIN;
+    if (ep->p[i].events & EVPOLLPRI)
+      fds[i].events |= POLLPRI;
+    if (ep->p[i].events & EVPOLLOUT)
+      fds[i].events |= POLLOUT;
+  }
+  pthread_mutex_unlock(&ep->lock);
+  rc = poll(fds, n, timeout_ms);
+  if (rc > 0) {
+    pthread_mutex_lock(&ep->lock);
+    for (rc = i = 0; i < n && rc < maxevents; ++i) {
+      if (!fds[i].revents)
+        continue;
+      // registrations may have changed while we were polling
+      for (j = 0; j < ep->n; ++j)
+        if (ep->p[j].fd == fds[i].fd)
+          break;
+      if (j == ep->n || ep->p[j].disabled)
+        continue;
+      // epoll forgets about file descriptors once they're closed
+      if (fds[i].revents & POLLNVAL) {
+        ep->p[j] = ep->p[--ep->n];
+        continue;
+      }
+      got = 0;
+      if (fds[i].revents & POLLIN)
+        got |= EVPOLLIN;
+      if (fds[i].revents & POLLPRI)
+        got |= EVPOLLPRI;
+      if (fds[i].revents & POLLOUT)
+        got |= EVPOLLOUT;
+      if (fds[i].revents & POLLERR)
+        got |= EVPOLLERR;
+      if (fds[i].revents & POLLHUP)
+        got |= EVPOLLHUP;
+      if (ep->p[j].events & EVPOLLONESHOT)
+        ep->p[j].disabled = true;
+      events[rc].events = got;
+      events[rc].data = ep->p[j].data;
+      ++rc;
+    }
+    pthread_mutex_unlock(&ep->lock);
+  }
+  free(fds);
+  return rc;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// public api
+
+/**
+ * Creates scalable i/o readiness notifier.
+ *
+ * This is a portable interface with the same semantics as Linux epoll.
+ * The cost of evpoll_wait() is proportional to the number of file
+ * descriptors that are ready, rather than the number that have been
+ * registered, which is what servers holding tens of thousands of idle
+ * keep-alive connections need.
+ *
+ * On Linux this uses epoll, and on XNU and the BSDs it uses kqueue. On
+ * other platforms, e.g. Windows, or if the kernel doesn't have those
+ * system calls, it uses an emulation based on poll() which treats
+ * `EVPOLLET` as level triggered. Programs that read until
+ * `EAGAIN`, as edge triggered programs must, won't notice a difference.
+ *
+ * The kernel object isn't inherited by fork() on XNU and the BSDs, so
+ * each process should create its own.
+ *
+ * @return new notifier which must be freed with evpoll_destroy(), or
+ *     null w/ errno
+ * @raise EMFILE if the process is out of file descriptors
+ * @raise ENOMEM if we require more vespene gas
+ */
+struct evpoll *evpoll_create(void) {
+  struct evpoll *ep;
+  if (!(ep = calloc(1, sizeof(*ep))))
+    return 0;
+  pthread_mutex_init(&ep->lock, 0);
+  ep->fd = -1;
+  if (IsLinux()) {
+    if ((ep->fd = sys_epoll_create1(02000000)) != -1) {
+      ep->kind = kEvpollEpoll;
+    } else if (errno != ENOSYS) {
+      free(ep);
+      ep = 0;
+    }
+  } else if (IsBsd()) {
+    if ((ep->fd = sys_kqueue()) != -1) {
+      ep->kind = kEvpollKqueue;
+    } else if (errno != ENOSYS) {  // e.g. xnu on aarch64
+      free(ep);
+      ep = 0;
+    }
+  }
+  if (ep && !ep->kind)
+    ep->kind = kEvpollPoll;
+  STRACE("evpoll_create() → %p% m", ep);
+  return ep;
+}
+
+/**
+ * Changes set of file descriptors monitored by notifier.
+ *
+ * @param op is `EVPOLL_CTL_ADD`, `EVPOLL_CTL_MOD`, or `EVPOLL_CTL_DEL`
+ * @param ev->events may have `EVPOLLIN`, `EVPOLLOUT`, `EVPOLLPRI`, or
+ *     `EVPOLLRDHUP` plus the `EVPOLLET` and `EVPOLLONESHOT` modifiers,
+ *     and `EVPOLLERR` and `EVPOLLHUP` are always implied
+ * @param ev->data is returned verbatim by evpoll_wait()
+ * @return 0 on success, or -1 w/ errno
+ * @raise EEXIST if `op` is `EVPOLL_CTL_ADD` and `fd` is already there,
+ *     although this isn't detected on XNU and the BSDs
+ * @raise ENOENT if `op` is `EVPOLL_CTL_MOD` or `EVPOLL_CTL_DEL` and
+ *     `fd` hasn't been registered
+ * @raise EINVAL if `op` is invalid
+ * @raise EBADF if `fd` isn't open
+ */
+int evpoll_ctl(struct evpoll *ep, int op, int fd,
+               const struct evpoll_event *ev) {
+  int rc;
+  struct evpoll_event tmp;
+  if (op != EVPOLL_CTL_ADD && op != EVPOLL_CTL_MOD && op != EVPOLL_CTL_DEL) {
+    rc = einval();
+  } else if (op != EVPOLL_CTL_DEL && !ev) {
+    rc = einval();
+  } else if (ep->kind == kEvpollEpoll) {
+    if (ev)
+      tmp = *ev;
+    rc = sys_epoll_ctl(ep->fd, op, fd, &tmp);
+  } else if (ep->kind == kEvpollKqueue) {
+    rc = evpoll_kqueue_ctl(ep, op, fd, ev);
+  } else {
+    pthread_mutex_lock(&ep->lock);
+    rc = evpoll_poll_ctl(ep, op, fd, ev);
+    pthread_mutex_unlock(&ep->lock);
+  }
+  STRACE("evpoll_ctl(%p, %d, %d, %#x) → %d% m", ep, op, fd,
+         ev ? ev->events : 0, rc);
+  return rc;
+}
+
+/**
+ * Waits for i/o readiness events.
+ *
+ * @param events receives up to `maxevents` notifications
+ * @param timeout_ms if 0 means don't wait and negative waits forever
+ * @return number of `events` written, 0 on timeout, or -1 w/ errno
+ * @raise EINVAL if `maxevents` isn't positive
+ * @raise EINTR if signal was delivered
+ * @raise ECANCELED if thread was cancelled in masked mode
+ * @cancelationpoint
+ * @norestart
+ */
+int evpoll_wait(struct evpoll *ep, struct evpoll_event *events,
+                int maxevents, int timeout_ms) {
+  int rc;
+  BEGIN_CANCELATION_POINT;
+  if (maxevents <= 0) {
+    rc = einval();
+  } else if (ep->kind == kEvpollEpoll) {
+    rc = sys_epoll_pwait(ep->fd, events, maxevents, timeout_ms, 0, 8);
+  } else if (ep->kind == kEvpollKqueue) {
+    rc = evpoll_kqueue_wait(ep, events, maxevents, timeout_ms);
+  } else {
+    // don't report a timeout if all we saw were stale registrations
+    do {
+      rc = evpoll_poll_wait(ep, events, maxevents, timeout_ms);
+    } while (!rc && timeout_ms < 0);
+  }
+  END_CANCELATION_POINT;
+  STRACE("evpoll_wait(%p, %p, %d, %d) → %d% m", ep, events, maxevents,
+         timeout_ms, rc);
+  return rc;
+}
+
+/**
+ * Returns kernel file descriptor backing notifier.
+ *
+ * This may be used to nest a notifier inside poll() or another notifier
+ * when running on Linux, XNU, or the BSDs.
+ *
+ * @return file descriptor, or -1 if poll() is being emulated
+ */
+int evpoll_fd(const struct evpoll *ep) {
+  return ep->fd;
+}
+
+/**
+ * Frees notifier.
+ *
+ * @param ep may be null
+ */
+void evpoll_destroy(struct evpoll *ep) {
+  if (!ep)
+    return;
+  if (ep->fd != -1)
+    sys_close(ep->fd);
+  pthread_mutex_destroy(&ep->lock);
+  free(ep->p);
+  free(ep);
+}
@@ -0,0 +1,45 @@
+#ifndef COSMOPOLITAN_LIBC_SOCK_EVPOLL_H_
+#define COSMOPOLITAN_LIBC_SOCK_EVPOLL_H_
+
+#define EVPOLL_CTL_ADD 1
+#define EVPOLL_CTL_DEL 2
+#define EVPOLL_CTL_MOD 3
+
+#define EVPOLLIN      0x00000001
+#define EVPOLLPRI     0x00000002
+#define EVPOLLOUT     0x00000004
+#define EVPOLLERR     0x00000008
+#define EVPOLLHUP     0x00000010
+#define EVPOLLRDHUP   0x00002000
+#define EVPOLLONESHOT 0x40000000
+#define EVPOLLET      0x80000000
+
+COSMOPOLITAN_C_START_
+
+typedef union evpoll_data {
+  void *ptr;
+  int fd;
+  uint32_t u32;
+  uint64_t u64;
+} evpoll_data_t;
+
+/* binary compatible with linux epoll_event */
+struct evpoll_event {
+  uint32_t events;
+  evpoll_data_t data;
+}
+#ifdef __x86_64__
+__attribute__((__packed__))
+#endif
+;
+
+struct evpoll;
+
+struct evpoll *evpoll_create(void) libcesque;
+int evpoll_ctl(struct evpoll *, int, int, const struct evpoll_event *) libcesque;
+int evpoll_wait(struct evpoll *, struct evpoll_event *, int, int) libcesque;
+int evpoll_fd(const struct evpoll *) libcesque;
+void evpoll_destroy(struct evpoll *) libcesque;
+
+COSMOPOLITAN_C_END_
+#endif /* COSMOPOLITAN_LIBC_SOCK_EVPOLL_H_ */
@@ -0,0 +1,38 @@
+#ifndef COSMOPOLITAN_LIBC_SOCK_EVPOLL_INTERNAL_H_
+#define COSMOPOLITAN_LIBC_SOCK_EVPOLL_INTERNAL_H_
+#include "libc/calls/struct/sigset.h"
+#include "libc/calls/struct/timespec.h"
+#include "libc/sock/evpoll.h"
+COSMOPOLITAN_C_START_
+
+/* kqueue event on xnu (kevent64_s), freebsd 12+, and openbsd */
+struct kevent_bsd {
+  uint64_t ident;
+  int16_t filter;
+  uint16_t flags;
+  uint32_t fflags;
+  int64_t data;
+  uint64_t udata;
+  uint64_t ext[4]; /* xnu has two, freebsd has four, openbsd has none */
+};
+
+/* kqueue event on netbsd (__kevent50) */
+struct kevent_netbsd {
+  uint64_t ident;
+  uint32_t filter;
+  uint32_t flags;
+  uint32_t fflags;
+  int64_t data;
+  uint64_t udata;
+};
+
+int sys_epoll_create1(int);
+int sys_epoll_ctl(int, int, int, struct evpoll_event *);
+int sys_epoll_pwait(int, struct evpoll_event *, int, int, const sigset_t *,
+                    size_t);
+int sys_kqueue(void);
+int sys_kevent(int, const void *, int, void *, int, const void *,
+               const void *);
+
+COSMOPOLITAN_C_END_
+#endif /* COSMOPOLITAN_LIBC_SOCK_EVPOLL_INTERNAL_H_ */
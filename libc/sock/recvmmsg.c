@@ -0,0 +1,100 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/calls/cp.internal.h"
+#include "libc/calls/struct/timespec.h"
+#include "libc/calls/struct/timespec.internal.h"
+#include "libc/dce.h"
+#include "libc/errno.h"
+#include "libc/intrin/strace.h"
+#include "libc/sock/struct/mmsghdr.h"
+#include "libc/sock/struct/mmsghdr.internal.h"
+#include "libc/sock/struct/msghdr.h"
+#include "libc/sysv/consts/msg.h"
+#include "libc/sysv/errfuns.h"
+
+static int recvmmsg_loop(int fd, struct mmsghdr *vec, unsigned vlen,
+                         int flags, struct timespec *timeout) {
+  ssize_t rc;
+  unsigned i;
+  errno_t err;
+  struct timespec deadline;
+  if (timeout)
+    deadline = timespec_add(timespec_mono(), *timeout);
+  err = errno;
+  for (i = 0; i < vlen; ++i) {
+    rc = recvmsg(fd, &vec[i].msg_hdr, flags & ~MSG_WAITFORONE);
+    if (rc == -1) {
+      if (!i)
+        return -1;
+      errno = err;  // linux reports this error on the next call
+      break;
+    }
+    vec[i].msg_len = rc;
+    if (flags & MSG_WAITFORONE)
+      flags |= MSG_DONTWAIT;
+    if (timeout && timespec_cmp(timespec_mono(), deadline) >= 0) {
+      ++i;
+      break;
+    }
+  }
+  return i;
+}
+
+/**
+ * Receives multiple messages from a socket.
+ *
+ * This is the same as calling recvmsg() on each element of `vec`, except
+ * Linux does it with a single system call, which can make a meaningful
+ * difference for servers that receive lots of small datagrams. Other
+ * platforms use a loop.
+ *
+ * This function blocks until `vlen` messages have been received, unless
+ * `MSG_WAITFORONE` or `MSG_DONTWAIT` are passed in `flags`. If an error
+ * happens after some messages have been received, then the number of
+ * messages received so far is returned instead.
+ *
+ * @param vec[𝑖].msg_hdr is the same as what you'd pass to recvmsg()
+ * @param vec[𝑖].msg_len receives number of bytes in each message
+ * @param flags may have MSG_WAITFORONE, MSG_DONTWAIT, MSG_PEEK, etc.
+ * @param timeout is checked only after each message is received, and
+ *     won't interrupt a blocking read; it may be null to disable
+ * @return number of messages received, or -1 w/ errno
+ * @raise EAGAIN if `MSG_DONTWAIT` was passed and nothing is available
+ * @raise EINTR if a signal was delivered before any message arrived
+ * @cancelationpoint
+ * @restartable (unless SO_RCVTIMEO)
+ */
+int recvmmsg(int fd, struct mmsghdr *vec, unsigned vlen, int flags,
+             struct timespec *timeout) {
+  int rc;
+  BEGIN_CANCELATION_POINT;
+  if (!vlen) {
+    rc = 0;
+  } else if (IsLinux()) {
+    if ((rc = sys_recvmmsg(fd, vec, vlen, flags, timeout)) == -1 &&
+        errno == ENOSYS)
+      rc = recvmmsg_loop(fd, vec, vlen, flags, timeout);
+  } else {
+    rc = recvmmsg_loop(fd, vec, vlen, flags, timeout);
+  }
+  END_CANCELATION_POINT;
+  STRACE("recvmmsg(%d, %p, %u, %#x, %s) → %d% m", fd, vec, vlen, flags,
+         DescribeTimespec(0, timeout), rc);
+  return rc;
+}
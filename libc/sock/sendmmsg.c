@@ -0,0 +1,81 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/calls/cp.internal.h"
+#include "libc/dce.h"
+#include "libc/errno.h"
+#include "libc/intrin/strace.h"
+#include "libc/sock/struct/mmsghdr.h"
+#include "libc/sock/struct/mmsghdr.internal.h"
+#include "libc/sock/struct/msghdr.h"
+
+static int sendmmsg_loop(int fd, struct mmsghdr *vec, unsigned vlen,
+                         int flags) {
+  ssize_t rc;
+  unsigned i;
+  errno_t err;
+  err = errno;
+  for (i = 0; i < vlen; ++i) {
+    rc = sendmsg(fd, &vec[i].msg_hdr, flags);
+    if (rc == -1) {
+      if (!i)
+        return -1;
+      errno = err;  // linux reports this error on the next call
+      break;
+    }
+    vec[i].msg_len = rc;
+  }
+  return i;
+}
+
+/**
+ * Sends multiple messages on a socket.
+ *
+ * This is the same as calling sendmsg() on each element of `vec`, except
+ * Linux does it with a single system call, which can make a meaningful
+ * difference for programs that send lots of small datagrams. Other
+ * platforms use a loop. Combining this with `UDP_SEGMENT` on Linux will
+ * additionally let the kernel split each buffer into many datagrams.
+ *
+ * If an error happens after some messages have been sent, the number
+ * of messages sent so far is returned instead.
+ *
+ * @param vec[𝑖].msg_hdr is the same as what you'd pass to sendmsg()
+ * @param vec[𝑖].msg_len receives number of bytes sent for each message
+ * @param flags may have MSG_DONTWAIT, MSG_NOSIGNAL, etc.
+ * @return number of messages sent, or -1 w/ errno
+ * @raise EAGAIN if `MSG_DONTWAIT` was passed and nothing could be sent
+ * @raise EINTR if a signal was delivered before any message was sent
+ * @cancelationpoint
+ * @restartable (unless SO_SNDTIMEO)
+ */
+int sendmmsg(int fd, struct mmsghdr *vec, unsigned vlen, int flags) {
+  int rc;
+  BEGIN_CANCELATION_POINT;
+  if (!vlen) {
+    rc = 0;
+  } else if (IsLinux()) {
+    if ((rc = sys_sendmmsg(fd, vec, vlen, flags)) == -1 && errno == ENOSYS)
+      rc = sendmmsg_loop(fd, vec, vlen, flags);
+  } else {
+    rc = sendmmsg_loop(fd, vec, vlen, flags);
+  }
+  END_CANCELATION_POINT;
+  STRACE("sendmmsg(%d, %p, %u, %#x) → %d% m", fd, vec, vlen, flags, rc);
+  return rc;
+}
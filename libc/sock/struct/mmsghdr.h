@@ -0,0 +1,16 @@
+#ifndef COSMOPOLITAN_LIBC_SOCK_STRUCT_MMSGHDR_H_
+#define COSMOPOLITAN_LIBC_SOCK_STRUCT_MMSGHDR_H_
+#include "libc/calls/struct/timespec.h"
+#include "libc/sock/struct/msghdr.h"
+COSMOPOLITAN_C_START_
+
+struct mmsghdr {         /* Linux ABI */
+  struct msghdr msg_hdr; /* message to send or buffers to receive into */
+  uint32_t msg_len;      /* number of bytes transferred */
+};
+
+int recvmmsg(int, struct mmsghdr *, unsigned, int, struct timespec *);
+int sendmmsg(int, struct mmsghdr *, unsigned, int);
+
+COSMOPOLITAN_C_END_
+#endif /* COSMOPOLITAN_LIBC_SOCK_STRUCT_MMSGHDR_H_ */
@@ -0,0 +1,10 @@
+#ifndef COSMOPOLITAN_LIBC_SOCK_STRUCT_MMSGHDR_INTERNAL_H_
+#define COSMOPOLITAN_LIBC_SOCK_STRUCT_MMSGHDR_INTERNAL_H_
+#include "libc/sock/struct/mmsghdr.h"
+COSMOPOLITAN_C_START_
+
+int sys_recvmmsg(int, struct mmsghdr *, unsigned, int, struct timespec *);
+int sys_sendmmsg(int, struct mmsghdr *, unsigned, int);
+
+COSMOPOLITAN_C_END_
+#endif /* COSMOPOLITAN_LIBC_SOCK_STRUCT_MMSGHDR_INTERNAL_H_ */
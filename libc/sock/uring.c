@@ -0,0 +1,583 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/calls/calls.h"
+#include "libc/calls/makedev.h"
+#include "libc/calls/struct/iovec.h"
+#include "libc/calls/struct/stat.h"
+#include "libc/calls/syscall-sysv.internal.h"
+#include "libc/dce.h"
+#include "libc/errno.h"
+#include "libc/intrin/atomic.h"
+#include "libc/intrin/strace.h"
+#include "libc/mem/mem.h"
+#include "libc/runtime/runtime.h"
+#include "libc/sock/sock.h"
+#include "libc/sock/struct/sockaddr.h"
+#include "libc/sock/uring.h"
+#include "libc/str/str.h"
+#include "libc/sysv/consts/map.h"
+#include "libc/sysv/consts/prot.h"
+#include "libc/sysv/errfuns.h"
+
+#define IORING_OFF_SQ_RING        0x00000000
+#define IORING_OFF_CQ_RING        0x08000000
+#define IORING_OFF_SQES           0x10000000
+#define IORING_FEAT_SINGLE_MMAP   1
+#define IORING_ENTER_GETEVENTS    1
+#define IORING_REGISTER_BUFFERS   0
+#define IORING_REGISTER_FILES     2
+#define IORING_UNREGISTER_BUFFERS 1
+#define IORING_UNREGISTER_FILES   3
+
+#define URING_MAX_ENTRIES 32768
+
+struct IoSqringOffsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t flags;
+  uint32_t dropped;
+  uint32_t array;
+  uint32_t resv1;
+  uint64_t user_addr;
+};
+
+struct IoCqringOffsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t overflow;
+  uint32_t cqes;
+  uint32_t flags;
+  uint32_t resv1;
+  uint64_t user_addr;
+};
+
+struct IoUringParams {
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+  uint32_t wq_fd;
+  uint32_t resv[3];
+  struct IoSqringOffsets sq_off;
+  struct IoCqringOffsets cq_off;
+};
+
+struct uring {
+  int fd; /* -1 if operations are performed synchronously */
+  unsigned sq_mask;
+  unsigned cq_mask;
+  unsigned sq_entries;
+  unsigned cq_entries;
+  unsigned sqe_head; /* sqes handed out but not yet submitted */
+  unsigned sqe_tail;
+  atomic_uint *sq_head;
+  atomic_uint *sq_tail;
+  atomic_uint *cq_head;
+  atomic_uint *cq_tail;
+  unsigned *sq_array;
+  struct uring_sqe *sqes;
+  struct uring_cqe *cqes;
+  void *sq_ring;
+  void *cq_ring;
+  size_t sq_ring_size;
+  size_t cq_ring_size;
+  size_t sqes_size;
+  atomic_uint emu_sq_head;
+  atomic_uint emu_cq_head;
+  atomic_uint emu_cq_tail;
+  unsigned nfiles;
+  int *files;
+};
+
+static void *uring_map(int fd, size_t size, int64_t off) {
+  void *p;
+  p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, off);
+  return p != MAP_FAILED ? p : 0;
+}
+
+static bool uring_setup_kernel(struct uring *r, unsigned entries) {
+  char *sq, *cq;
+  struct IoUringParams p;
+  bzero(&p, sizeof(p));
+  if ((r->fd = sys_io_uring_setup(entries, &p)) == -1)
+    return false;
+  r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  r->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (r->cq_ring_size > r->sq_ring_size)
+      r->sq_ring_size = r->cq_ring_size;
+    r->cq_ring_size = 0;
+  }
+  r->sqes_size = p.sq_entries * sizeof(struct uring_sqe);
+  if (!(r->sq_ring = uring_map(r->fd, r->sq_ring_size, IORING_OFF_SQ_RING)))
+    return false;
+  if (r->cq_ring_size) {
+    if (!(r->cq_ring = uring_map(r->fd, r->cq_ring_size, IORING_OFF_CQ_RING)))
+      return false;
+  } else {
+    r->cq_ring = r->sq_ring;
+  }
+  if (!(r->sqes = uring_map(r->fd, r->sqes_size, IORING_OFF_SQES)))
+    return false;
+  sq = r->sq_ring;
+  cq = r->cq_ring;
+  r->sq_head = (atomic_uint *)(sq + p.sq_off.head);
+  r->sq_tail = (atomic_uint *)(sq + p.sq_off.tail);
+  r->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+  r->sq_entries = p.sq_entries;
+  r->sq_array = (unsigned *)(sq + p.sq_off.array);
+  r->cq_head = (atomic_uint *)(cq + p.cq_off.head);
+  r->cq_tail = (atomic_uint *)(cq + p.cq_off.tail);
+  r->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+  r->cq_entries = p.cq_entries;
+  r->cqes = (struct uring_cqe *)(cq + p.cq_off.cqes);
+  return true;
+}
+
+static bool uring_setup_emulated(struct uring *r, unsigned entries) {
+  unsigned n;
+  for (n = 1; n < entries; n <<= 1) {
+  }
+  r->fd = -1;
+  r->sq_entries = n;
+  r->sq_mask = n - 1;
+  r->cq_entries = n * 2;
+  r->cq_mask = n * 2 - 1;
+  r->sq_head = &r->emu_sq_head;
+  r->cq_head = &r->emu_cq_head;
+  r->cq_tail = &r->emu_cq_tail;
+  if (!(r->sqes = calloc(r->sq_entries, sizeof(struct uring_sqe))))
+    return false;
+  if (!(r->cqes = calloc(r->cq_entries, sizeof(struct uring_cqe))))
+    return false;
+  return true;
+}
+
+/**
+ * Creates asynchronous i/o ring.
+ *
+ * Operations are queued by calling uring_get_sqe() and one of the
+ * uring_prep_*() functions, and then sent in a batch by uring_submit().
+ * Results are consumed by uring_peek() or uring_wait() and uring_seen().
+ * For example, to read two files with a single system call:
+ *
+ *     struct uring_cqe *cqe;
+ *     struct uring *r = uring_create(8);
+ *     uring_prep_read(uring_get_sqe(r), fd1, buf1, sizeof(buf1), 0);
+ *     uring_prep_read(uring_get_sqe(r), fd2, buf2, sizeof(buf2), 0);
+ *     uring_submit(r, 2);
+ *     for (int i = 0; i < 2; ++i) {
+ *       uring_wait(r, &cqe);
+ *       // cqe->res is bytes read or -errno
+ *       uring_seen(r, cqe);
+ *     }
+ *     uring_destroy(r);
+ *
+ * On Linux 5.6+ this uses io_uring. Otherwise operations are performed
+ * synchronously in order by uring_submit(), which is still correct for
+ * programs that don't depend on operations completing out of order.
+ *
+ * Operations run by the kernel use raw system calls. It's therefore not
+ * possible to open files in the `/zip/` folder, and file descriptors
+ * that Cosmopolitan emulates won't work.
+ *
+ * A ring must only be used by a single thread at a time.
+ *
+ * @param entries is submission queue size, which is rounded up to a
+ *     power of two, and the completion queue will be twice as large
+ * @return new ring, which must be freed by uring_destroy(), or null
+ *     w/ errno
+ * @raise EINVAL if `entries` is zero or too large
+ * @raise ENOMEM if we require more vespene gas
+ */
+struct uring *uring_create(unsigned entries) {
+  struct uring *r;
+  if (!entries || entries > URING_MAX_ENTRIES) {
+    einval();
+    return 0;
+  }
+  if (!(r = calloc(1, sizeof(*r))))
+    return 0;
+  r->fd = -1;  // so uring_destroy() won't close stdin
+  if (IsLinux() && uring_setup_kernel(r, entries)) {
+    STRACE("uring_create(%u) → %p [io_uring]", entries, r);
+    return r;
+  }
+  uring_destroy(r);
+  if (!(r = calloc(1, sizeof(*r))))
+    return 0;
+  if (!uring_setup_emulated(r, entries)) {
+    uring_destroy(r);
+    return 0;
+  }
+  STRACE("uring_create(%u) → %p [synchronous]", entries, r);
+  return r;
+}
+
+/**
+ * Frees asynchronous i/o ring.
+ *
+ * Operations that are still in flight will be cancelled by the kernel.
+ *
+ * @param r may be null
+ */
+void uring_destroy(struct uring *r) {
+  if (!r)
+    return;
+  if (r->fd != -1) {
+    if (r->sqes)
+      munmap(r->sqes, r->sqes_size);
+    if (r->cq_ring && r->cq_ring != r->sq_ring)
+      munmap(r->cq_ring, r->cq_ring_size);
+    if (r->sq_ring)
+      munmap(r->sq_ring, r->sq_ring_size);
+    sys_close(r->fd);
+  } else {
+    free(r->sqes);
+    free(r->cqes);
+  }
+  free(r->files);
+  free(r);
+}
+
+/**
+ * Returns true if ring is backed by the kernel.
+ */
+bool uring_is_kernel(const struct uring *r) {
+  return r->fd != -1;
+}
+
+/**
+ * Returns next free submission queue entry.
+ *
+ * @return entry which should be filled by a uring_prep_*() function,
+ *     or null if the submission queue is full, in which case you need
+ *     to call uring_submit() first
+ */
+struct uring_sqe *uring_get_sqe(struct uring *r) {
+  unsigned head;
+  head = atomic_load_explicit(r->sq_head, memory_order_acquire);
+  if (r->sqe_tail - head >= r->sq_entries)
+    return 0;
+  return &r->sqes[r->sqe_tail++ & r->sq_mask];
+}
+
+static bool uring_is_rw(int opcode) {
+  switch (opcode) {
+    case URING_READ:
+    case URING_WRITE:
+    case URING_READ_FIXED:
+    case URING_WRITE_FIXED:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static int uring_statx(int dirfd, const char *path, int flags,
+                       struct uring_statx *stx) {
+  struct stat st;
+  if (fstatat(dirfd, path, &st, flags) == -1)
+    return -1;
+  bzero(stx, sizeof(*stx));
+  stx->stx_mask = URING_STATX_BASIC_STATS;
+  stx->stx_blksize = st.st_blksize;
+  stx->stx_nlink = st.st_nlink;
+  stx->stx_uid = st.st_uid;
+  stx->stx_gid = st.st_gid;
+  stx->stx_mode = st.st_mode;
+  stx->stx_ino = st.st_ino;
+  stx->stx_size = st.st_size;
+  stx->stx_blocks = st.st_blocks;
+  stx->stx_atime.tv_sec = st.st_atim.tv_sec;
+  stx->stx_atime.tv_nsec = st.st_atim.tv_nsec;
+  stx->stx_btime.tv_sec = st.st_birthtim.tv_sec;
+  stx->stx_btime.tv_nsec = st.st_birthtim.tv_nsec;
+  stx->stx_ctime.tv_sec = st.st_ctim.tv_sec;
+  stx->stx_ctime.tv_nsec = st.st_ctim.tv_nsec;
+  stx->stx_mtime.tv_sec = st.st_mtim.tv_sec;
+  stx->stx_mtime.tv_nsec = st.st_mtim.tv_nsec;
+  stx->stx_rdev_major = major(st.st_rdev);
+  stx->stx_rdev_minor = minor(st.st_rdev);
+  stx->stx_dev_major = major(st.st_dev);
+  stx->stx_dev_minor = minor(st.st_dev);
+  return 0;
+}
+
+static int32_t uring_execute(struct uring *r, const struct uring_sqe *sqe) {
+  int fd;
+  long rc;
+  void *addr;
+  errno_t err;
+  fd = sqe->fd;
+  addr = (void *)(uintptr_t)sqe->addr;
+  if (sqe->flags & URING_FIXED_FILE) {
+    if ((unsigned)fd >= r->nfiles)
+      return -EBADF;
+    fd = r->files[fd];
+  }
+  err = errno;
+  switch (sqe->opcode) {
+    case URING_NOP:
+      rc = 0;
+      break;
+    case URING_READ:
+    case URING_READ_FIXED:
+      if (sqe->off == -1) {
+        rc = read(fd, addr, sqe->len);
+      } else {
+        rc = pread(fd, addr, sqe->len, sqe->off);
+      }
+      break;
+    case URING_WRITE:
+    case URING_WRITE_FIXED:
+      if (sqe->off == -1) {
+        rc = write(fd, addr, sqe->len);
+      } else {
+        rc = pwrite(fd, addr, sqe->len, sqe->off);
+      }
+      break;
+    case URING_READV:
+      if (sqe->off == -1) {
+        rc = readv(fd, addr, sqe->len);
+      } else {
+        rc = preadv(fd, addr, sqe->len, sqe->off);
+      }
+      break;
+    case URING_WRITEV:
+      if (sqe->off == -1) {
+        rc = writev(fd, addr, sqe->len);
+      } else {
+        rc = pwritev(fd, addr, sqe->len, sqe->off);
+      }
+      break;
+    case URING_FSYNC:
+      if (sqe->op_flags & URING_FSYNC_DATASYNC) {
+        rc = fdatasync(fd);
+      } else {
+        rc = fsync(fd);
+      }
+      break;
+    case URING_ACCEPT:
+      rc = accept4(fd, addr, (uint32_t *)(uintptr_t)sqe->off, sqe->op_flags);
+      break;
+    case URING_RECV:
+      rc = recv(fd, addr, sqe->len, sqe->op_flags);
+      break;
+    case URING_SEND:
+      rc = send(fd, addr, sqe->len, sqe->op_flags);
+      break;
+    case URING_OPENAT:
+      rc = openat(fd, addr, sqe->op_flags, sqe->len);
+      break;
+    case URING_CLOSE:
+      rc = close(fd);
+      break;
+    case URING_STATX:
+      rc = uring_statx(fd, addr, sqe->op_flags,
+                       (struct uring_statx *)(uintptr_t)sqe->off);
+      break;
+    default:
+      rc = einval();
+      break;
+  }
+  if (rc == -1) {
+    rc = -errno;
+    errno = err;
+  }
+  return rc;
+}
+
+// performs submitted operations synchronously in order
+static int uring_submit_emulated(struct uring *r) {
+  int32_t res;
+  int count = 0;
+  bool broken = false;
+  unsigned head, tail;
+  struct uring_sqe *sqe;
+  struct uring_cqe *cqe;
+  while (r->sqe_head != r->sqe_tail) {
+    head = atomic_load_explicit(r->cq_head, memory_order_acquire);
+    tail = atomic_load_explicit(r->cq_tail, memory_order_relaxed);
+    if (tail - head >= r->cq_entries) {
+      if (!count)
+        return ebusy();
+      break;
+    }
+    sqe = &r->sqes[r->sqe_head & r->sq_mask];
+    if (broken) {
+      res = -ECANCELED;
+    } else {
+      res = uring_execute(r, sqe);
+      // the kernel considers short reads and writes to be failures
+      // for the purpose of deciding whether to cancel linked sqes
+      if ((sqe->flags & URING_LINK) && !(sqe->flags & URING_HARDLINK) &&
+          (res < 0 || (uring_is_rw(sqe->opcode) && res < sqe->len)))
+        broken = true;
+    }
+    if (!(sqe->flags & (URING_LINK | URING_HARDLINK)))
+      broken = false;
+    cqe = &r->cqes[tail & r->cq_mask];
+    cqe->user_data = sqe->user_data;
+    cqe->res = res;
+    cqe->flags = 0;
+    atomic_store_explicit(r->cq_tail, tail + 1, memory_order_release);
+    atomic_store_explicit(r->sq_head, ++r->sqe_head, memory_order_release);
+    ++count;
+  }
+  return count;
+}
+
+/**
+ * Submits queued operations.
+ *
+ * @param wait_nr is the number of completions to wait for, which may
+ *     be zero if the caller only wants the operations to be started
+ * @return number of operations submitted, or -1 w/ errno
+ * @raise EBUSY if completion queue is full, in which case uring_seen()
+ *     needs to be called on some completions before trying again
+ * @raise EINTR if signal was delivered while waiting
+ * @norestart
+ */
+int uring_submit(struct uring *r, unsigned wait_nr) {
+  int rc;
+  unsigned tail, count;
+  if (r->fd == -1)
+    return uring_submit_emulated(r);
+  tail = atomic_load_explicit(r->sq_tail, memory_order_relaxed);
+  for (count = 0; r->sqe_head != r->sqe_tail; ++count, ++tail)
+    r->sq_array[tail & r->sq_mask] = r->sqe_head++ & r->sq_mask;
+  atomic_store_explicit(r->sq_tail, tail, memory_order_release);
+  if (!count && !wait_nr)
+    return 0;
+  rc = sys_io_uring_enter(r->fd, count, wait_nr,
+                          wait_nr ? IORING_ENTER_GETEVENTS : 0, 0, 0);
+  return rc;
+}
+
+/**
+ * Returns oldest completed operation without blocking.
+ *
+ * @return 0 on success, or -1 w/ errno
+ * @raise EAGAIN if no operations have completed
+ */
+int uring_peek(struct uring *r, struct uring_cqe **out_cqe) {
+  unsigned head, tail;
+  head = atomic_load_explicit(r->cq_head, memory_order_relaxed);
+  tail = atomic_load_explicit(r->cq_tail, memory_order_acquire);
+  if (head == tail) {
+    errno = EAGAIN;
+    return -1;
+  }
+  *out_cqe = &r->cqes[head & r->cq_mask];
+  return 0;
+}
+
+/**
+ * Returns oldest completed operation, waiting if necessary.
+ *
+ * When operations are being performed synchronously, everything that
+ * has been submitted will have completed already, so this won't block.
+ *
+ * @return 0 on success, or -1 w/ errno
+ * @raise EAGAIN if performing i/o synchronously and nothing's pending
+ * @raise EINTR if signal was delivered while waiting
+ * @norestart
+ */
+int uring_wait(struct uring *r, struct uring_cqe **out_cqe) {
+  for (;;) {
+    if (!uring_peek(r, out_cqe))
+      return 0;
+    if (r->fd == -1)
+      return -1;
+    if (sys_io_uring_enter(r->fd, 0, 1, IORING_ENTER_GETEVENTS, 0, 0) == -1)
+      return -1;
+  }
+}
+
+/**
+ * Releases completion returned by uring_peek() or uring_wait().
+ */
+void uring_seen(struct uring *r, struct uring_cqe *cqe) {
+  unsigned head;
+  head = atomic_load_explicit(r->cq_head, memory_order_relaxed);
+  atomic_store_explicit(r->cq_head, head + 1, memory_order_release);
+}
+
+/**
+ * Pins memory so it can be used by uring_prep_read_fixed() etc.
+ *
+ * The kernel will map these buffers once, rather than every time an
+ * operation is submitted. Buffers are unregistered if `n` is zero.
+ *
+ * @return 0 on success, or -1 w/ errno
+ * @raise ENOMEM if `RLIMIT_MEMLOCK` was exceeded
+ * @raise EBUSY if buffers are already registered
+ */
+int uring_register_buffers(struct uring *r, const struct iovec *iov,
+                           unsigned n) {
+  if (r->fd == -1)
+    return 0;
+  if (n) {
+    return sys_io_uring_register(r->fd, IORING_REGISTER_BUFFERS, iov, n);
+  } else {
+    return sys_io_uring_register(r->fd, IORING_UNREGISTER_BUFFERS, 0, 0);
+  }
+}
+
+/**
+ * Registers file descriptors for use with `URING_FIXED_FILE`.
+ *
+ * When an sqe has the `URING_FIXED_FILE` flag, its `fd` is an index
+ * into `fds`, which saves the kernel from having to look up the file
+ * and manage its reference count on every operation. Files are
+ * unregistered if `n` is zero.
+ *
+ * @return 0 on success, or -1 w/ errno
+ * @raise EBUSY if files are already registered
+ */
+int uring_register_files(struct uring *r, const int *fds, unsigned n) {
+  int *files;
+  if (r->fd != -1) {
+    if (n) {
+      return sys_io_uring_register(r->fd, IORING_REGISTER_FILES, fds, n);
+    } else {
+      return sys_io_uring_register(r->fd, IORING_UNREGISTER_FILES, 0, 0);
+    }
+  }
+  if (n && r->nfiles)
+    return ebusy();
+  if (n) {
+    if (!(files = malloc(n * sizeof(int))))
+      return -1;
+    memcpy(files, fds, n * sizeof(int));
+  } else {
+    files = 0;
+  }
+  free(r->files);
+  r->files = files;
+  r->nfiles = n;
+  return 0;
+}
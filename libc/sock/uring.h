@@ -0,0 +1,194 @@
+#ifndef COSMOPOLITAN_LIBC_SOCK_URING_H_
+#define COSMOPOLITAN_LIBC_SOCK_URING_H_
+#include "libc/calls/struct/iovec.h"
+
+#define URING_NOP         0
+#define URING_READV       1
+#define URING_WRITEV      2
+#define URING_FSYNC       3
+#define URING_READ_FIXED  4
+#define URING_WRITE_FIXED 5
+#define URING_ACCEPT      13
+#define URING_OPENAT      18
+#define URING_CLOSE       19
+#define URING_STATX       21
+#define URING_READ        22
+#define URING_WRITE       23
+#define URING_SEND        26
+#define URING_RECV        27
+
+#define URING_FIXED_FILE 0x01 /* sqe fd indexes uring_register_files() */
+#define URING_DRAIN      0x02 /* wait for prior sqes to complete first */
+#define URING_LINK       0x04 /* next sqe is cancelled unless this works */
+#define URING_HARDLINK   0x08 /* next sqe runs even if this one fails */
+
+#define URING_FSYNC_DATASYNC 1
+
+COSMOPOLITAN_C_START_
+
+/* submission queue entry (linux io_uring_sqe abi) */
+struct uring_sqe {
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;
+  int32_t fd;
+  uint64_t off;
+  uint64_t addr;
+  uint32_t len;
+  uint32_t op_flags;
+  uint64_t user_data;
+  uint16_t buf_index;
+  uint16_t personality;
+  int32_t file_index;
+  uint64_t addr3;
+  uint64_t __pad2;
+};
+
+/* completion queue entry (linux io_uring_cqe abi) */
+struct uring_cqe {
+  uint64_t user_data;
+  int32_t res; /* result of system call, or negative errno */
+  uint32_t flags;
+};
+
+/* linux statx() result */
+struct uring_statx {
+  uint32_t stx_mask;
+  uint32_t stx_blksize;
+  uint64_t stx_attributes;
+  uint32_t stx_nlink;
+  uint32_t stx_uid;
+  uint32_t stx_gid;
+  uint16_t stx_mode;
+  uint16_t __pad1;
+  uint64_t stx_ino;
+  uint64_t stx_size;
+  uint64_t stx_blocks;
+  uint64_t stx_attributes_mask;
+  struct {
+    int64_t tv_sec;
+    uint32_t tv_nsec;
+    int32_t __pad;
+  } stx_atime, stx_btime, stx_ctime, stx_mtime;
+  uint32_t stx_rdev_major;
+  uint32_t stx_rdev_minor;
+  uint32_t stx_dev_major;
+  uint32_t stx_dev_minor;
+  uint64_t __pad2[14];
+};
+
+#define URING_STATX_BASIC_STATS 0x000007ff
+
+struct uring;
+
+struct uring *uring_create(unsigned) libcesque;
+void uring_destroy(struct uring *) libcesque;
+bool uring_is_kernel(const struct uring *) libcesque;
+struct uring_sqe *uring_get_sqe(struct uring *) libcesque;
+int uring_submit(struct uring *, unsigned) libcesque;
+int uring_peek(struct uring *, struct uring_cqe **) libcesque;
+int uring_wait(struct uring *, struct uring_cqe **) libcesque;
+void uring_seen(struct uring *, struct uring_cqe *) libcesque;
+int uring_register_buffers(struct uring *, const struct iovec *,
+                           unsigned) libcesque;
+int uring_register_files(struct uring *, const int *, unsigned) libcesque;
+
+forceinline void uring_prep_rw(struct uring_sqe *sqe, int op, int fd,
+                               const void *addr, unsigned len,
+                               uint64_t off) {
+  *sqe = (struct uring_sqe){0};
+  sqe->opcode = op;
+  sqe->fd = fd;
+  sqe->off = off;
+  sqe->addr = (uintptr_t)addr;
+  sqe->len = len;
+}
+
+/* off may be -1 to use and update the current file position */
+forceinline void uring_prep_read(struct uring_sqe *sqe, int fd, void *buf,
+                                 unsigned len, int64_t off) {
+  uring_prep_rw(sqe, URING_READ, fd, buf, len, off);
+}
+
+forceinline void uring_prep_write(struct uring_sqe *sqe, int fd,
+                                  const void *buf, unsigned len,
+                                  int64_t off) {
+  uring_prep_rw(sqe, URING_WRITE, fd, buf, len, off);
+}
+
+forceinline void uring_prep_readv(struct uring_sqe *sqe, int fd,
+                                  const struct iovec *iov, unsigned iovlen,
+                                  int64_t off) {
+  uring_prep_rw(sqe, URING_READV, fd, iov, iovlen, off);
+}
+
+forceinline void uring_prep_writev(struct uring_sqe *sqe, int fd,
+                                   const struct iovec *iov, unsigned iovlen,
+                                   int64_t off) {
+  uring_prep_rw(sqe, URING_WRITEV, fd, iov, iovlen, off);
+}
+
+/* buf must be inside buffer `idx` passed to uring_register_buffers() */
+forceinline void uring_prep_read_fixed(struct uring_sqe *sqe, int fd,
+                                       void *buf, unsigned len, int64_t off,
+                                       int idx) {
+  uring_prep_rw(sqe, URING_READ_FIXED, fd, buf, len, off);
+  sqe->buf_index = idx;
+}
+
+forceinline void uring_prep_write_fixed(struct uring_sqe *sqe, int fd,
+                                        const void *buf, unsigned len,
+                                        int64_t off, int idx) {
+  uring_prep_rw(sqe, URING_WRITE_FIXED, fd, buf, len, off);
+  sqe->buf_index = idx;
+}
+
+forceinline void uring_prep_accept(struct uring_sqe *sqe, int fd,
+                                   void *addr, uint32_t *addrlen,
+                                   int flags) {
+  uring_prep_rw(sqe, URING_ACCEPT, fd, addr, 0, (uintptr_t)addrlen);
+  sqe->op_flags = flags;
+}
+
+forceinline void uring_prep_recv(struct uring_sqe *sqe, int fd, void *buf,
+                                 unsigned len, int flags) {
+  uring_prep_rw(sqe, URING_RECV, fd, buf, len, 0);
+  sqe->op_flags = flags;
+}
+
+forceinline void uring_prep_send(struct uring_sqe *sqe, int fd,
+                                 const void *buf, unsigned len, int flags) {
+  uring_prep_rw(sqe, URING_SEND, fd, buf, len, 0);
+  sqe->op_flags = flags;
+}
+
+forceinline void uring_prep_openat(struct uring_sqe *sqe, int dirfd,
+                                   const char *path, int flags,
+                                   unsigned mode) {
+  uring_prep_rw(sqe, URING_OPENAT, dirfd, path, mode, 0);
+  sqe->op_flags = flags;
+}
+
+forceinline void uring_prep_close(struct uring_sqe *sqe, int fd) {
+  uring_prep_rw(sqe, URING_CLOSE, fd, 0, 0, 0);
+}
+
+forceinline void uring_prep_statx(struct uring_sqe *sqe, int dirfd,
+                                  const char *path, int flags, unsigned mask,
+                                  struct uring_statx *st) {
+  uring_prep_rw(sqe, URING_STATX, dirfd, path, mask, (uintptr_t)st);
+  sqe->op_flags = flags;
+}
+
+forceinline void uring_prep_fsync(struct uring_sqe *sqe, int fd,
+                                  unsigned flags) {
+  uring_prep_rw(sqe, URING_FSYNC, fd, 0, 0, 0);
+  sqe->op_flags = flags;
+}
+
+forceinline void uring_prep_nop(struct uring_sqe *sqe) {
+  uring_prep_rw(sqe, URING_NOP, -1, 0, 0, 0);
+}
+
+COSMOPOLITAN_C_END_
+#endif /* COSMOPOLITAN_LIBC_SOCK_URING_H_ */
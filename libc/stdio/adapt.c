@@ -0,0 +1,73 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/calls/calls.h"
+#include "libc/intrin/weaken.h"
+#include "libc/macros.h"
+#include "libc/mem/mem.h"
+#include "libc/runtime/runtime.h"
+#include "libc/stdio/internal.h"
+
+/**
+ * Releases mapping that backs stream buffer.
+ *
+ * The file position is rewound past any unread content, so the stream
+ * continues at the same offset using its normal buffer.
+ */
+void __stdio_unmap(FILE *f) {
+  if (f->beg < f->end)
+    lseek(f->fd, -(int64_t)(f->end - f->beg), SEEK_CUR);
+  munmap(f->map, f->size);
+  f->map = 0;
+  f->buf = f->mem;
+  f->size = BUFSIZ;
+  f->beg = 0;
+  f->end = 0;
+}
+
+/**
+ * Adapts stream buffer before it's refilled.
+ *
+ * This is called by read functions whenever the buffer is empty and is
+ * about to be refilled from the file descriptor. A stream that's being
+ * consumed sequentially will have its buffer doubled every refill once
+ * it's had a few of them, up to `BUFMAX` bytes, which reduces the number
+ * of system calls. Streams that were opened in mapped mode fall back to
+ * normal buffering once the mapping is exhausted.
+ */
+void __stdio_adapt(FILE *f) {
+  char *b;
+  uint32_t n;
+  if (f->map) {
+    __stdio_unmap(f);
+    return;
+  }
+  if (f->bufmode != _IOFBF || f->nofree || f->size >= BUFMAX)
+    return;
+  if (++f->fills < 4)
+    return;
+  if (!_weaken(malloc) || !_weaken(free))
+    return;
+  n = MIN(f->size * 2, BUFMAX);
+  if (!(b = _weaken(malloc)(n)))
+    return;
+  if (f->buf != f->mem)
+    _weaken(free)(f->buf);
+  f->buf = b;
+  f->size = n;
+}
@@ -16,6 +16,7 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -25,7 +26,7 @@
  * @see clearerr_unlocked()
  */
 void clearerr(FILE *f) {
-  flockfile(f);
+  __stdio_lock(f);
   clearerr_unlocked(f);
-  funlockfile(f);
+  __stdio_unlock(f);
 }
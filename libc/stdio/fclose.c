@@ -38,7 +38,11 @@ int fclose(FILE *f) {
   if (!f)
     return 0;
   __fflush_unregister(f);
-  fflush(f);
+  if (f->map) {
+    __stdio_unmap(f);  // rewinds past unread content, like fflush()
+  } else {
+    fflush(f);
+  }
   if (_weaken(free)) {
     _weaken(free)(f->getln);
     if (!f->nofree && f->buf != f->mem) {
@@ -18,16 +18,51 @@
 ╚─────────────────────────────────────────────────────────────────────────────*/
 #include "libc/calls/calls.h"
 #include "libc/calls/struct/stat.h"
+#include "libc/intrin/weaken.h"
+#include "libc/limits.h"
+#include "libc/macros.h"
+#include "libc/mem/mem.h"
+#include "libc/runtime/runtime.h"
 #include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
+#include "libc/str/str.h"
+#include "libc/sysv/consts/map.h"
 #include "libc/sysv/consts/o.h"
+#include "libc/sysv/consts/prot.h"
 #include "libc/sysv/consts/s.h"
 #include "libc/sysv/errfuns.h"
 #include "libc/thread/thread.h"
 
+// maps read-only regular file so its content becomes the buffer
+static bool fdopen_map(FILE *f, struct stat *st) {
+  char *p;
+  int64_t pos;
+  if (st->st_size <= 0 || st->st_size > INT_MAX)
+    return false;
+  if ((pos = lseek(f->fd, 0, SEEK_CUR)) == -1 || pos >= st->st_size)
+    return false;
+  p = mmap(0, st->st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, f->fd, 0);
+  if (p == MAP_FAILED)
+    return false;
+  if (lseek(f->fd, st->st_size, SEEK_SET) == -1) {
+    munmap(p, st->st_size);
+    return false;
+  }
+  f->buf = f->map = p;
+  f->size = f->end = st->st_size;
+  f->beg = pos;
+  return true;
+}
+
 /**
  * Allocates stream object for already-opened file descriptor.
  *
+ * Regular files get a buffer sized to their `st_blksize`. If `mode`
+ * has `m` and the file is opened read-only, then its content will be
+ * memory mapped and used as the stream buffer, so functions like
+ * getc() and getline() read it without any system calls; the stream
+ * reverts to normal buffering after seeking or reaching the end.
+ *
  * @param fd existing file descriptor or -1 for plain old buffer
  * @param mode is passed to fopenflags()
  * @return new stream or NULL w/ errno
@@ -35,6 +70,8 @@
  */
 FILE *fdopen(int fd, const char *mode) {
   FILE *f;
+  char *b;
+  size_t n;
   struct stat st;
   if (fstat(fd, &st))
     return 0;
@@ -44,6 +81,16 @@ FILE *fdopen(int fd, const char *mode) {
     f->iomode = fopenflags(mode);
     f->buf = f->mem;
     f->size = BUFSIZ;
+    if (S_ISREG(st.st_mode)) {
+      if (strchr(mode, 'm') && (f->iomode & O_ACCMODE) == O_RDONLY &&
+          fdopen_map(f, &st)) {
+        // content is mapped
+      } else if (st.st_blksize > BUFSIZ && _weaken(malloc) &&
+                 (b = _weaken(malloc)((n = MIN(st.st_blksize, BUFMAX))))) {
+        f->buf = b;
+        f->size = n;
+      }
+    }
     if ((f->iomode & O_ACCMODE) != O_RDONLY) {
       __fflush_register(f);
     }
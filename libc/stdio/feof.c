@@ -16,6 +16,7 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -26,8 +27,8 @@
  */
 int feof(FILE *f) {
   int rc;
-  flockfile(f);
+  __stdio_lock(f);
   rc = feof_unlocked(f);
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
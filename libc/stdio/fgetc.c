@@ -16,6 +16,7 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -27,9 +28,9 @@
  */
 int fgetc(FILE *f) {
   int rc;
-  flockfile(f);
+  __stdio_lock(f);
   rc = fgetc_unlocked(f);
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
 
@@ -16,6 +16,7 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -27,9 +28,9 @@
  */
 wint_t fgetwc(FILE *f) {
   wint_t wc;
-  flockfile(f);
+  __stdio_lock(f);
   wc = fgetwc_unlocked(f);
-  funlockfile(f);
+  __stdio_unlock(f);
   return wc;
 }
 
@@ -16,6 +16,7 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -32,8 +33,8 @@
  */
 wchar_t *fgetws(wchar_t *s, int size, FILE *f) {
   wchar_t *rc;
-  flockfile(f);
+  __stdio_lock(f);
   rc = fgetws_unlocked(s, size, f);
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
@@ -58,8 +58,10 @@ static void __stdio_fork_parent(void) {
 static void __stdio_fork_child(void) {
   FILE *f;
   for (int i = __fflush.handles.i; i--;)
-    if ((f = __fflush.handles.p[i]))
+    if ((f = __fflush.handles.p[i])) {
       f->lock = (pthread_mutex_t)PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+      f->locks = 0;
+    }
   pthread_mutex_init(&__fflush_lock_obj, 0);
 }
 
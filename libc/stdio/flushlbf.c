@@ -31,11 +31,11 @@ void _flushlbf(void) {
   __fflush_lock();
   for (i = 0; i < __fflush.handles.i; ++i) {
     if ((f = __fflush.handles.p[i])) {
-      flockfile(f);
+      __stdio_lock(f);
       if (f->bufmode == _IOLBF) {
         fflush_unlocked(f);
       }
-      funlockfile(f);
+      __stdio_unlock(f);
     }
   }
   __fflush_unlock();
@@ -16,6 +16,7 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -25,10 +26,10 @@
 int fprintf(FILE *f, const char *fmt, ...) {
   int rc;
   va_list va;
-  flockfile(f);
+  __stdio_lock(f);
   va_start(va, fmt);
   rc = vfprintf_unlocked(f, fmt, va);
   va_end(va);
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
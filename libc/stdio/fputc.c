@@ -16,6 +16,7 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -26,9 +27,9 @@
  */
 int fputc(int c, FILE *f) {
   int rc;
-  flockfile(f);
+  __stdio_lock(f);
   rc = fputc_unlocked(c, f);
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
 
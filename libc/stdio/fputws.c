@@ -16,6 +16,7 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -31,8 +32,8 @@
  */
 int fputws(const wchar_t *s, FILE *f) {
   int rc;
-  flockfile(f);
+  __stdio_lock(f);
   rc = fputws_unlocked(s, f);
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
@@ -133,6 +133,9 @@ size_t fread_unlocked(void *buf, size_t stride, size_t count, FILE *f) {
   // `iov[1]` reads ahead extra content into buffer
   if (m)
     memcpy(p, f->buf + f->beg, m);
+  f->beg = 0;
+  f->end = 0;
+  __stdio_adapt(f);
   iov[0].iov_base = p + m;
   iov[0].iov_len = need = n - m;
   if (f->bufmode != _IONBF && n < f->size) {
@@ -42,8 +42,11 @@ FILE *freopen(const char *pathname, const char *mode, FILE *stream) {
   int fd, fd2;
   unsigned flags;
   flags = fopenflags(mode);
-  flockfile(stream);
+  __stdio_lock(stream);
   fflush_unlocked(stream);
+  if (stream->map)
+    __stdio_unmap(stream);
+  stream->fills = 0;
   if (pathname) {
     /* open new stream, overwriting existing alloc */
     if ((fd = open(pathname, flags, 0666)) != -1) {
@@ -72,6 +75,6 @@ FILE *freopen(const char *pathname, const char *mode, FILE *stream) {
       res = NULL;
     }
   }
-  funlockfile(stream);
+  __stdio_unlock(stream);
   return res;
 }
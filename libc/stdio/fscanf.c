@@ -17,6 +17,7 @@
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
 #include "libc/fmt/internal.h"
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -38,11 +39,11 @@ int fscanf(FILE *stream, const char *fmt, ...) {
   int rc;
   va_list va;
   va_start(va, fmt);
-  flockfile(stream);
+  __stdio_lock(stream);
   rc = __vcscanf((void *)fgetc_unlocked,   //
                  (void *)ungetc_unlocked,  //
                  stream, fmt, va);
-  funlockfile(stream);
+  __stdio_unlock(stream);
   va_end(va);
   return rc;
 }
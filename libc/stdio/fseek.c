@@ -35,11 +35,11 @@
  */
 int fseek(FILE *f, int64_t offset, int whence) {
   int rc;
-  flockfile(f);
+  __stdio_lock(f);
   rc = fseek_unlocked(f, offset, whence);
   STDIOTRACE("fseek(%p, %'ld, %s) → %d %s", f, offset, DescribeWhence(whence),
              rc, DescribeStdioState(f->state));
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
 
@@ -40,6 +40,16 @@ int fseek_unlocked(FILE *f, int64_t offset, int whence) {
   int res;
   int64_t pos;
   if (f->fd != -1) {
+    f->fills = 0;
+    if (f->map && f->end && (whence == SEEK_SET || whence == SEEK_CUR)) {
+      // buffer holds file from offset zero so we don't need lseek()
+      pos = whence == SEEK_SET ? offset : f->beg + offset;
+      if (0 <= pos && pos <= f->end) {
+        f->beg = pos;
+        f->state = 0;
+        return 0;
+      }
+    }
     if (__fflush_impl(f) == -1)
       return -1;
     if (whence == SEEK_CUR && f->beg < f->end) {
@@ -25,7 +25,9 @@
 
 static inline int64_t ftell_unlocked(FILE *f) {
   int64_t pos;
-  if (f->fd != -1) {
+  if (f->map && f->end) {
+    return f->beg;  // buffer holds file from offset zero
+  } else if (f->fd != -1) {
     if (__fflush_impl(f) == -1)
       return -1;
     if ((pos = lseek(f->fd, 0, SEEK_CUR)) != -1) {
@@ -49,9 +51,9 @@ static inline int64_t ftell_unlocked(FILE *f) {
  */
 int64_t ftell(FILE *f) {
   int64_t rc;
-  flockfile(f);
+  __stdio_lock(f);
   rc = ftell_unlocked(f);
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
 
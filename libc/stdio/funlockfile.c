@@ -16,8 +16,11 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/calls/calls.h"
+#include "libc/intrin/atomic.h"
 #include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
+#include "libc/thread/lock.h"
 #include "libc/thread/thread.h"
 
 /**
@@ -26,3 +29,15 @@
 void funlockfile(FILE *f) {
   pthread_mutex_unlock(&f->lock);
 }
+
+void __stdio_unlock_impl(FILE *f) {
+  uint64_t word;
+  // our __stdio_lock() might have been elided, if the first thread was
+  // created while a stdio function was running, e.g. by a signal handler
+  // in which case the locks count could belong to another thread's hold
+  word = atomic_load_explicit(&f->lock._word, memory_order_relaxed);
+  if (MUTEX_OWNER(word) != gettid())
+    return;
+  --f->locks;
+  pthread_mutex_unlock(&f->lock);
+}
@@ -29,10 +29,10 @@
  */
 size_t fwrite(const void *data, size_t stride, size_t count, FILE *f) {
   size_t rc;
-  flockfile(f);
+  __stdio_lock(f);
   rc = fwrite_unlocked(data, stride, count, f);
   STDIOTRACE("fwrite(%p, %'zu, %'zu, %p) → %'zu %s", data, stride, count, f, rc,
              DescribeStdioState(f->state));
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
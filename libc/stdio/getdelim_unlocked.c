@@ -67,7 +67,7 @@ ssize_t getdelim_unlocked(char **s, size_t *n, int delim, FILE *f) {
       return i + m;
     } else if (f->fd == -1) {
       break;
-    } else if ((rc = read(f->fd, f->buf, f->size)) != -1) {
+    } else if (__stdio_adapt(f), (rc = read(f->fd, f->buf, f->size)) != -1) {
       if (!rc)
         break;
       f->end = rc;
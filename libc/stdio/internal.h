@@ -2,8 +2,10 @@
 #define COSMOPOLITAN_LIBC_STDIO_INTERNAL_H_
 #include "libc/stdio/stdio.h"
 #include "libc/thread/thread.h"
+#include "libc/thread/tls.h"
 
 #define PUSHBACK 12
+#define BUFMAX   65536
 
 COSMOPOLITAN_C_START_
 
@@ -19,9 +21,12 @@ struct FILE {
   char *buf;
   uint32_t size;
   uint32_t nofree;
+  uint32_t fills;  /* sequential buffer refills since open or seek */
+  char *map;       /* if buf is a private mapping of the whole file */
   int pid;
   char *getln;
   pthread_mutex_t lock;
+  uint32_t locks;  /* times __stdio_lock() took lock and still holds it */
   struct FILE *next;
   char mem[BUFSIZ];
 };
@@ -34,6 +39,22 @@ void __fflush_unregister(FILE *);
 bool __stdio_isok(FILE *);
 FILE *__stdio_alloc(void);
 void __stdio_free(FILE *);
+void __stdio_adapt(FILE *);
+void __stdio_unmap(FILE *);
+void __stdio_unlock_impl(FILE *);
+
+/* stdio functions skip locking until the first thread is created */
+forceinline void __stdio_lock(FILE *f) {
+  if (__isthreaded) {
+    flockfile(f);
+    ++f->locks;
+  }
+}
+
+forceinline void __stdio_unlock(FILE *f) {
+  if (f->locks)
+    __stdio_unlock_impl(f);
+}
 
 COSMOPOLITAN_C_END_
 #endif /* COSMOPOLITAN_LIBC_STDIO_INTERNAL_H_ */
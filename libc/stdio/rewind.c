@@ -27,8 +27,8 @@
  * EOF state, without reopening it.
  */
 void rewind(FILE *f) {
-  flockfile(f);
+  __stdio_lock(f);
   fseek_unlocked(f, 0, SEEK_SET);
   f->state = 0;
-  funlockfile(f);
+  __stdio_unlock(f);
 }
@@ -18,6 +18,7 @@
 ╚─────────────────────────────────────────────────────────────────────────────*/
 #include "libc/intrin/fds.h"
 #include "libc/fmt/internal.h"
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -28,11 +29,11 @@ int scanf(const char *fmt, ...) {
   int rc;
   va_list va;
   va_start(va, fmt);
-  flockfile(stdin);
+  __stdio_lock(stdin);
   rc = __vcscanf((void *)fgetc_unlocked,   //
                  (void *)ungetc_unlocked,  //
                  stdin, fmt, va);
-  funlockfile(stdin);
+  __stdio_unlock(stdin);
   va_end(va);
   return rc;
 }
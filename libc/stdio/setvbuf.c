@@ -34,10 +34,12 @@
  * @return 0 on success or -1 on error
  */
 int setvbuf(FILE *f, char *buf, int mode, size_t size) {
-  flockfile(f);
+  __stdio_lock(f);
   if (buf) {
     if (!size)
       size = BUFSIZ;
+    if (f->map)
+      __stdio_unmap(f);
     if (!f->nofree &&        //
         f->buf != buf &&     //
         f->buf != f->mem &&  //
@@ -49,6 +51,6 @@ int setvbuf(FILE *f, char *buf, int mode, size_t size) {
     f->nofree = true;
   }
   f->bufmode = mode;
-  funlockfile(f);
+  __stdio_unlock(f);
   return 0;
 }
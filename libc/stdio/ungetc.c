@@ -16,6 +16,7 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -23,8 +24,8 @@
  */
 int ungetc(int c, FILE *f) {
   int rc;
-  flockfile(f);
+  __stdio_lock(f);
   rc = ungetc_unlocked(c, f);
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
@@ -26,6 +26,9 @@
 int ungetc_unlocked(int c, FILE *f) {
   if (c == -1)
     return -1;
+  // a mapped buffer holds the file itself which fseek() may return to
+  if (f->map && (!f->beg || (c & 255) != (f->buf[f->beg - 1] & 255)))
+    __stdio_unmap(f);
   if (f->beg) {
     if (c != f->buf[--f->beg]) {
       f->buf[f->beg] = c;
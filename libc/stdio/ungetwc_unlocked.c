@@ -34,6 +34,9 @@ wint_t ungetwc_unlocked(wint_t c, FILE *f) {
   do {
     b[n++] = w;
   } while ((w >>= 8));
+  // a mapped buffer holds the file itself which fseek() may return to
+  if (f->map && (f->beg < n || memcmp(f->buf + f->beg - n, b, n)))
+    __stdio_unmap(f);
   if (f->beg >= n) {
     f->beg -= n;
     memcpy(f->buf + f->beg, b, n);
@@ -16,6 +16,7 @@
 │ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -24,8 +25,8 @@
  */
 int vfprintf(FILE *f, const char *fmt, va_list va) {
   int rc;
-  flockfile(f);
+  __stdio_lock(f);
   rc = vfprintf_unlocked(f, fmt, va);
-  funlockfile(f);
+  __stdio_unlock(f);
   return rc;
 }
@@ -17,6 +17,7 @@
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
 #include "libc/fmt/internal.h"
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -25,10 +26,10 @@
  */
 int vfscanf(FILE *stream, const char *fmt, va_list ap) {
   int rc;
-  flockfile(stream);
+  __stdio_lock(stream);
   rc = __vcscanf((void *)fgetc_unlocked,   //
                  (void *)ungetc_unlocked,  //
                  stream, fmt, ap);
-  funlockfile(stream);
+  __stdio_unlock(stream);
   return rc;
 }
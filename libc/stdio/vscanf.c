@@ -17,6 +17,7 @@
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
 #include "libc/fmt/internal.h"
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
 
 /**
@@ -25,10 +26,10 @@
  */
 int vscanf(const char *fmt, va_list ap) {
   int rc;
-  flockfile(stdin);
+  __stdio_lock(stdin);
   rc = __vcscanf((void *)fgetc_unlocked,   //
                  (void *)ungetc_unlocked,  //
                  stdin, fmt, ap);
-  flockfile(stdout);
+  __stdio_lock(stdout);
   return rc;
 }
@@ -705,6 +705,12 @@ syscon	tcp	TCP_REPAIR_OPTIONS			22			22			0			0			0			0			0			0			# what is it
 syscon	tcp	TCP_REPAIR_QUEUE			20			20			0			0			0			0			0			0			# what is it
 syscon	tcp	TCP_THIN_LINEAR_TIMEOUTS		16			16			0			0			0			0			0			0			# what is it
 
+#	{set,get}sockopt(fd, level=SOL_UDP, X, ...)
+#
+#	group	name					GNU/Systemd		GNU/Systemd (Aarch64)	XNU's Not UNIX!		MacOS (Arm64)		FreeBSD			OpenBSD			NetBSD			The New Technology	Commentary
+syscon	udp	UDP_SEGMENT				103			103			0			0			0			0			0			2			# segmentation offload; one big sendmsg() becomes many datagrams of this size; Linux 4.18+; UDP_SEND_MSG_SIZE on Windows
+syscon	udp	UDP_GRO					104			104			0			0			0			0			0			0			# receive offload; recvmsg() may coalesce datagrams and says the segment size in a SOL_UDP/UDP_GRO cmsg; Linux 5.0+
+
 #	IPPROTO_IP (or SOL_IP) socket options
 #
 #	group	name					GNU/Systemd		GNU/Systemd (Aarch64)	XNU's Not UNIX!		MacOS (Arm64)		FreeBSD			OpenBSD			NetBSD			The New Technology	Commentary
@@ -1144,6 +1150,7 @@ syscon	msg	MSG_NOSIGNAL				0x4000			0x4000			0x80000			0x80000			0x020000		0x040
 syscon	msg	MSG_TRUNC				0x20			0x20			0x10			0x10			0x10			0x10			0x10			0x0100			# bsd consensus
 syscon	msg	MSG_CTRUNC				8			8			0x20			0x20			0x20			0x20			0x20			0x0200			# bsd consensus
 syscon	msg	MSG_FASTOPEN				0x20000000		0x20000000		-1			-1			-1			-1			-1			-1			#
+syscon	msg	MSG_WAITFORONE				0x10000			0x10000			0x40000000		0x40000000		0x80000			0x1000			0x2000			0x40000000		# recvmmsg: stop blocking once a message has arrived; emulated outside linux
 
 #	getpriority() / setpriority() magnums (a.k.a. nice)
 #
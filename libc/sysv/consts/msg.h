@@ -8,15 +8,17 @@ extern const int MSG_NOSIGNAL;
 extern const int MSG_TRUNC;
 extern const int MSG_CTRUNC;
 extern const int MSG_FASTOPEN; /* linux only */
+extern const int MSG_WAITFORONE;
 
-#define MSG_OOB       1
-#define MSG_PEEK      2
-#define MSG_DONTROUTE 4
-#define MSG_DONTWAIT  MSG_DONTWAIT
-#define MSG_NOSIGNAL  MSG_NOSIGNAL
-#define MSG_WAITALL   MSG_WAITALL
-#define MSG_TRUNC     MSG_TRUNC
-#define MSG_CTRUNC    MSG_CTRUNC
+#define MSG_OOB        1
+#define MSG_PEEK       2
+#define MSG_DONTROUTE  4
+#define MSG_DONTWAIT   MSG_DONTWAIT
+#define MSG_NOSIGNAL   MSG_NOSIGNAL
+#define MSG_WAITALL    MSG_WAITALL
+#define MSG_TRUNC      MSG_TRUNC
+#define MSG_CTRUNC     MSG_CTRUNC
+#define MSG_WAITFORONE MSG_WAITFORONE
 
 COSMOPOLITAN_C_END_
 #endif /* COSMOPOLITAN_LIBC_SYSV_CONSTS_MSG_H_ */
@@ -0,0 +1,12 @@
+#ifndef COSMOPOLITAN_LIBC_SYSV_CONSTS_UDP_H_
+#define COSMOPOLITAN_LIBC_SYSV_CONSTS_UDP_H_
+COSMOPOLITAN_C_START_
+
+extern const int UDP_GRO;
+extern const int UDP_SEGMENT;
+
+#define UDP_GRO     UDP_GRO
+#define UDP_SEGMENT UDP_SEGMENT
+
+COSMOPOLITAN_C_END_
+#endif /* COSMOPOLITAN_LIBC_SYSV_CONSTS_UDP_H_ */
@@ -321,7 +321,7 @@ scall	sys_name_to_handle_at	0xfffffffffffff12f	0x108	globl
 scall	sys_open_by_handle_at	0xfffffffffffff130	0x109	globl
 scall	sys_clock_adjtime	0xfffffffffffff131	0x10a	globl # no wrapper
 scall	sys_syncfs		0xfffffffffffff132	0x10b	globl # no wrapper
-#scall	sendmmsg		0x1dcffffffffff133	0x10d	globl
+scall	sys_sendmmsg		0x1dcffffffffff133	0x10d	globl
 scall	sys_setns		0xfffffffffffff134	0x10c	globl # no wrapper
 scall	sys_getcpu		0xfffffffffffff135	0x0a8	globl # no wrapper
 scall	sys_process_vm_readv	0xfffffffffffff136	0x10e	globl # no wrapper
@@ -0,0 +1,102 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/thread/percpu.h"
+#include "libc/calls/calls.h"
+#include "libc/calls/struct/cpuset.h"
+#include "libc/errno.h"
+#include "libc/intrin/atomic.h"
+#include "libc/intrin/rseq.h"
+
+// picks one of the shards that restartable sequences never write, for
+// cpus numbered past those that own shards, or threads lacking rseq
+static unsigned percpu_fallback(int cpu) {
+  int e;
+  if (cpu < 0) {
+    e = errno;
+    if ((cpu = sched_getcpu()) == -1) {
+      errno = e;
+      cpu = gettid();
+    }
+  }
+  return PERCPU_SHARDS + (unsigned)cpu % (PERCPU_SLOTS - PERCPU_SHARDS);
+}
+
+/**
+ * Adds `x` to current cpu's shard of per-cpu array.
+ *
+ * The memory at `p` is an array of `PERCPU_SLOTS` shards that are
+ * `stride` bytes apart, where `p` points to the word being incremented
+ * in the first shard. Shards should be padded to the cache line size.
+ *
+ * On Linux this goes fast by using a restartable sequence, in which no
+ * atomic instruction is needed since the kernel won't let anyone else
+ * run on our cpu until the addition is committed. This also works when
+ * the shards live in a `MAP_SHARED` mapping used by forked processes.
+ * On other platforms an uncontended relaxed atomic add is performed.
+ *
+ * @param p is address of word in first shard
+ * @param stride is distance in bytes between shards
+ * @param x is value to add
+ * @see percpu_sum()
+ */
+void percpu_add(long *p, unsigned long stride, long x) {
+  int cpu;
+  while ((unsigned)(cpu = __rseq_cpu()) < PERCPU_SHARDS)
+    if (!__rseq_addv(&__rseq, (long *)((char *)p + cpu * stride), x, cpu))
+      return;
+  atomic_fetch_add_explicit(
+      (_Atomic(long) *)((char *)p + percpu_fallback(cpu) * stride), x,
+      memory_order_relaxed);
+}
+
+/**
+ * Returns sum of word across all shards of per-cpu array.
+ *
+ * @param p is address of word in first shard
+ * @param stride is distance in bytes between shards
+ * @see percpu_add()
+ */
+long percpu_sum(const long *p, unsigned long stride) {
+  long sum = 0;
+  for (unsigned i = 0; i < PERCPU_SLOTS; ++i)
+    sum += atomic_load_explicit(
+        (const _Atomic(long) *)((const char *)p + i * stride),
+        memory_order_relaxed);
+  return sum;
+}
+
+/**
+ * Returns sums of `n` consecutive words across all shards of per-cpu
+ * array, which is useful for aggregating a struct of counters at once.
+ *
+ * @param sums receives `n` totals
+ * @param p is address of first word in first shard
+ * @param n is number of words to sum
+ * @param stride is distance in bytes between shards
+ */
+void percpu_sums(long *sums, const long *p, unsigned long n,
+                 unsigned long stride) {
+  for (unsigned long j = 0; j < n; ++j)
+    sums[j] = 0;
+  for (unsigned i = 0; i < PERCPU_SLOTS; ++i)
+    for (unsigned long j = 0; j < n; ++j)
+      sums[j] += atomic_load_explicit(
+          (const _Atomic(long) *)((const char *)p + i * stride) + j,
+          memory_order_relaxed);
+}
@@ -0,0 +1,61 @@
+#ifndef COSMOPOLITAN_LIBC_THREAD_PERCPU_H_
+#define COSMOPOLITAN_LIBC_THREAD_PERCPU_H_
+
+/* shards [0,PERCPU_SHARDS) belong to cpus, and the rest are shared by
+   higher numbered cpus and threads that can't use restartable sequences */
+#define PERCPU_SHARDS 64
+#define PERCPU_SLOTS  (PERCPU_SHARDS + 16)
+
+#if !(__ASSEMBLER__ + __LINKER__ + 0)
+COSMOPOLITAN_C_START_
+
+struct percpu_counter {
+  struct {
+    long __value;
+  } __attribute__((__aligned__(64))) __shards[PERCPU_SLOTS];
+};
+
+void percpu_add(long *, unsigned long, long) libcesque;
+long percpu_sum(const long *, unsigned long) libcesque;
+void percpu_sums(long *, const long *, unsigned long, unsigned long) libcesque;
+
+/**
+ * Adds `x` to `member` of array of `PERCPU_SLOTS` structs, e.g.
+ *
+ *     struct Stats {
+ *       long requests;
+ *       long errors;
+ *     } __attribute__((__aligned__(64))) stats[PERCPU_SLOTS];
+ *
+ *     PERCPU_ADD(stats, requests, 1);
+ *     printf("%ld\n", PERCPU_SUM(stats, requests));
+ *
+ * The array may be placed in a `MAP_SHARED` mapping so that counters
+ * are shared by forked worker processes.
+ */
+#define PERCPU_ADD(shards, member, x) \
+  percpu_add(&(shards)[0].member, sizeof((shards)[0]), x)
+
+/**
+ * Returns sum of `member` across array of per-cpu structs.
+ */
+#define PERCPU_SUM(shards, member) \
+  percpu_sum(&(shards)[0].member, sizeof((shards)[0]))
+
+/**
+ * Adds `x` to scalable counter.
+ */
+forceinline void percpu_counter_add(struct percpu_counter *c, long x) {
+  percpu_add(&c->__shards[0].__value, sizeof(c->__shards[0]), x);
+}
+
+/**
+ * Returns sum of all shards in scalable counter.
+ */
+forceinline long percpu_counter_get(const struct percpu_counter *c) {
+  return percpu_sum(&c->__shards[0].__value, sizeof(c->__shards[0]));
+}
+
+COSMOPOLITAN_C_END_
+#endif /* !(__ASSEMBLER__ + __LINKER__ + 0) */
+#endif /* COSMOPOLITAN_LIBC_THREAD_PERCPU_H_ */
@@ -40,6 +40,12 @@ __static_yoink("nsync_mu_trylock");
  * This function has no effect if there aren't any threads currently
  * waiting on the condition.
  *
+ * When the associated mutex is a normal process private mutex, only
+ * one waiter is woken, and the others are moved onto the wait queue
+ * of the mutex, so they're woken one at a time as it gets released.
+ * This avoids a thundering herd, regardless of whether the caller is
+ * holding the mutex when broadcasting.
+ *
  * @return 0 on success, or errno on error
  * @see pthread_cond_signal
  * @see pthread_cond_wait
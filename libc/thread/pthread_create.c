@@ -29,6 +29,7 @@
 #include "libc/intrin/describeflags.h"
 #include "libc/intrin/dll.h"
 #include "libc/intrin/kprintf.h"
+#include "libc/intrin/rseq.h"
 #include "libc/intrin/strace.h"
 #include "libc/intrin/weaken.h"
 #include "libc/log/internal.h"
@@ -158,6 +159,11 @@ static int PosixThread(void *arg, int tid) {
     _weaken(_pthread_reschedule)(pt);  // yoinked by attribute builder
   }
 
+  // tell linux where to publish our cpu number, if anything reads it,
+  // e.g. malloc() picking its arena or the per-cpu counter apis
+  if (_weaken(__rseq_register))
+    _weaken(__rseq_register)();
+
   // setup signal stack
   if (pt->pt_attr.__sigaltstacksize) {
     struct sigaltstack ss;
@@ -45,10 +45,10 @@ COSMOPOLITAN_C_START_
 #define PTHREAD_RWLOCK_INITIALIZER {0}
 #define PTHREAD_MUTEX_INITIALIZER  {0}
 
-#define PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP {0, {}, PTHREAD_MUTEX_RECURSIVE}
+#define PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP {{}, {}, PTHREAD_MUTEX_RECURSIVE}
 
 #define PTHREAD_SIGNAL_SAFE_MUTEX_INITIALIZER_NP \
-  {0, {}, PTHREAD_MUTEX_RECURSIVE | PTHREAD_PROCESS_SHARED}
+  {{}, {}, PTHREAD_MUTEX_RECURSIVE | PTHREAD_PROCESS_SHARED}
 
 #ifndef __cplusplus
 #define _PTHREAD_ATOMIC(x) _Atomic(x)
@@ -72,7 +72,10 @@ typedef struct pthread_spinlock_s {
 } pthread_spinlock_t;
 
 typedef struct pthread_mutex_s {
-  uint32_t _nsync;
+  union {
+    uint32_t _nsync;
+    _PTHREAD_ATOMIC(uint32_t) _spins;
+  };
   union {
     int32_t _pid;
     _PTHREAD_ATOMIC(int32_t) _futex;
@@ -42,6 +42,7 @@ struct CosmoTib {
   _Atomic(void *) tib_keys[46];
 } __attribute__((__aligned__(64)));
 
+extern bool __isthreaded;
 extern char __tls_morphed;
 extern unsigned __tls_index;
 
@@ -59,12 +59,14 @@
 #define kZipEra1989 10 /* PKZIP 1.0 */
 #define kZipEra1993 20 /* PKZIP 2.0: deflate/subdir/etc. support */
 #define kZipEra2001 45 /* PKZIP 4.5: kZipExtraZip64 support */
+#define kZipEra2020 63 /* PKZIP 6.3.7: kZipCompressionZstd support */
 
 #define kZipIattrBinary 0 /* first bit not set */
 #define kZipIattrText   1 /* first bit set */
 
 #define kZipCompressionNone    0
 #define kZipCompressionDeflate 8
+#define kZipCompressionZstd    93
 
 #define kZipCdirHdrMagic            ZM_(0x06054b50) /* PK♣♠ "PK\5\6" */
 #define kZipCdirHdrMagicTodo        ZM_(0x19184b50) /* PK♣♠ "PK\30\31" */
@@ -107,6 +109,7 @@
 #define kZipLfileOffsetLastmodifieddate  12
 #define kZipLfileOffsetCrc32             14
 #define kZipLfileOffsetNamesize          26
+#define kZipLfileOffsetExtrasize         28
 #define kZipLfileOffsetCompressedsize    18
 #define kZipLfileOffsetUncompressedsize  22
 
@@ -118,6 +121,7 @@
 #define kZipExtraUnix                0x000d
 #define kZipExtraExtendedTimestamp   0x5455
 #define kZipExtraInfoZipNewUnixExtra 0x7875
+#define kZipExtraAlign               0xd935 /* android zipalign padding */
 
 #define kZipCfileMagic "PK\001\002"
 
@@ -257,7 +261,7 @@
 #define ZIP_LFILE_UNCOMPRESSEDSIZE(P) \
   ZIP_READ32((P) + kZipLfileOffsetUncompressedsize)
 #define ZIP_LFILE_NAMESIZE(P)  ZIP_READ16((P) + kZipLfileOffsetNamesize)
-#define ZIP_LFILE_EXTRASIZE(P) ZIP_READ16((P) + 28)
+#define ZIP_LFILE_EXTRASIZE(P) ZIP_READ16((P) + kZipLfileOffsetExtrasize)
 #define ZIP_LFILE_NAME(P)      ((const char *)((P) + 30))
 #define ZIP_LFILE_EXTRA(P)     ((P) + 30 + ZIP_LFILE_NAMESIZE(P))
 #define ZIP_LFILE_HDRSIZE(P) \
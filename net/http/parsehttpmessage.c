@@ -30,6 +30,32 @@
 #include "libc/x/x.h"
 #include "net/http/http.h"
 
+#define PMOVMSKB(x) __builtin_ia32_pmovmskb128(x)
+
+typedef char xmm_t __attribute__((__vector_size__(16), __aligned__(1)));
+
+/**
+ * Returns length of prefix with no byte that'd make the parser stop.
+ *
+ * Such bytes are C0 and C1 control codes (including CR, LF and tab) as
+ * well as anything under `lo`. This is how the field loops below go
+ * sixteen bytes at a time, since a typical value or URI will have its
+ * terminating CR or space found by the very first call.
+ */
+static inline size_t SkipHttpText(const char *p, size_t n, char lo) {
+  size_t i = 0;
+#if defined(__x86_64__) && !defined(__chibicc__)
+  xmm_t v;
+  unsigned m;
+  for (; i + 16 <= n; i += 16) {
+    v = *(xmm_t *)(p + i);
+    if ((m = PMOVMSKB(((v >= 0) & (v < lo)) | (v == 127) | (v < -96))))
+      return i + __builtin_ctz(m);
+  }
+#endif
+  return i;
+}
+
 /**
  * Initializes HTTP message parser.
  */
@@ -96,7 +122,9 @@ void ResetHttpMessage(struct HttpMessage *r, int type) {
  *
  * This parser takes about 400 nanoseconds to parse a 403 byte Chrome
  * HTTP request under MODE=rel on a Core i9 which is about three cycles
- * per byte or a gigabyte per second of throughput per core.
+ * per byte or a gigabyte per second of throughput per core. On x86-64
+ * the URI, status message, and header values are scanned with SSE2 so
+ * their bytes are only considered one at a time near the ends.
  *
  * @param p needs to have at least `c` bytes available
  * @param n is how many bytes have been received off the network so far
@@ -164,6 +192,7 @@ int ParseHttpMessage(struct HttpMessage *r, const char *p, size_t n, size_t c) {
           } else if (ch < 0x20 || (0x7F <= ch && ch < 0xA0)) {
             return ebadmsg();
           }
+          r->i += SkipHttpText(p + r->i + 1, n - r->i - 1, ' ' + 1);
           if (++r->i == n)
             break;
           ch = p[r->i] & 255;
@@ -220,6 +249,7 @@ int ParseHttpMessage(struct HttpMessage *r, const char *p, size_t n, size_t c) {
           } else if (ch < 0x20 || (0x7F <= ch && ch < 0xA0)) {
             return ebadmsg();
           }
+          r->i += SkipHttpText(p + r->i + 1, n - r->i - 1, ' ');
           if (++r->i == n)
             break;
           ch = p[r->i] & 255;
@@ -303,6 +333,7 @@ int ParseHttpMessage(struct HttpMessage *r, const char *p, size_t n, size_t c) {
           } else if ((ch < 0x20 && ch != '\t') || (0x7F <= ch && ch < 0xA0)) {
             return ebadmsg();
           }
+          r->i += SkipHttpText(p + r->i + 1, n - r->i - 1, ' ');
           if (++r->i == n)
             break;
           ch = p[r->i] & 255;
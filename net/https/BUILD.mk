@@ -28,6 +28,7 @@ NET_HTTPS_A_DIRECTDEPS =			\
 	LIBC_MEM				\
 	LIBC_NEXGEN32E				\
 	LIBC_RUNTIME				\
+	LIBC_SOCK				\
 	LIBC_STDIO				\
 	LIBC_STR				\
 	LIBC_SYSV				\
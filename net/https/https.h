@@ -5,6 +5,7 @@
 #include "third_party/mbedtls/ecp.h"
 #include "third_party/mbedtls/md.h"
 #include "third_party/mbedtls/pk.h"
+#include "third_party/mbedtls/ssl.h"
 #include "third_party/mbedtls/ssl_ciphersuites.h"
 #include "third_party/mbedtls/x509_crt.h"
 COSMOPOLITAN_C_START_
@@ -14,6 +15,13 @@ struct Cert {
   mbedtls_pk_context *key;
 };
 
+struct KernelTls {
+  unsigned char keylen;
+  unsigned char ivlen;
+  unsigned char key[2][32];  // client then server
+  unsigned char iv[2][12];   // client then server
+};
+
 char *GetTlsError(int);
 char *DescribeSslVerifyFailure(int);
 mbedtls_x509_crt *GetSslRoots(void);
@@ -30,6 +38,10 @@ bool CertHasIp(const mbedtls_x509_crt *, uint32_t);
 bool CertHasHost(const mbedtls_x509_crt *, const void *, size_t);
 bool IsServerCert(const struct Cert *, mbedtls_pk_type_t);
 void TlsDebug(void *, int, const char *, int, const char *);
+int ExportKernelTlsKeys(void *, const unsigned char *, const unsigned char *,
+                        size_t, size_t, size_t);
+bool EnableKernelTls(int, const mbedtls_ssl_context *, struct KernelTls *);
+int CloseKernelTls(int);
 
 int GenerateHardRandom(void *, unsigned char *, size_t);
 void GenerateCertificateSerial(mbedtls_x509write_cert *);
@@ -0,0 +1,145 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/dce.h"
+#include "libc/errno.h"
+#include "libc/serialize.h"
+#include "libc/sock/sock.h"
+#include "libc/sock/struct/cmsghdr.h"
+#include "libc/sock/struct/msghdr.h"
+#include "libc/str/str.h"
+#include "libc/sysv/consts/ipproto.h"
+#include "libc/sysv/consts/tcp.h"
+#include "net/https/https.h"
+#include "third_party/mbedtls/platform.h"
+
+// linux abi from <linux/tls.h>
+#define SOL_TLS                      282
+#define TLS_TX                       1
+#define TLS_SET_RECORD_TYPE          1
+#define TLS_1_2_VERSION              0x0303
+#define TLS_CIPHER_AES_GCM_128       51
+#define TLS_CIPHER_AES_GCM_256       52
+#define TLS_CIPHER_CHACHA20_POLY1305 54
+
+/**
+ * Remembers key block of TLS connection for EnableKernelTls().
+ *
+ * This is an `mbedtls_ssl_export_keys_t` callback, which is invoked at
+ * the end of each handshake. Only AEAD ciphers with 256-bit (or less)
+ * keys are recorded, since those are the only ones Linux can take.
+ *
+ * @param arg is the `struct KernelTls` to populate
+ */
+int ExportKernelTlsKeys(void *arg, const unsigned char *ms,
+                        const unsigned char *kb, size_t maclen, size_t keylen,
+                        size_t ivlen) {
+  struct KernelTls *k = arg;
+  bzero(k, sizeof(*k));
+  if (!maclen && keylen <= sizeof(k->key[0]) && ivlen <= sizeof(k->iv[0])) {
+    memcpy(k->key[0], kb, keylen);
+    memcpy(k->key[1], kb + keylen, keylen);
+    memcpy(k->iv[0], kb + keylen * 2, ivlen);
+    memcpy(k->iv[1], kb + keylen * 2 + ivlen, ivlen);
+    k->keylen = keylen;
+    k->ivlen = ivlen;
+  }
+  return 0;
+}
+
+/**
+ * Hands encryption of outgoing TLS records over to the Linux kernel.
+ *
+ * Once this succeeds, plaintext written to `fd` is sent as application
+ * data records, which means sendfile() may be used, and mbedtls must
+ * no longer be used to write to the connection. Decryption of incoming
+ * records is still the responsibility of mbedtls.
+ *
+ * This only works on Linux 4.13+ with the tls module loaded, when TLS
+ * v1.2 negotiated AES-GCM or ChaCha20-Poly1305. Keys are wiped.
+ *
+ * @param fd is socket that just completed handshake `ssl`
+ * @param k was populated by ExportKernelTlsKeys() during handshake
+ * @return true if kernel is now encrypting, otherwise connection should
+ *     keep going through mbedtls, as if this function were never called
+ */
+bool EnableKernelTls(int fd, const mbedtls_ssl_context *ssl,
+                     struct KernelTls *k) {
+  int e, s;
+  bool ok;
+  unsigned char *p, b[4 + 12 + 32 + 4 + 8];
+  const mbedtls_ssl_ciphersuite_t *cs;
+  ok = false;
+  e = errno;
+  s = ssl->conf->endpoint == MBEDTLS_SSL_IS_SERVER;
+  if (IsLinux() && k->keylen && ssl->minor_ver == MBEDTLS_SSL_MINOR_VERSION_3 &&
+      (cs = mbedtls_ssl_ciphersuite_from_id(ssl->session->ciphersuite))) {
+    p = b + 4;
+    WRITE16LE(b + 0, TLS_1_2_VERSION);
+    switch (cs->cipher) {
+      case MBEDTLS_CIPHER_AES_128_GCM:
+      case MBEDTLS_CIPHER_AES_256_GCM:
+        // nonce is salt followed by explicit iv, which is record number
+        WRITE16LE(b + 2, k->keylen == 16 ? TLS_CIPHER_AES_GCM_128
+                                         : TLS_CIPHER_AES_GCM_256);
+        p = mempcpy(p, ssl->cur_out_ctr, 8);
+        p = mempcpy(p, k->key[s], k->keylen);
+        p = mempcpy(p, k->iv[s], 4);
+        break;
+      case MBEDTLS_CIPHER_CHACHA20_POLY1305:
+        WRITE16LE(b + 2, TLS_CIPHER_CHACHA20_POLY1305);
+        p = mempcpy(p, k->iv[s], 12);
+        p = mempcpy(p, k->key[s], 32);
+        break;
+      default:
+        p = 0;
+        break;
+    }
+    if (p) {
+      p = mempcpy(p, ssl->cur_out_ctr, 8);
+      ok = !setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", 4) &&
+           !setsockopt(fd, SOL_TLS, TLS_TX, b, p - b);
+    }
+  }
+  mbedtls_platform_zeroize(b, sizeof(b));
+  mbedtls_platform_zeroize(k, sizeof(*k));
+  errno = e;
+  return ok;
+}
+
+/**
+ * Sends TLS close notify alert on socket with kernel encryption.
+ */
+int CloseKernelTls(int fd) {
+  struct msghdr msg;
+  struct cmsghdr *cmsg;
+  char alert[2] = {1, 0};  // warning, close_notify
+  char cbuf[CMSG_SPACE(1)];
+  bzero(&msg, sizeof(msg));
+  bzero(cbuf, sizeof(cbuf));
+  msg.msg_iov = &(struct iovec){alert, sizeof(alert)};
+  msg.msg_iovlen = 1;
+  msg.msg_control = cbuf;
+  msg.msg_controllen = sizeof(cbuf);
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_TLS;
+  cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+  cmsg->cmsg_len = CMSG_LEN(1);
+  *CMSG_DATA(cmsg) = 21;  // alert
+  return sendmsg(fd, &msg, 0) == sizeof(alert) ? 0 : -1;
+}
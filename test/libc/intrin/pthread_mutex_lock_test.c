@@ -20,6 +20,7 @@
 #include "libc/atomic.h"
 #include "libc/calls/calls.h"
 #include "libc/calls/state.internal.h"
+#include "libc/calls/struct/timespec.h"
 #include "libc/errno.h"
 #include "libc/intrin/strace.h"
 #include "libc/log/check.h"
@@ -30,6 +31,7 @@
 #include "libc/runtime/internal.h"
 #include "libc/runtime/runtime.h"
 #include "libc/runtime/stack.h"
+#include "libc/sysv/consts/clock.h"
 #include "libc/sysv/consts/clone.h"
 #include "libc/sysv/consts/map.h"
 #include "libc/sysv/consts/prot.h"
@@ -45,6 +47,9 @@
 
 #define MAX_RECURSIVE_LOCKS 64
 
+// budget that short critical sections should teach a mutex to lower
+#define PTHREAD_MUTEX_SPIN_TEST 800
+
 int count;
 atomic_int started;
 atomic_int finished;
@@ -193,6 +198,82 @@ TEST(pthread_mutex_lock, econtention) {
   EXPECT_EQ(0, pthread_mutex_destroy(&mylock));
 }
 
+TEST(pthread_mutex_lock, pcontention) {
+  int i;
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_NORMAL);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutex_init(&mylock, &attr);
+  pthread_mutexattr_destroy(&attr);
+  count = 0;
+  started = 0;
+  finished = 0;
+  for (i = 0; i < THREADS; ++i) {
+    ASSERT_EQ(0, pthread_create(th + i, 0, MutexWorker, (void *)(intptr_t)i));
+  }
+  for (i = 0; i < THREADS; ++i) {
+    ASSERT_EQ(0, pthread_join(th[i], 0));
+  }
+  EXPECT_EQ(THREADS, started);
+  EXPECT_EQ(THREADS, finished);
+  EXPECT_EQ(THREADS * ITERATIONS, count);
+  EXPECT_EQ(0, pthread_mutex_trylock(&mylock));
+  EXPECT_EQ(EBUSY, pthread_mutex_trylock(&mylock));
+  EXPECT_EQ(0, pthread_mutex_unlock(&mylock));
+  EXPECT_EQ(0, pthread_mutex_destroy(&mylock));
+}
+
+static void InitSharedNormalMutex(pthread_mutex_t *mu) {
+  pthread_mutexattr_t attr;
+  ASSERT_EQ(0, pthread_mutexattr_init(&attr));
+  ASSERT_EQ(0, pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_NORMAL));
+  ASSERT_EQ(0, pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED));
+  ASSERT_EQ(0, pthread_mutex_init(mu, &attr));
+  ASSERT_EQ(0, pthread_mutexattr_destroy(&attr));
+}
+
+void *CpuTimedWaiter(void *arg) {
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+  ASSERT_EQ(0, pthread_mutex_lock(&mylock));
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+  ASSERT_EQ(0, pthread_mutex_unlock(&mylock));
+  return (void *)(intptr_t)timespec_tomillis(timespec_sub(t1, t0));
+}
+
+TEST(pthread_mutex_lock, adaptive_parksWhenOwnerHoldsLockPastBudget) {
+  void *ms;
+  pthread_t t;
+  InitSharedNormalMutex(&mylock);
+  ASSERT_EQ(0, pthread_mutex_lock(&mylock));
+  ASSERT_EQ(0, pthread_create(&t, 0, CpuTimedWaiter, 0));
+  usleep(100000);
+  ASSERT_EQ(0, pthread_mutex_unlock(&mylock));
+  ASSERT_EQ(0, pthread_join(t, &ms));
+  EXPECT_LT((intptr_t)ms, 50);  // waiter slept rather than spinning
+  EXPECT_GT(mylock._spins, 0);  // and now expects longer hold times
+  EXPECT_EQ(0, pthread_mutex_destroy(&mylock));
+}
+
+TEST(pthread_mutex_lock, adaptive_budgetShrinksForShortHolds) {
+  int i;
+  if (__get_cpu_count() < 2)
+    return;  // owner can't release lock while we spin on its cpu
+  InitSharedNormalMutex(&mylock);
+  mylock._spins = PTHREAD_MUTEX_SPIN_TEST;
+  count = 0;
+  started = 0;
+  finished = 0;
+  for (i = 0; i < 2; ++i)
+    ASSERT_EQ(0, pthread_create(th + i, 0, MutexWorker, (void *)(intptr_t)i));
+  for (i = 0; i < 2; ++i)
+    ASSERT_EQ(0, pthread_join(th[i], 0));
+  EXPECT_EQ(2 * ITERATIONS, count);
+  EXPECT_LT(mylock._spins, PTHREAD_MUTEX_SPIN_TEST);
+  EXPECT_EQ(0, pthread_mutex_destroy(&mylock));
+}
+
 void *SpinlockWorker(void *p) {
   int i;
   ++started;
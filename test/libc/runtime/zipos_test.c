@@ -17,6 +17,7 @@
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
 #include "libc/calls/calls.h"
+#include "libc/calls/internal.h"
 #include "libc/calls/struct/stat.h"
 #include "libc/errno.h"
 #include "libc/limits.h"
@@ -60,6 +61,21 @@ TEST(zipos, test) {
     EXPECT_SYS(0, 0, pthread_join(t[i], 0));
 }
 
+TEST(zipos, reopen_sharesInflatedContent) {
+  char *data = gc(malloc(kHyperionSize));
+  struct ZiposHandle *a, *b;
+  ASSERT_SYS(0, 3, open("/zip/libc/testlib/hyperion.txt", O_RDONLY));
+  ASSERT_SYS(0, 4, open("/zip/libc/testlib/hyperion.txt", O_RDONLY));
+  a = (struct ZiposHandle *)g_fds.p[3].handle;
+  b = (struct ZiposHandle *)g_fds.p[4].handle;
+  EXPECT_NE(a, b);
+  EXPECT_EQ(a->mem, b->mem);
+  ASSERT_SYS(0, 0, close(3));
+  ASSERT_SYS(0, kHyperionSize, read(4, data, kHyperionSize));
+  EXPECT_EQ(0, memcmp(data, kHyperion, kHyperionSize));
+  ASSERT_SYS(0, 0, close(4));
+}
+
 TEST(zipos, erofs) {
   ASSERT_SYS(EROFS, -1, creat("/zip/foo.txt", 0644));
 }
@@ -0,0 +1,121 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/mem/gc.h"
+#include "libc/mem/mem.h"
+#include "libc/runtime/zipos.internal.h"
+#include "libc/serialize.h"
+#include "libc/stdio/rand.h"
+#include "libc/stdio/sysparam.h"
+#include "libc/str/str.h"
+#include "libc/testlib/testlib.h"
+#include "libc/zip.h"
+#include "third_party/zlib/zlib.h"
+
+__static_yoink("_Cz_inflate");
+__static_yoink("_Cz_inflateInit2");
+__static_yoink("_Cz_inflateEnd");
+
+#define SIZE (ZIPOS_ZRAN_BYTES + 3 * ZIPOS_ZRAN_SPAN + 123)
+
+char *data;
+struct Zipos zipos;
+
+void SetUpOnce(void) {
+  z_stream zs = {0};
+  size_t i, bound;
+  unsigned char *lf;
+  static const char *words[] = {"hello ", "world ", "zip ", "\n", "seek "};
+  data = malloc(SIZE);
+  for (i = 0; i < SIZE;) {
+    const char *w = words[lemur64() % 5];
+    while (*w && i < SIZE)
+      data[i++] = *w++;
+  }
+  bound = compressBound(SIZE);
+  lf = malloc(kZipLfileHdrMinSize + 1 + bound);
+  bzero(lf, kZipLfileHdrMinSize + 1);
+  WRITE32LE(lf, kZipLfileHdrMagic);
+  WRITE16LE(lf + kZipLfileOffsetCompressionmethod, kZipCompressionDeflate);
+  WRITE32LE(lf + kZipLfileOffsetUncompressedsize, SIZE);
+  WRITE16LE(lf + kZipLfileOffsetNamesize, 1);
+  lf[kZipLfileHdrMinSize] = 'x';
+  ASSERT_EQ(Z_OK, deflateInit2(&zs, 1, Z_DEFLATED, -MAX_WBITS, 8,
+                               Z_DEFAULT_STRATEGY));
+  zs.next_in = (void *)data;
+  zs.avail_in = SIZE;
+  zs.next_out = lf + kZipLfileHdrMinSize + 1;
+  zs.avail_out = bound;
+  ASSERT_EQ(Z_STREAM_END, deflate(&zs, Z_FINISH));
+  WRITE32LE(lf + kZipLfileOffsetCompressedsize, zs.total_out);
+  ASSERT_EQ(Z_OK, deflateEnd(&zs));
+  zipos.map = lf;
+}
+
+TEST(zran, smallMembers_areInflatedEagerly) {
+  EXPECT_EQ(NULL, __zipos_zran_open(&zipos, 1, 0, ZIPOS_ZRAN_BYTES - 1));
+}
+
+TEST(zran, randomAccess) {
+  int i;
+  size_t n;
+  uint64_t off;
+  char *buf = gc(malloc(3 * ZIPOS_ZRAN_SPAN));
+  struct ZiposZran *z;
+  ASSERT_NE(NULL, (z = __zipos_zran_open(&zipos, 2, 0, SIZE)));
+  for (i = 0; i < 20; ++i) {
+    off = lemur64() % SIZE;
+    n = lemur64() % (3 * ZIPOS_ZRAN_SPAN);
+    n = MIN(n, SIZE - off);
+    ASSERT_EQ(n, __zipos_zran_pread(z, buf, n, off));
+    ASSERT_EQ(0, memcmp(buf, data + off, n));
+  }
+  __zipos_zran_unref(z);
+}
+
+TEST(zran, backwards_acrossSpans) {
+  uint64_t off;
+  char buf[4096];
+  struct ZiposZran *z;
+  ASSERT_NE(NULL, (z = __zipos_zran_open(&zipos, 3, 0, SIZE)));
+  for (off = SIZE - 100; off > 2 * ZIPOS_ZRAN_SPAN;) {
+    off -= ZIPOS_ZRAN_SPAN + 77;
+    ASSERT_EQ(4096, __zipos_zran_pread(z, buf, 4096, off - 2000));
+    ASSERT_EQ(0, memcmp(buf, data + off - 2000, 4096));
+  }
+  __zipos_zran_unref(z);
+}
+
+TEST(zran, endOfFile) {
+  char buf[512];
+  struct ZiposZran *z;
+  ASSERT_NE(NULL, (z = __zipos_zran_open(&zipos, 4, 0, SIZE)));
+  ASSERT_EQ(100, __zipos_zran_pread(z, buf, 512, SIZE - 100));
+  ASSERT_EQ(0, memcmp(buf, data + SIZE - 100, 100));
+  ASSERT_EQ(0, __zipos_zran_pread(z, buf, 512, SIZE));
+  __zipos_zran_unref(z);
+}
+
+TEST(zran, reopen_sharesIndex) {
+  struct ZiposZran *a, *b;
+  ASSERT_NE(NULL, (a = __zipos_zran_open(&zipos, 5, 0, SIZE)));
+  ASSERT_NE(NULL, (b = __zipos_zran_open(&zipos, 5, 0, SIZE)));
+  EXPECT_EQ(a, b);
+  __zipos_zran_unref(b);
+  __zipos_zran_unref(a);
+}
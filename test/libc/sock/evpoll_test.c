@@ -0,0 +1,104 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/sock/evpoll.h"
+#include "libc/calls/calls.h"
+#include "libc/dce.h"
+#include "libc/errno.h"
+#include "libc/sock/sock.h"
+#include "libc/sysv/consts/af.h"
+#include "libc/sysv/consts/sock.h"
+#include "libc/testlib/testlib.h"
+
+int fds[2];
+struct evpoll *ep;
+struct evpoll_event ev, got[8];
+
+void SetUpOnce(void) {
+  ASSERT_SYS(0, 0, pledge("stdio", 0));
+}
+
+void SetUp(void) {
+  ASSERT_NE(NULL, (ep = evpoll_create()));
+  ASSERT_SYS(0, 0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+}
+
+void TearDown(void) {
+  close(fds[1]);
+  close(fds[0]);
+  evpoll_destroy(ep);
+}
+
+TEST(evpoll, levelTriggered) {
+  ev.events = EVPOLLIN;
+  ev.data.u64 = 0x1234567890;
+  ASSERT_SYS(0, 0, evpoll_ctl(ep, EVPOLL_CTL_ADD, fds[0], &ev));
+  ASSERT_SYS(0, 0, evpoll_wait(ep, got, 8, 0));
+  ASSERT_SYS(0, 1, write(fds[1], "x", 1));
+  ASSERT_SYS(0, 1, evpoll_wait(ep, got, 8, -1));
+  EXPECT_TRUE(!!(got[0].events & EVPOLLIN));
+  EXPECT_EQ(0x1234567890, got[0].data.u64);
+  ASSERT_SYS(0, 1, evpoll_wait(ep, got, 8, 0));
+  ASSERT_SYS(0, 0, evpoll_ctl(ep, EVPOLL_CTL_DEL, fds[0], 0));
+  ASSERT_SYS(0, 0, evpoll_wait(ep, got, 8, 0));
+  ASSERT_SYS(ENOENT, -1, evpoll_ctl(ep, EVPOLL_CTL_DEL, fds[0], 0));
+}
+
+TEST(evpoll, modify) {
+  ev.events = EVPOLLIN;
+  ev.data.fd = fds[0];
+  ASSERT_SYS(0, 0, evpoll_ctl(ep, EVPOLL_CTL_ADD, fds[0], &ev));
+  ASSERT_SYS(0, 0, evpoll_wait(ep, got, 8, 0));
+  ev.events = EVPOLLIN | EVPOLLOUT;
+  ASSERT_SYS(0, 0, evpoll_ctl(ep, EVPOLL_CTL_MOD, fds[0], &ev));
+  ASSERT_SYS(0, 1, evpoll_wait(ep, got, 8, 0));
+  EXPECT_EQ(EVPOLLOUT, got[0].events);
+  EXPECT_EQ(fds[0], got[0].data.fd);
+  ev.events = EVPOLLIN;
+  ASSERT_SYS(0, 0, evpoll_ctl(ep, EVPOLL_CTL_MOD, fds[0], &ev));
+  ASSERT_SYS(0, 0, evpoll_wait(ep, got, 8, 0));
+  if (!IsBsd())  // kqueue can't tell us if it's registered
+    ASSERT_SYS(ENOENT, -1, evpoll_ctl(ep, EVPOLL_CTL_MOD, fds[1], &ev));
+}
+
+TEST(evpoll, oneshot) {
+  ev.events = EVPOLLIN | EVPOLLONESHOT;
+  ev.data.u32 = 7;
+  ASSERT_SYS(0, 0, evpoll_ctl(ep, EVPOLL_CTL_ADD, fds[0], &ev));
+  ASSERT_SYS(0, 1, write(fds[1], "x", 1));
+  ASSERT_SYS(0, 1, evpoll_wait(ep, got, 8, -1));
+  EXPECT_EQ(7, got[0].data.u32);
+  ASSERT_SYS(0, 0, evpoll_wait(ep, got, 8, 0));
+  ASSERT_SYS(0, 0, evpoll_ctl(ep, EVPOLL_CTL_MOD, fds[0], &ev));
+  ASSERT_SYS(0, 1, evpoll_wait(ep, got, 8, 0));
+}
+
+TEST(evpoll, hangup) {
+  ev.events = EVPOLLIN | EVPOLLRDHUP;
+  ev.data.u64 = 0;
+  ASSERT_SYS(0, 0, evpoll_ctl(ep, EVPOLL_CTL_ADD, fds[0], &ev));
+  ASSERT_SYS(0, 0, close(fds[1]));
+  ASSERT_SYS(0, 1, evpoll_wait(ep, got, 8, -1));
+  EXPECT_TRUE(!!(got[0].events & EVPOLLIN));
+  fds[1] = -1;
+}
+
+TEST(evpoll, badOp) {
+  ASSERT_SYS(EINVAL, -1, evpoll_ctl(ep, 666, fds[0], &ev));
+  ASSERT_SYS(EINVAL, -1, evpoll_wait(ep, got, 0, 0));
+}
@@ -0,0 +1,83 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/calls/calls.h"
+#include "libc/errno.h"
+#include "libc/sock/sock.h"
+#include "libc/sock/struct/mmsghdr.h"
+#include "libc/str/str.h"
+#include "libc/sysv/consts/af.h"
+#include "libc/sysv/consts/msg.h"
+#include "libc/sysv/consts/sock.h"
+#include "libc/testlib/testlib.h"
+
+int fds[2];
+char bufs[4][8];
+struct iovec iov[4];
+struct mmsghdr msgs[4];
+
+void SetUp(void) {
+  int i;
+  ASSERT_SYS(0, 0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+  bzero(msgs, sizeof(msgs));
+  for (i = 0; i < 4; ++i) {
+    iov[i].iov_base = bufs[i];
+    iov[i].iov_len = sizeof(bufs[i]);
+    msgs[i].msg_hdr.msg_iov = iov + i;
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+}
+
+void TearDown(void) {
+  ASSERT_SYS(0, 0, close(fds[1]));
+  ASSERT_SYS(0, 0, close(fds[0]));
+}
+
+TEST(sendmmsg, test) {
+  strcpy(bufs[0], "a");
+  strcpy(bufs[1], "bc");
+  strcpy(bufs[2], "def");
+  iov[0].iov_len = 1;
+  iov[1].iov_len = 2;
+  iov[2].iov_len = 3;
+  ASSERT_SYS(0, 3, sendmmsg(fds[0], msgs, 3, 0));
+  EXPECT_EQ(1, msgs[0].msg_len);
+  EXPECT_EQ(2, msgs[1].msg_len);
+  EXPECT_EQ(3, msgs[2].msg_len);
+  bzero(bufs, sizeof(bufs));
+  iov[0].iov_len = iov[1].iov_len = iov[2].iov_len = 8;
+  ASSERT_SYS(0, 3, recvmmsg(fds[1], msgs, 4, MSG_DONTWAIT, 0));
+  EXPECT_EQ(1, msgs[0].msg_len);
+  EXPECT_EQ(2, msgs[1].msg_len);
+  EXPECT_EQ(3, msgs[2].msg_len);
+  EXPECT_STREQ("a", bufs[0]);
+  EXPECT_STREQ("bc", bufs[1]);
+  EXPECT_STREQ("def", bufs[2]);
+  ASSERT_SYS(EAGAIN, -1, recvmmsg(fds[1], msgs, 4, MSG_DONTWAIT, 0));
+}
+
+TEST(recvmmsg, waitForOne_returnsWhatsAvailable) {
+  ASSERT_SYS(0, 2, write(fds[0], "hi", 2));
+  ASSERT_SYS(0, 1, recvmmsg(fds[1], msgs, 4, MSG_WAITFORONE, 0));
+  EXPECT_EQ(2, msgs[0].msg_len);
+}
+
+TEST(recvmmsg, zeroLength_doesNothing) {
+  ASSERT_SYS(0, 0, recvmmsg(fds[1], msgs, 0, 0, 0));
+  ASSERT_SYS(0, 0, sendmmsg(fds[0], msgs, 0, 0));
+}
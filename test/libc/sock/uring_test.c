@@ -0,0 +1,132 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/sock/uring.h"
+#include "libc/calls/calls.h"
+#include "libc/errno.h"
+#include "libc/sock/sock.h"
+#include "libc/str/str.h"
+#include "libc/sysv/consts/af.h"
+#include "libc/sysv/consts/at.h"
+#include "libc/sysv/consts/o.h"
+#include "libc/sysv/consts/sock.h"
+#include "libc/testlib/testlib.h"
+
+struct uring *r;
+struct uring_cqe *cqe;
+
+void SetUpOnce(void) {
+  testlib_enable_tmp_setup_teardown();
+}
+
+void SetUp(void) {
+  ASSERT_NE(NULL, (r = uring_create(8)));
+}
+
+void TearDown(void) {
+  uring_destroy(r);
+}
+
+struct uring_cqe *Complete(void) {
+  ASSERT_SYS(0, 0, uring_wait(r, &cqe));
+  uring_seen(r, cqe);
+  return cqe;
+}
+
+TEST(uring, batchedReadsAndWrites) {
+  char a[4], b[4];
+  struct uring_sqe *sqe;
+  ASSERT_SYS(0, 3, open("x", O_RDWR | O_CREAT, 0644));
+  uring_prep_write(uring_get_sqe(r), 3, "hello", 5, 0);
+  ASSERT_SYS(0, 1, uring_submit(r, 1));
+  EXPECT_EQ(5, Complete()->res);
+  uring_prep_read(uring_get_sqe(r), 3, a, 4, 0);
+  sqe = uring_get_sqe(r);
+  uring_prep_read(sqe, 3, b, 4, 1);
+  sqe->user_data = 123;
+  ASSERT_SYS(0, 2, uring_submit(r, 2));
+  EXPECT_EQ(123, Complete()->user_data + Complete()->user_data);
+  EXPECT_EQ(0, memcmp(a, "hell", 4));
+  EXPECT_EQ(0, memcmp(b, "ello", 4));
+  ASSERT_SYS(EAGAIN, -1, uring_peek(r, &cqe));
+  ASSERT_SYS(0, 0, close(3));
+}
+
+TEST(uring, linkedOperationsAreCancelledAfterShortRead) {
+  char buf[16];
+  struct uring_sqe *sqe;
+  ASSERT_SYS(0, 3, open("x", O_RDWR | O_CREAT, 0644));
+  ASSERT_SYS(0, 2, write(3, "hi", 2));
+  sqe = uring_get_sqe(r);
+  uring_prep_read(sqe, 3, buf, sizeof(buf), 0);
+  sqe->flags |= URING_LINK;
+  uring_prep_nop(uring_get_sqe(r));
+  ASSERT_SYS(0, 2, uring_submit(r, 2));
+  EXPECT_EQ(2, Complete()->res);
+  EXPECT_EQ(-ECANCELED, Complete()->res);
+  ASSERT_SYS(0, 0, close(3));
+}
+
+TEST(uring, openStatClose) {
+  struct uring_statx st;
+  ASSERT_SYS(0, 3, open("x", O_RDWR | O_CREAT, 0644));
+  ASSERT_SYS(0, 3, write(3, "abc", 3));
+  ASSERT_SYS(0, 0, close(3));
+  uring_prep_statx(uring_get_sqe(r), AT_FDCWD, "x", 0,
+                   URING_STATX_BASIC_STATS, &st);
+  uring_prep_openat(uring_get_sqe(r), AT_FDCWD, "x", O_RDONLY, 0);
+  ASSERT_SYS(0, 2, uring_submit(r, 2));
+  EXPECT_EQ(0, Complete()->res);
+  EXPECT_EQ(3, st.stx_size);
+  EXPECT_EQ(3, Complete()->res);
+  uring_prep_close(uring_get_sqe(r), 3);
+  ASSERT_SYS(0, 1, uring_submit(r, 1));
+  EXPECT_EQ(0, Complete()->res);
+  ASSERT_SYS(EBADF, -1, close(3));
+}
+
+TEST(uring, registeredFiles) {
+  int fds[2];
+  char buf[8] = {0};
+  struct uring_sqe *sqe;
+  ASSERT_SYS(0, 0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT_SYS(0, 0, uring_register_files(r, fds, 2));
+  sqe = uring_get_sqe(r);
+  uring_prep_send(sqe, 1, "ping", 4, 0);
+  sqe->flags |= URING_FIXED_FILE | URING_LINK;
+  sqe = uring_get_sqe(r);
+  uring_prep_recv(sqe, 0, buf, sizeof(buf), 0);
+  sqe->flags |= URING_FIXED_FILE;
+  ASSERT_SYS(0, 2, uring_submit(r, 2));
+  EXPECT_EQ(4, Complete()->res);
+  EXPECT_EQ(4, Complete()->res);
+  EXPECT_STREQ("ping", buf);
+  ASSERT_SYS(0, 0, uring_register_files(r, 0, 0));
+  ASSERT_SYS(0, 0, close(fds[1]));
+  ASSERT_SYS(0, 0, close(fds[0]));
+}
+
+TEST(uring, queueFull) {
+  int i;
+  for (i = 0; i < 8; ++i)
+    uring_prep_nop(uring_get_sqe(r));
+  EXPECT_EQ(NULL, uring_get_sqe(r));
+  ASSERT_SYS(0, 8, uring_submit(r, 8));
+  for (i = 0; i < 8; ++i)
+    EXPECT_EQ(0, Complete()->res);
+}
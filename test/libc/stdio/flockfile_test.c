@@ -0,0 +1,72 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/atomic.h"
+#include "libc/calls/calls.h"
+#include "libc/stdio/stdio.h"
+#include "libc/testlib/testlib.h"
+#include "libc/thread/thread.h"
+#include "libc/thread/tls.h"
+
+FILE *f;
+atomic_int done;
+
+void *Worker(void *arg) {
+  int i;
+  for (i = 0; i < 1000; ++i) {
+    flockfile(f);
+    fputc('x', f);
+    funlockfile(f);
+  }
+  return 0;
+}
+
+void *Printer(void *arg) {
+  fputc('x', f);
+  done = 1;
+  return 0;
+}
+
+TEST(flockfile, straddlesThreadCreation) {
+  pthread_t th[2];
+  ASSERT_NE(NULL, (f = fopen("/dev/null", "w")));
+  // stdio functions elide their own locking while single-threaded
+  ASSERT_EQ('x', fputc('x', f));
+  ASSERT_EQ(0, pthread_create(&th[0], 0, Worker, 0));
+  ASSERT_TRUE(__isthreaded);
+  ASSERT_EQ(0, pthread_create(&th[1], 0, Worker, 0));
+  Worker(0);
+  ASSERT_EQ(0, pthread_join(th[1], 0));
+  ASSERT_EQ(0, pthread_join(th[0], 0));
+  ASSERT_EQ(0, ftrylockfile(f));
+  funlockfile(f);
+  ASSERT_EQ(0, fclose(f));
+}
+
+TEST(flockfile, heldBeforeThreadCreation_excludesNewThreads) {
+  pthread_t th;
+  ASSERT_NE(NULL, (f = fopen("/dev/null", "w")));
+  flockfile(f);
+  ASSERT_EQ(0, pthread_create(&th, 0, Printer, 0));
+  usleep(10000);
+  ASSERT_FALSE(done);
+  funlockfile(f);
+  ASSERT_EQ(0, pthread_join(th, 0));
+  ASSERT_TRUE(done);
+  ASSERT_EQ(0, fclose(f));
+}
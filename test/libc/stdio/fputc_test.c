@@ -22,6 +22,7 @@
 #include "libc/str/str.h"
 #include "libc/testlib/ezbench.h"
 #include "libc/testlib/testlib.h"
+#include "libc/thread/thread.h"
 
 FILE *f;
 char buf[512];
@@ -71,14 +72,40 @@ TEST(fgetc, testUnbuffered) {
   EXPECT_NE(-1, fclose(f));
 }
 
+int GetcLoop(FILE *f) {
+  int c, x = 0;
+  while ((c = getc(f)) != -1)
+    x += c;
+  return x;
+}
+
+void PutcLoop(FILE *f) {
+  for (int i = 0; i < sizeof(buf); ++i)
+    putc(buf[i], f);
+}
+
+void *Worker(void *arg) {
+  return 0;
+}
+
 BENCH(fputc, bench) {
-  FILE *f;
+  FILE *f, *g;
+  pthread_t th;
   ASSERT_NE(NULL, (f = fopen("/dev/null", "w")));
+  ASSERT_NE(NULL, (g = fmemopen(buf, sizeof(buf), "r")));
   EZBENCH2("fputc", donothing, fputc('E', f));
   flockfile(f);
   flockfile(f);
   EZBENCH2("fputc_unlocked", donothing, fputc_unlocked('E', f));
   funlockfile(f);
   funlockfile(f);
+  EZBENCH2("getc loop", rewind(g), GetcLoop(g));
+  EZBENCH2("putc loop", donothing, PutcLoop(f));
+  // stdio locking is elided until the first thread is created
+  ASSERT_EQ(0, pthread_create(&th, 0, Worker, 0));
+  ASSERT_EQ(0, pthread_join(th, 0));
+  EZBENCH2("getc loop threaded", rewind(g), GetcLoop(g));
+  EZBENCH2("putc loop threaded", donothing, PutcLoop(f));
+  fclose(g);
   fclose(f);
 }
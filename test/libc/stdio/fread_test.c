@@ -18,7 +18,9 @@
 ╚─────────────────────────────────────────────────────────────────────────────*/
 #include "libc/calls/calls.h"
 #include "libc/errno.h"
+#include "libc/stdio/internal.h"
 #include "libc/stdio/stdio.h"
+#include "libc/str/str.h"
 #include "libc/testlib/testlib.h"
 
 void SetUpOnce(void) {
@@ -89,3 +91,73 @@ TEST(fread, partial) {
   ASSERT_EQ(0, fclose(f));
   ASSERT_STREQ("hi", buf);
 }
+
+TEST(fread, mapped) {
+  FILE* f;
+  char buf[8] = {0};
+  ASSERT_NE(NULL, (f = fopen("foo", "w")));
+  ASSERT_EQ(8, fwrite("hellosup", 1, 8, f));
+  ASSERT_EQ(0, fclose(f));
+  ASSERT_NE(NULL, (f = fopen("foo", "rm")));
+  ASSERT_EQ('h', fgetc(f));
+  ASSERT_EQ(1, ftell(f));
+  ASSERT_EQ('x', ungetc('x', f));
+  ASSERT_EQ(4, fread(buf, 1, 4, f));
+  ASSERT_STREQ("xell", buf);
+  ASSERT_EQ(0, fseek(f, -2, SEEK_CUR));
+  ASSERT_EQ(6, fread(buf, 1, 8, f));
+  ASSERT_STREQ("llosup", buf);
+  ASSERT_TRUE(feof(f));
+  ASSERT_EQ(8, ftell(f));
+  ASSERT_EQ(0, fseek(f, 5, SEEK_SET));
+  ASSERT_EQ('s', fgetc(f));
+  ASSERT_EQ(0, fclose(f));
+}
+
+TEST(fread, mapped_seekDiscardsPushback) {
+  FILE* f;
+  ASSERT_NE(NULL, (f = fopen("foo", "w")));
+  ASSERT_EQ(8, fwrite("hellosup", 1, 8, f));
+  ASSERT_EQ(0, fclose(f));
+  ASSERT_NE(NULL, (f = fopen("foo", "rm")));
+  ASSERT_EQ('h', fgetc(f));
+  ASSERT_EQ('e', fgetc(f));
+  ASSERT_EQ('x', ungetc('x', f));
+  ASSERT_EQ(0, fseek(f, 1, SEEK_SET));
+  ASSERT_EQ('e', fgetc(f));
+  ASSERT_EQ('e', ungetc('e', f));
+  ASSERT_EQ(0, fseek(f, 0, SEEK_SET));
+  ASSERT_EQ('h', fgetc(f));
+  ASSERT_EQ('e', fgetc(f));
+  ASSERT_EQ(0, fclose(f));
+}
+
+TEST(fread, mapped_seesAppendedContent) {
+  FILE *fo, *fi;
+  char buf[8] = {0};
+  ASSERT_NE(NULL, (fo = fopen("foo", "w")));
+  ASSERT_EQ(4, fwrite("hell", 1, 4, fo));
+  ASSERT_EQ(0, fflush(fo));
+  ASSERT_NE(NULL, (fi = fopen("foo", "rm")));
+  ASSERT_EQ(4, fwrite("osup", 1, 4, fo));
+  ASSERT_EQ(0, fflush(fo));
+  ASSERT_EQ(8, fread(buf, 1, 8, fi));
+  ASSERT_EQ(0, memcmp(buf, "hellosup", 8));
+  ASSERT_EQ(0, fclose(fi));
+  ASSERT_EQ(0, fclose(fo));
+}
+
+TEST(fread, sequential_growsBuffer) {
+  FILE* f;
+  int i, c;
+  ASSERT_NE(NULL, (f = fopen("foo", "w")));
+  for (i = 0; i < 300000; ++i)
+    ASSERT_NE(-1, fputc(i % 251, f));
+  ASSERT_EQ(0, fclose(f));
+  ASSERT_NE(NULL, (f = fopen("foo", "r")));
+  for (i = 0; (c = fgetc(f)) != -1; ++i)
+    ASSERT_EQ(i % 251, c);
+  ASSERT_EQ(300000, i);
+  ASSERT_EQ(BUFMAX, f->size);
+  ASSERT_EQ(0, fclose(f));
+}
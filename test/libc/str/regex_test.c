@@ -17,6 +17,7 @@
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
 #include "third_party/regex/regex.h"
+#include "libc/macros.h"
 #include "libc/mem/gc.h"
 #include "libc/mem/mem.h"
 #include "libc/str/locale.h"
@@ -98,6 +99,73 @@ TEST(regex, testUnicodeCharacterClass) {
   regfree(&rx);
 }
 
+TEST(regex, testAnchorsWithoutSubmatches) {
+  regex_t rx;
+  EXPECT_EQ(REG_OK, regcomp(&rx, "^ab|cd$", REG_EXTENDED | REG_NOSUB));
+  EXPECT_EQ(REG_OK, regexec(&rx, "abx", 0, NULL, 0));
+  EXPECT_EQ(REG_NOMATCH, regexec(&rx, "abx", 0, NULL, REG_NOTBOL));
+  EXPECT_EQ(REG_NOMATCH, regexec(&rx, "xab", 0, NULL, 0));
+  EXPECT_EQ(REG_OK, regexec(&rx, "xcd", 0, NULL, 0));
+  EXPECT_EQ(REG_NOMATCH, regexec(&rx, "xcd", 0, NULL, REG_NOTEOL));
+  EXPECT_EQ(REG_NOMATCH, regexec(&rx, "cdx", 0, NULL, 0));
+  EXPECT_EQ(REG_NOMATCH, regexec(&rx, "cd\nab", 0, NULL, 0));
+  regfree(&rx);
+  EXPECT_EQ(REG_OK, regcomp(&rx, "^ab|cd$", REG_EXTENDED | REG_NEWLINE));
+  EXPECT_EQ(REG_OK, regexec(&rx, "cd\nx", 0, NULL, 0));
+  EXPECT_EQ(REG_OK, regexec(&rx, "x\nab", 0, NULL, REG_NOTBOL));
+  EXPECT_EQ(REG_NOMATCH, regexec(&rx, "xab\nxcdx", 0, NULL, 0));
+  regfree(&rx);
+}
+
+TEST(regex, testMatchingWithoutSubmatchesAgrees) {
+  int i, j;
+  regex_t rx;
+  regmatch_t m[1];
+  static const char *const kPatterns[] = {
+      "(foo|bar)[0-9]+", "^[a-z]*$", "x*", "[[:upper:]]+z$", "é+",
+  };
+  static const char *const kStrings[] = {
+      "", "foo", "bar123", "abc", "ABz", "xx", "ééé", "x\xff", "\xffx",
+  };
+  for (i = 0; i < ARRAYLEN(kPatterns); ++i) {
+    ASSERT_EQ(REG_OK, regcomp(&rx, kPatterns[i], REG_EXTENDED | REG_ICASE));
+    for (j = 0; j < ARRAYLEN(kStrings); ++j) {
+      EXPECT_EQ(regexec(&rx, kStrings[j], 1, m, 0),
+                regexec(&rx, kStrings[j], 0, NULL, 0), "%s %s",
+                kPatterns[i], kStrings[j]);
+    }
+    regfree(&rx);
+  }
+}
+
+TEST(regex, testInvalidUtf8AfterMatch_isNoMatch) {
+  regex_t rx;
+  EXPECT_EQ(REG_OK, regcomp(&rx, "a", REG_EXTENDED | REG_NOSUB));
+  EXPECT_EQ(REG_NOMATCH, regexec(&rx, "a\xff", 0, NULL, 0));
+  EXPECT_EQ(REG_OK, regexec(&rx, "ab\xff", 0, NULL, 0));
+  regfree(&rx);
+}
+
+TEST(regex, testManyStates_flushesCache) {
+  int i;
+  regex_t rx;
+  char s[2001];
+  unsigned x = 1;
+  ASSERT_EQ(REG_OK, regcomp(&rx, "a[ab]{10}c", REG_EXTENDED | REG_NOSUB));
+  for (i = 0; i < 2000; ++i) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    s[i] = "ab"[x & 1];
+  }
+  s[2000] = 0;
+  EXPECT_EQ(REG_NOMATCH, regexec(&rx, s, 0, NULL, 0));
+  s[1999] = 'c';
+  s[1988] = 'a';
+  EXPECT_EQ(REG_OK, regexec(&rx, s, 0, NULL, 0));
+  regfree(&rx);
+}
+
 void A(void) {
   regex_t rx;
   regcomp(&rx, "^[-._0-9A-Za-z]*$", REG_EXTENDED);
@@ -224,6 +292,10 @@ BENCH(regex, bench) {
            regexec(&rx, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaa", 0, 0, 0));
   free(m);
   regfree(&rx);
+  EXPECT_EQ(REG_OK, regcomp(&rx, "(foo|bar|baz)[0-9]+", REG_EXTENDED));
+  EZBENCH2("precompiled unanchored miss", donothing,
+           regexec(&rx, "the quick brown fox jumps over the lazy dog", 0, 0, 0));
+  regfree(&rx);
   EXPECT_EQ(REG_OK,
             regcomp(&rx, "^[a-z]*$", REG_EXTENDED | REG_NOSUB | REG_ICASE));
   m = calloc(rx.re_nsub + 1, sizeof(regmatch_t));
@@ -0,0 +1,113 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/thread/percpu.h"
+#include "libc/calls/calls.h"
+#include "libc/intrin/rseq.h"
+#include "libc/runtime/runtime.h"
+#include "libc/testlib/ezbench.h"
+#include "libc/testlib/testlib.h"
+#include "libc/thread/thread.h"
+
+#define THREADS    8
+#define PROCESSES  4
+#define ITERATIONS 100000
+
+struct percpu_counter counter;
+
+void *Worker(void *arg) {
+  if (__rseq_ok)
+    ASSERT_GE(__rseq_cpu(), 0);
+  for (int i = 0; i < ITERATIONS; ++i)
+    percpu_counter_add(&counter, 1);
+  return 0;
+}
+
+TEST(percpu_counter, threads) {
+  pthread_t th[THREADS];
+  for (int i = 0; i < THREADS; ++i)
+    ASSERT_EQ(0, pthread_create(th + i, 0, Worker, 0));
+  for (int i = 0; i < THREADS; ++i)
+    ASSERT_EQ(0, pthread_join(th[i], 0));
+  ASSERT_EQ(THREADS * ITERATIONS, percpu_counter_get(&counter));
+  percpu_counter_add(&counter, -THREADS * ITERATIONS);
+  ASSERT_EQ(0, percpu_counter_get(&counter));
+}
+
+TEST(percpu_counter, processes) {
+  int ws, pid;
+  struct percpu_counter *c;
+  c = _mapshared(sizeof(*c));
+  for (int i = 0; i < PROCESSES; ++i) {
+    ASSERT_NE(-1, (pid = fork()));
+    if (!pid) {
+      for (int j = 0; j < ITERATIONS; ++j)
+        percpu_counter_add(c, 1);
+      _Exit(0);
+    }
+  }
+  for (int i = 0; i < PROCESSES; ++i) {
+    ASSERT_NE(-1, wait(&ws));
+    ASSERT_TRUE(WIFEXITED(ws));
+    ASSERT_EQ(0, WEXITSTATUS(ws));
+  }
+  ASSERT_EQ(PROCESSES * ITERATIONS, percpu_counter_get(c));
+  ASSERT_SYS(0, 0, munmap(c, sizeof(*c)));
+}
+
+struct Stats {
+  long hits;
+  long misses;
+} __attribute__((__aligned__(64))) stats[PERCPU_SLOTS];
+
+void *StatsWorker(void *arg) {
+  for (int i = 0; i < ITERATIONS; ++i) {
+    PERCPU_ADD(stats, hits, 1);
+    if (i & 1)
+      PERCPU_ADD(stats, misses, 2);
+  }
+  return 0;
+}
+
+TEST(percpu, structOfCounters) {
+  struct Stats sums;
+  pthread_t th[THREADS];
+  ASSERT_EQ(0, sizeof(stats[0]) % 64);
+  for (int i = 0; i < THREADS; ++i)
+    ASSERT_EQ(0, pthread_create(th + i, 0, StatsWorker, 0));
+  for (int i = 0; i < THREADS; ++i)
+    ASSERT_EQ(0, pthread_join(th[i], 0));
+  ASSERT_EQ(THREADS * ITERATIONS, PERCPU_SUM(stats, hits));
+  ASSERT_EQ(THREADS * ITERATIONS, PERCPU_SUM(stats, misses));
+  percpu_sums(&sums.hits, &stats[0].hits, 2, sizeof(stats[0]));
+  ASSERT_EQ(THREADS * ITERATIONS, sums.hits);
+  ASSERT_EQ(THREADS * ITERATIONS, sums.misses);
+}
+
+TEST(rseq, mainThreadIsRegisteredOnLinux) {
+  if (!__rseq_ok)
+    return;
+  ASSERT_GE(__rseq_cpu(), 0);
+}
+
+BENCH(percpu_counter, bench) {
+  EZBENCH2("percpu_counter_add", donothing,
+           percpu_counter_add(&counter, 1));
+  EZBENCH2("percpu_counter_get", donothing, percpu_counter_get(&counter));
+  EZBENCH2("__rseq_cpu", donothing, __expropriate(__rseq_cpu()));
+}
@@ -0,0 +1,77 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/atomic.h"
+#include "libc/intrin/atomic.h"
+#include "libc/testlib/testlib.h"
+#include "libc/thread/thread.h"
+
+#define THREADS 64
+#define ROUNDS  50
+
+int generation;
+atomic_int waiting;
+atomic_int woken;
+pthread_cond_t cv = PTHREAD_COND_INITIALIZER;
+pthread_mutex_t mu = PTHREAD_MUTEX_INITIALIZER;
+
+void *Waiter(void *arg) {
+  for (int i = 0; i < ROUNDS; ++i) {
+    pthread_mutex_lock(&mu);
+    int g = generation;
+    atomic_fetch_add(&waiting, 1);
+    while (generation == g)
+      ASSERT_EQ(0, pthread_cond_wait(&cv, &mu));
+    pthread_mutex_unlock(&mu);
+    atomic_fetch_add(&woken, 1);
+  }
+  return 0;
+}
+
+void Broadcast(bool holding) {
+  pthread_mutex_lock(&mu);
+  ++generation;
+  if (holding)
+    pthread_cond_broadcast(&cv);
+  pthread_mutex_unlock(&mu);
+  if (!holding)
+    pthread_cond_broadcast(&cv);
+}
+
+void RunTest(bool holding) {
+  pthread_t th[THREADS];
+  waiting = woken = generation = 0;
+  for (int i = 0; i < THREADS; ++i)
+    ASSERT_EQ(0, pthread_create(th + i, 0, Waiter, 0));
+  for (int i = 0; i < ROUNDS; ++i) {
+    while (atomic_load(&waiting) < (i + 1) * THREADS)
+      pthread_yield_np();
+    Broadcast(holding);
+  }
+  for (int i = 0; i < THREADS; ++i)
+    ASSERT_EQ(0, pthread_join(th[i], 0));
+  ASSERT_EQ(ROUNDS * THREADS, woken);
+}
+
+TEST(pthread_cond_broadcast, whileHoldingMutex_wakesEveryone) {
+  RunTest(true);
+}
+
+TEST(pthread_cond_broadcast, afterReleasingMutex_wakesEveryone) {
+  RunTest(false);
+}
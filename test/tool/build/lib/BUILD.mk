@@ -43,7 +43,9 @@ TEST_TOOL_BUILD_LIB_DIRECTDEPS =				\
 	LIBC_X							\
 	THIRD_PARTY_COMPILER_RT					\
 	TOOL_BUILD_LIB						\
-	THIRD_PARTY_XED
+	THIRD_PARTY_XED						\
+	THIRD_PARTY_ZLIB					\
+	THIRD_PARTY_ZSTD
 
 TEST_TOOL_BUILD_LIB_DEPS :=					\
 	$(call uniq,$(foreach x,$(TEST_TOOL_BUILD_LIB_DIRECTDEPS),$($(x))))
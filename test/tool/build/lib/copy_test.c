@@ -0,0 +1,118 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "tool/build/lib/copy.h"
+#include "libc/calls/calls.h"
+#include "libc/calls/struct/stat.h"
+#include "libc/calls/struct/timespec.h"
+#include "libc/errno.h"
+#include "libc/intrin/kprintf.h"
+#include "libc/mem/gc.h"
+#include "libc/mem/mem.h"
+#include "libc/stdio/rand.h"
+#include "libc/str/str.h"
+#include "libc/sysv/consts/at.h"
+#include "libc/sysv/consts/o.h"
+#include "libc/sysv/consts/ok.h"
+#include "libc/testlib/testlib.h"
+#include "libc/x/x.h"
+
+void SetUpOnce(void) {
+  testlib_enable_tmp_setup_teardown();
+}
+
+TEST(CopyPath, preservesContentAndMode) {
+  struct stat st;
+  char *p = gc(malloc(300000));
+  rngset(p, 300000, 0, 0);
+  ASSERT_SYS(0, 0, xbarf("a", p, 300000));
+  ASSERT_SYS(0, 0, chmod("a", 0751));
+  ASSERT_SYS(0, 0, CopyPath("a", "b", 0));
+  ASSERT_SYS(0, 0, stat("b", &st));
+  EXPECT_EQ(0751, st.st_mode & 0777);
+  EXPECT_EQ(300000, st.st_size);
+  EXPECT_EQ(0, memcmp(p, gc(xslurp("b", 0)), 300000));
+  EXPECT_SYS(0, 0, access("a", F_OK));
+}
+
+TEST(CopyPath, move_unlinksSource) {
+  ASSERT_SYS(0, 0, xbarf("a", "hello", 5));
+  ASSERT_SYS(0, 0, xbarf("b", "overwritten", -1));
+  ASSERT_SYS(0, 0, CopyPath("a", "b", COPY_MOVE));
+  EXPECT_SYS(ENOENT, -1, access("a", F_OK));
+  EXPECT_STREQ("hello", gc(xslurp("b", 0)));
+}
+
+TEST(CopyPath, move_preservesTimestamps) {
+  struct stat st;
+  ASSERT_SYS(0, 0, xbarf("a", "hello", 5));
+  ASSERT_SYS(0, 0, utimensat(AT_FDCWD, "a",
+                             (struct timespec[]){{1000000000, 123},
+                                                 {1200000000, 456}},
+                             0));
+  ASSERT_SYS(0, 0, CopyPath("a", "b", COPY_MOVE));
+  ASSERT_SYS(0, 0, stat("b", &st));
+  EXPECT_EQ(1200000000, st.st_mtim.tv_sec);
+}
+
+TEST(CopyPath, missing_fails) {
+  EXPECT_SYS(ENOENT, -1, CopyPath("a", "b", 0));
+  EXPECT_SYS(ENOENT, -1, access("b", F_OK));
+}
+
+TEST(CopyRange, copiesAtOffsets_leavesPositionsAlone) {
+  char buf[8] = {0};
+  ASSERT_SYS(0, 0, xbarf("a", "0123456789", 10));
+  ASSERT_SYS(0, 0, xbarf("b", "abcdefghij", 10));
+  ASSERT_SYS(0, 3, open("a", O_RDONLY));
+  ASSERT_SYS(0, 4, open("b", O_RDWR));
+  ASSERT_SYS(0, 4, CopyRange(3, 2, 4, 5, 4));
+  EXPECT_SYS(0, 0, lseek(3, 0, SEEK_CUR));
+  EXPECT_SYS(0, 0, lseek(4, 0, SEEK_CUR));
+  ASSERT_SYS(0, 2, CopyRange(3, 8, 4, 0, 5));
+  ASSERT_SYS(0, 0, close(4));
+  ASSERT_SYS(0, 0, close(3));
+  EXPECT_STREQ("89cde2345j", gc(xslurp("b", 0)));
+}
+
+TEST(Copier, copiesManyFilesConcurrently) {
+  int i;
+  char src[16], dst[16];
+  struct Copier *c;
+  ASSERT_NE(NULL, (c = NewCopier(4)));
+  for (i = 0; i < 50; ++i) {
+    ksnprintf(src, sizeof(src), "s%d", i);
+    ksnprintf(dst, sizeof(dst), "d%d", i);
+    ASSERT_SYS(0, 0, xbarf(src, src, -1));
+    CopyLater(c, src, dst, 0);
+  }
+  EXPECT_EQ(0, FreeCopier(c));
+  for (i = 0; i < 50; ++i) {
+    ksnprintf(src, sizeof(src), "s%d", i);
+    ksnprintf(dst, sizeof(dst), "d%d", i);
+    EXPECT_STREQ(src, gc(xslurp(dst, 0)));
+  }
+}
+
+TEST(Copier, countsFailures) {
+  struct Copier *c;
+  ASSERT_NE(NULL, (c = NewCopier(2)));
+  CopyLater(c, "nonexistent1", "x", 0);
+  CopyLater(c, "nonexistent2", "y", 0);
+  EXPECT_EQ(2, FreeCopier(c));
+}
@@ -0,0 +1,131 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "tool/build/lib/walk.h"
+#include "libc/calls/calls.h"
+#include "libc/errno.h"
+#include "libc/intrin/kprintf.h"
+#include "libc/sysv/consts/at.h"
+#include "libc/sysv/consts/dt.h"
+#include "libc/sysv/consts/ok.h"
+#include "libc/testlib/testlib.h"
+#include "libc/x/x.h"
+
+_Atomic(int) files;
+_Atomic(int) dirs;
+_Atomic(int) posts;
+
+void SetUpOnce(void) {
+  testlib_enable_tmp_setup_teardown();
+}
+
+void SetUp(void) {
+  files = dirs = posts = 0;
+}
+
+void MakeTree(void) {
+  int i, j;
+  char path[64];
+  for (i = 0; i < 10; ++i) {
+    ksnprintf(path, sizeof(path), "t/d%d/e", i);
+    ASSERT_SYS(0, 0, makedirs(path, 0755));
+    for (j = 0; j < 10; ++j) {
+      ksnprintf(path, sizeof(path), "t/d%d/f%d", i, j);
+      ASSERT_SYS(0, 0, xbarf(path, "x", 1));
+      ksnprintf(path, sizeof(path), "t/d%d/e/f%d", i, j);
+      ASSERT_SYS(0, 0, xbarf(path, "x", 1));
+    }
+  }
+  ASSERT_SYS(0, 0, symlink("d0", "t/link"));
+}
+
+int Count(int dirfd, const char *name, const char *path, int type, int how,
+          void *arg) {
+  switch (how) {
+    case WALK_FILE:
+      ++files;
+      break;
+    case WALK_DIR:
+      ++dirs;
+      break;
+    case WALK_POST:
+      ++posts;
+      break;
+    default:
+      return -1;
+  }
+  return 0;
+}
+
+int Remove(int dirfd, const char *name, const char *path, int type, int how,
+           void *arg) {
+  switch (how) {
+    case WALK_FILE:
+      return unlinkat(dirfd, name, 0);
+    case WALK_POST:
+      return rmdir(path);
+    default:
+      return 0;
+  }
+}
+
+int Fail(int dirfd, const char *name, const char *path, int type, int how,
+         void *arg) {
+  if (how == WALK_FILE) {
+    errno = EPERM;
+    return -1;
+  }
+  return 0;
+}
+
+TEST(WalkTree, countsEverything_doesntFollowLinks) {
+  MakeTree();
+  ASSERT_SYS(0, 0, WalkTree("t", Count, 0, 4));
+  EXPECT_EQ(201, files);
+  EXPECT_EQ(21, dirs);
+  EXPECT_EQ(21, posts);
+}
+
+TEST(WalkTree, singleThreaded) {
+  MakeTree();
+  ASSERT_SYS(0, 0, WalkTree("t/", Count, 0, 1));
+  EXPECT_EQ(201, files);
+  EXPECT_EQ(21, dirs);
+}
+
+TEST(WalkTree, postOrder_canRemoveTree) {
+  MakeTree();
+  ASSERT_SYS(0, 0, WalkTree("t", Remove, 0, 8));
+  EXPECT_SYS(ENOENT, -1, access("t", F_OK));
+}
+
+TEST(WalkTree, notDirectory_visitsOnce) {
+  ASSERT_SYS(0, 0, xbarf("f", "x", 1));
+  ASSERT_SYS(0, 0, WalkTree("f", Count, 0, 4));
+  EXPECT_EQ(1, files);
+  EXPECT_EQ(0, dirs);
+}
+
+TEST(WalkTree, missing) {
+  EXPECT_SYS(ENOENT, -1, WalkTree("t", Count, 0, 4));
+}
+
+TEST(WalkTree, callbackFailure_stopsWalk) {
+  MakeTree();
+  EXPECT_SYS(EPERM, -1, WalkTree("t", Fail, 0, 4));
+}
@@ -0,0 +1,71 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "tool/build/lib/zipalign.h"
+#include "libc/serialize.h"
+#include "libc/str/str.h"
+#include "libc/testlib/testlib.h"
+#include "libc/zip.h"
+
+unsigned char lfile[kZipLfileHdrMinSize + 3 + 8192];
+
+void SetUp(void) {
+  bzero(lfile, sizeof(lfile));
+  WRITE32LE(lfile, kZipLfileHdrMagic);
+  WRITE16LE(lfile + kZipLfileOffsetCompressionmethod, kZipCompressionNone);
+  WRITE32LE(lfile + kZipLfileOffsetCompressedsize, 8192);
+  WRITE32LE(lfile + kZipLfileOffsetUncompressedsize, 8192);
+  WRITE16LE(lfile + kZipLfileOffsetNamesize, 3);
+  memcpy(lfile + kZipLfileHdrMinSize, "abc", 3);
+  memset(lfile + kZipLfileHdrMinSize + 3, 'x', 8192);
+}
+
+TEST(GetZipLfilePadding, disabled) {
+  EXPECT_EQ(0, GetZipLfilePadding(lfile, 0, 0));
+}
+
+TEST(GetZipLfilePadding, alreadyAligned) {
+  EXPECT_EQ(0, GetZipLfilePadding(lfile, 4096 - 33, 4096));
+}
+
+TEST(GetZipLfilePadding, deflated_isLeftAlone) {
+  WRITE16LE(lfile + kZipLfileOffsetCompressionmethod, kZipCompressionDeflate);
+  EXPECT_EQ(0, GetZipLfilePadding(lfile, 100, 4096));
+}
+
+TEST(GetZipLfilePadding, smallerThanAlignment_isLeftAlone) {
+  EXPECT_EQ(0, GetZipLfilePadding(lfile, 100, 16384));
+}
+
+TEST(GetZipLfilePadding, tooSmallForExtraRecord_addsWholeAlignment) {
+  EXPECT_EQ(4096 + 2, GetZipLfilePadding(lfile, 4096 - 35, 4096));
+}
+
+TEST(PadZipLfileHdr, contentLandsOnBoundary) {
+  size_t pad, n;
+  unsigned char out[kZipLfileHdrMinSize + 3 + 4096 + 8];
+  ASSERT_EQ(4096 - 100 - 33, (pad = GetZipLfilePadding(lfile, 100, 4096)));
+  n = PadZipLfileHdr(out, lfile, pad, 4096);
+  EXPECT_EQ(0, (100 + n) % 4096);
+  EXPECT_EQ(n, ZIP_LFILE_HDRSIZE(out));
+  EXPECT_EQ(pad, ZIP_LFILE_EXTRASIZE(out));
+  EXPECT_EQ(kZipExtraAlign, READ16LE(ZIP_LFILE_EXTRA(out)));
+  EXPECT_EQ(pad - 4, READ16LE(ZIP_LFILE_EXTRA(out) + 2));
+  EXPECT_EQ(4096, READ16LE(ZIP_LFILE_EXTRA(out) + 4));
+  EXPECT_EQ(0, memcmp(ZIP_LFILE_NAME(out), "abc", 3));
+}
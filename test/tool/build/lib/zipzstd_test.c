@@ -0,0 +1,97 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "tool/build/lib/zipzstd.h"
+#include "libc/mem/mem.h"
+#include "libc/serialize.h"
+#include "libc/stdio/sysparam.h"
+#include "libc/str/str.h"
+#include "libc/testlib/testlib.h"
+#include "libc/zip.h"
+#include "third_party/zlib/zlib.h"
+#include "third_party/zstd/zstd.h"
+
+char text[8192];
+unsigned char lfile[kZipLfileHdrMinSize + 3 + 16384];
+unsigned char cfile[kZipCfileHdrMinSize + 3];
+
+void SetUp(void) {
+  const char *w;
+  unsigned x = 1;
+  size_t i, n;
+  z_stream zs = {0};
+  for (i = 0; i < sizeof(text); i += n) {
+    x = x * 1103515245 + 12345;
+    w = (const char *[]){"zip ", "deflate ", "zstd ", "cosmo ", "asset ",
+                         "redbean ", "frame ", "\n"}[x >> 28 & 7];
+    n = MIN(strlen(w), sizeof(text) - i);
+    memcpy(text + i, w, n);
+  }
+  bzero(lfile, sizeof(lfile));
+  bzero(cfile, sizeof(cfile));
+  ASSERT_EQ(Z_OK, deflateInit2(&zs, 1, Z_DEFLATED, -MAX_WBITS, 8,
+                               Z_DEFAULT_STRATEGY));
+  zs.next_in = (void *)text;
+  zs.avail_in = sizeof(text);
+  zs.next_out = lfile + kZipLfileHdrMinSize + 3;
+  zs.avail_out = 16384;
+  ASSERT_EQ(Z_STREAM_END, deflate(&zs, Z_FINISH));
+  ASSERT_EQ(Z_OK, deflateEnd(&zs));
+  WRITE32LE(lfile, kZipLfileHdrMagic);
+  lfile[kZipLfileOffsetVersionNeeded] = kZipEra1993;
+  WRITE16LE(lfile + kZipLfileOffsetCompressionmethod, kZipCompressionDeflate);
+  WRITE32LE(lfile + kZipLfileOffsetCrc32, crc32_z(0, text, sizeof(text)));
+  WRITE32LE(lfile + kZipLfileOffsetCompressedsize, zs.total_out);
+  WRITE32LE(lfile + kZipLfileOffsetUncompressedsize, sizeof(text));
+  WRITE16LE(lfile + kZipLfileOffsetNamesize, 3);
+  memcpy(lfile + kZipLfileHdrMinSize, "abc", 3);
+  WRITE32LE(cfile, kZipCfileHdrMagic);
+  WRITE16LE(cfile + kZipCfileOffsetCompressionmethod, kZipCompressionDeflate);
+  WRITE32LE(cfile + kZipCfileOffsetCompressedsize, zs.total_out);
+}
+
+TEST(RecompressZipLfile, deflated_becomesZstd) {
+  char out[sizeof(text)];
+  size_t n, oldsize;
+  unsigned char *zstd;
+  oldsize = ZIP_LFILE_COMPRESSEDSIZE(lfile);
+  ASSERT_NE(NULL, (zstd = RecompressZipLfile(lfile, cfile, 19, &n)));
+  EXPECT_LT(n, oldsize);
+  EXPECT_EQ(kZipCompressionZstd, ZIP_LFILE_COMPRESSIONMETHOD(lfile));
+  EXPECT_EQ(kZipCompressionZstd, ZIP_CFILE_COMPRESSIONMETHOD(cfile));
+  EXPECT_EQ(kZipEra2020, ZIP_LFILE_VERSIONNEED(lfile));
+  EXPECT_EQ(n, ZIP_LFILE_COMPRESSEDSIZE(lfile));
+  EXPECT_EQ(n, ZIP_CFILE_COMPRESSEDSIZE(cfile));
+  EXPECT_EQ(sizeof(text), ZSTD_decompress(out, sizeof(out), zstd, n));
+  EXPECT_EQ(0, memcmp(out, text, sizeof(text)));
+  free(zstd);
+}
+
+TEST(RecompressZipLfile, stored_isLeftAlone) {
+  size_t n;
+  WRITE16LE(lfile + kZipLfileOffsetCompressionmethod, kZipCompressionNone);
+  EXPECT_EQ(NULL, RecompressZipLfile(lfile, cfile, 19, &n));
+  EXPECT_EQ(kZipCompressionDeflate, ZIP_CFILE_COMPRESSIONMETHOD(cfile));
+}
+
+TEST(RecompressZipLfile, badCrc_isLeftAlone) {
+  size_t n;
+  WRITE32LE(lfile + kZipLfileOffsetCrc32, 123);
+  EXPECT_EQ(NULL, RecompressZipLfile(lfile, cfile, 19, &n));
+  EXPECT_EQ(kZipCompressionDeflate, ZIP_LFILE_COMPRESSIONMETHOD(lfile));
+}
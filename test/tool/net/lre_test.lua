@@ -48,6 +48,22 @@ p,e = re.search("notfound", "fanatics have their dreams wherewith they weave")
 assert(not p)
 assert(e:errno() == re.NOMATCH)
 
+-- compiled patterns are cached by pattern and flags
+assert(re.search("^ab$", "AB", re.ICASE))
+assert(not re.search("^ab$", "AB"))
+assert(re.search("^ab$", "AB", re.ICASE))
+assert(re.search([[a\(b\)]], "ab", re.BASIC) == "ab")
+assert(not re.search([[a\(b\)]], "ab"))
+for i = 1,40 do
+   assert(re.search("^x" .. i .. "$", "x" .. i))
+   assert(not re.search("^x" .. i .. "$", "x" .. (i + 1)))
+   assert(re.search("^x1$", "x1"))
+end
+p,e = re.search("[{", "")
+assert(e:errno() == re.EBRACK)
+p,e = re.search("[{", "")
+assert(e:errno() == re.EBRACK)
+
 ----------------------------------------------------------------------------------------------------
 -- BENCHMARKS
 
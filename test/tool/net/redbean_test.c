@@ -293,4 +293,44 @@ Z\n",
   EXPECT_NE(-1, sigprocmask(SIG_SETMASK, &savemask, 0));
 }
 
+TEST(redbean, testThreadWorkersCloneRe) {
+  if (IsWindows())
+    return;
+  char portbuf[16];
+  int pid, pipefds[2];
+  sigset_t chldmask, savemask;
+  ASSERT_NE(-1, mkdir("www", 0755));
+  ASSERT_NE(-1, xbarf("www/re.lua",
+                      "Write(re.search([[[0-9]+]], 'ab12cd'))\n", -1));
+  sigaddset(&chldmask, SIGCHLD);
+  EXPECT_NE(-1, sigprocmask(SIG_BLOCK, &chldmask, &savemask));
+  ASSERT_NE(-1, pipe(pipefds));
+  ASSERT_NE(-1, (pid = fork()));
+  if (!pid) {
+    setpgrp();
+    close(0);
+    open("/dev/null", O_RDWR);
+    close(pipefds[0]);
+    dup2(pipefds[1], 1);
+    sigprocmask(SIG_SETMASK, &savemask, NULL);
+    execv("bin/redbean-tester",
+          (char *const[]){"bin/redbean-tester", "-vvszXp0", "-l127.0.0.1",
+                          "-Y1", "-Dwww", __strace > 0 ? "--strace" : 0, 0});
+    _exit(127);
+  }
+  EXPECT_NE(-1, close(pipefds[1]));
+  EXPECT_NE(-1, read(pipefds[0], portbuf, sizeof(portbuf)));
+  port = atoi(portbuf);
+  // re.search() of the lua state the thread worker cloned uses a cache
+  // that it has to create for itself, and the second call hits it
+  EXPECT_TRUE(Matches("^HTTP/1\\.1 200 OK\r\n.*\r\n\r\n12$",
+                      gc(SendHttpRequest("GET /re.lua HTTP/1.1\r\n\r\n"))));
+  EXPECT_TRUE(Matches("^HTTP/1\\.1 200 OK\r\n.*\r\n\r\n12$",
+                      gc(SendHttpRequest("GET /re.lua HTTP/1.1\r\n\r\n"))));
+  EXPECT_EQ(0, close(pipefds[0]));
+  EXPECT_NE(-1, kill(pid, SIGTERM));
+  EXPECT_NE(-1, wait(0));
+  EXPECT_NE(-1, sigprocmask(SIG_SETMASK, &savemask, 0));
+}
+
 #endif /* __x86_64__ */
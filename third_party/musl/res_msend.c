@@ -32,6 +32,7 @@
 #include "libc/errno.h"
 #include "libc/sock/sock.h"
 #include "libc/sock/sock.h"
+#include "libc/sock/struct/mmsghdr.h"
 #include "libc/sock/struct/msghdr.h"
 #include "libc/sock/struct/pollfd.h"
 #include "libc/str/str.h"
@@ -216,13 +217,30 @@ int __res_msend_rc(int nqueries, const unsigned char *const *queries,
 		if (i==nqueries) break;
 
 		if (t2-t1 >= retry_interval) {
-			/* Query all configured namservers in parallel */
-			for (i=0; i<nqueries; i++)
-				if (!alens[i])
-					for (j=0; j<nns; j++)
-						sendto(fd, queries[i],
-							qlens[i], MSG_NOSIGNAL,
-							(void *)&ns[j], sl);
+			/* Query all configured namservers in parallel, using
+			 * a single system call where supported [cosmo] */
+			struct mmsghdr mm[nqueries*MAXNS];
+			struct iovec qv[nqueries];
+			int nm = 0;
+			for (i=0; i<nqueries; i++) {
+				if (alens[i]) continue;
+				qv[i].iov_base = (void *)queries[i];
+				qv[i].iov_len = qlens[i];
+				for (j=0; j<nns; j++)
+					mm[nm++].msg_hdr = (struct msghdr){
+						.msg_name = (void *)&ns[j],
+						.msg_namelen = sl,
+						.msg_iov = qv+i,
+						.msg_iovlen = 1 };
+			}
+			/* Skip any message that fails, using sendto() only
+			 * if the system doesn't support sendmmsg() at all */
+			for (i=0; i<nm; i+=r>0?r:1)
+				if ((r = sendmmsg(fd, mm+i, nm-i, MSG_NOSIGNAL)) < 0
+				    && errno == ENOSYS)
+					sendto(fd, mm[i].msg_hdr.msg_iov->iov_base,
+						mm[i].msg_hdr.msg_iov->iov_len,
+						MSG_NOSIGNAL, mm[i].msg_hdr.msg_name, sl);
 			t1 = t2;
 			servfail_retry = 2 * nqueries;
 		}
@@ -55,20 +55,25 @@ static void wake_waiters (struct Dll *to_wake_list, int all_readers) {
 	}
 	if (pmu != NULL) { /* waiter is associated with the nsync_mu *pmu. */
 		/* We will transfer elements of to_wake_list to *pmu if all of:
-		    - some thread holds the lock, and
+		    - some thread holds the lock, or the first waiter
+		      will be woken rather than transferred, and
 		    - *pmu's spinlock is not held, and
 		    - either *pmu cannot be acquired in the mode of the first
 		      waiter, or there's more than one thread on to_wake_list
 		      and not all are readers, and
 		    - we acquire the spinlock on the first try.
 		   The spinlock acquisition also marks *pmu as having waiters.
-		   The requirement that some thread holds the lock ensures
-		   that at least one of the transferred waiters will be woken.
-		   */
+		   The requirement that some thread holds the lock, or that
+		   the first waiter is woken (since it'll acquire and release
+		   *pmu before returning), ensures that at least one of the
+		   transferred waiters will be woken. Transferring even when
+		   the lock isn't held matters because callers often signal
+		   after unlocking, and waking every waiter at once would just
+		   have them all pile onto *pmu (the thundering herd). */
 		uint32_t old_mu_word = ATM_LOAD (&pmu->word);
 		int first_cant_acquire = ((old_mu_word & first_w->l_type->zero_to_acquire) != 0);
 		next = dll_next (to_wake_list, first_waiter);
-		if ((old_mu_word&MU_ANY_LOCK) != 0 &&
+		if (((old_mu_word&MU_ANY_LOCK) != 0 || !first_cant_acquire) &&
 		    (old_mu_word&MU_SPINLOCK) == 0 &&
 		    (first_cant_acquire || (next != NULL && !all_readers)) &&
 		    ATM_CAS_ACQ (&pmu->word, old_mu_word,
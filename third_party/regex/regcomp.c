@@ -2921,6 +2921,7 @@ regcomp(regex_t *restrict preg, const char *restrict regex, int cflags)
   tnfa->final = transitions + offs[tree->lastpos[0].position];
   tnfa->num_states = parse_ctx.position;
   tnfa->cflags = cflags;
+  tnfa->dfa = tre_dfa_new(tnfa);
 
   tre_mem_destroy(mem);
   tre_stack_destroy(stack);
@@ -3000,5 +3001,6 @@ regfree(regex_t *preg)
     xfree(tnfa->firstpos_chars);
   if (tnfa->minimal_tags)
     xfree(tnfa->minimal_tags);
+  tre_dfa_destroy(tnfa->dfa);
   xfree(tnfa);
 }
@@ -1030,6 +1030,18 @@ regexec(const regex_t *restrict preg, const char *restrict string,
   reg_errcode_t status;
   regoff_t *tags = NULL, eo;
   if (tnfa->cflags & REG_NOSUB) nmatch = 0;
+
+  /* Try the lazy DFA first, which can't report submatches, but can
+     rule out a match much faster than the parallel matcher. */
+  if (tnfa->dfa)
+    {
+      status = tre_dfa_run(tnfa->dfa, string, eflags);
+      if (status == REG_NOMATCH)
+	return status;
+      if (status == REG_OK && nmatch == 0)
+	return status;
+    }
+
   if (tnfa->num_tags > 0 && nmatch > 0)
     {
       tags = xmalloc(sizeof(*tags) * tnfa->num_tags);
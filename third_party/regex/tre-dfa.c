@@ -0,0 +1,415 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "libc/intrin/atomic.h"
+#include "libc/limits.h"
+#include "libc/mem/mem.h"
+#include "libc/str/str.h"
+#include "third_party/regex/tre.inc"
+
+/**
+ * @fileoverview Lazy DFA for TRE.
+ *
+ * The parallel TNFA matcher visits every active state for every input
+ * character. When the caller only wants to know if there's a match, we
+ * can instead determinize the TNFA on the fly, remembering each set of
+ * active states along with where each ASCII character leads, so that a
+ * warm scan costs one table lookup per byte.
+ *
+ * Since TNFA states have no epsilon transitions, the only thing making
+ * this hard is assertions. Character classes only depend on the symbol
+ * being consumed. BOL only depends on the previous character. EOL only
+ * depends on the next character, so we don't follow those transitions;
+ * we just remember with a flag bit that the final state is reachable
+ * if the lookahead character turns out to be the end of a line. Word
+ * boundaries depend on both, and regexes using them aren't supported.
+ *
+ * The exact order in which the TNFA matcher decodes multibyte input is
+ * mirrored, so that invalid UTF-8 produces identical results.
+ */
+
+#define TRE_DFA_MAX_STATES 1024 /* flush cache when it grows beyond this */
+#define TRE_DFA_ASCII      128  /* characters having cached transitions */
+
+/* Flag bits stored after the TNFA state bits of each set. */
+#define TRE_DFA_ACCEPT      0 /* final state reached by consuming */
+#define TRE_DFA_ACCEPT_EOL  1 /* same but only if next is end of line */
+#define TRE_DFA_INITIAL     2 /* final state reached by starting match */
+#define TRE_DFA_INITIAL_EOL 3 /* same but only if next is end of line */
+#define TRE_DFA_FLAGS       4
+
+struct tre_dfa_state {
+  short next[TRE_DFA_ASCII]; /* -1 if not computed yet */
+  short flags;               /* 1 << TRE_DFA_ACCEPT etc. */
+  short dead;
+};
+
+struct tre_dfa {
+  atomic_int busy;
+  int words;    /* of uint64_t in each state set */
+  int anchored; /* can't match once the first char is consumed */
+  int count;
+  int capacity;
+  int flushes;
+  int start[2]; /* by REG_NOTBOL or -1 */
+  const tre_tnfa_t *tnfa;
+  tre_tnfa_transition_t **states; /* outgoing transitions by state id */
+  struct tre_dfa_state *table;
+  uint64_t *sets;
+  int *buckets; /* open addressed, twice capacity, -1 if empty */
+  uint64_t *scratch;
+};
+
+static int
+tre_dfa_supported(const tre_tnfa_t *tnfa, const tre_tnfa_transition_t *t)
+{
+  if (t->assertions & ~(ASSERT_AT_BOL | ASSERT_AT_EOL |
+                        ASSERT_CHAR_CLASS | ASSERT_CHAR_CLASS_NEG))
+    return 0;
+  /* with REG_NEWLINE, states after `$' could still consume a newline */
+  if ((t->assertions & ASSERT_AT_EOL) && (tnfa->cflags & REG_NEWLINE) &&
+      t->state != tnfa->final)
+    return 0;
+  return 1;
+}
+
+struct tre_dfa *
+tre_dfa_new(const tre_tnfa_t *tnfa)
+{
+  unsigned i;
+  struct tre_dfa *d;
+  const tre_tnfa_transition_t *t;
+  if (tnfa->have_backrefs || tnfa->have_approx ||
+      tnfa->num_states + TRE_DFA_FLAGS > 4096)
+    return NULL;
+  for (t = tnfa->initial; t->state; t++)
+    if (!tre_dfa_supported(tnfa, t))
+      return NULL;
+  for (i = 0; i < tnfa->num_transitions; i++)
+    if (tnfa->transitions[i].state &&
+        !tre_dfa_supported(tnfa, tnfa->transitions + i))
+      return NULL;
+  if (!(d = xcalloc(1, sizeof(*d))))
+    return NULL;
+  d->tnfa = tnfa;
+  d->words = (tnfa->num_states + TRE_DFA_FLAGS + 63) / 64;
+  d->start[0] = d->start[1] = -1;
+  d->states = xcalloc(tnfa->num_states, sizeof(*d->states));
+  d->scratch = xmalloc(d->words * sizeof(*d->scratch));
+  if (!d->states || !d->scratch)
+    {
+      tre_dfa_destroy(d);
+      return NULL;
+    }
+  for (i = 0; i < tnfa->num_transitions; i++)
+    if ((t = tnfa->transitions + i)->state)
+      d->states[t->state_id] = t->state;
+  d->anchored = !(tnfa->cflags & REG_NEWLINE);
+  for (t = tnfa->initial; t->state; t++)
+    {
+      d->states[t->state_id] = t->state;
+      if (!(t->assertions & ASSERT_AT_BOL))
+        d->anchored = 0;
+    }
+  return d;
+}
+
+void
+tre_dfa_destroy(struct tre_dfa *d)
+{
+  if (!d)
+    return;
+  xfree(d->states);
+  xfree(d->table);
+  xfree(d->sets);
+  xfree(d->buckets);
+  xfree(d->scratch);
+  xfree(d);
+}
+
+static unsigned
+tre_dfa_hash(const uint64_t *set, int words)
+{
+  int i;
+  uint64_t h;
+  for (h = i = 0; i < words; i++)
+    h = (h ^ set[i]) * 0x9e3779b97f4a7c15;
+  return h >> 32;
+}
+
+static void
+tre_dfa_insert(struct tre_dfa *d, int j)
+{
+  unsigned i, mask;
+  mask = d->capacity * 2 - 1;
+  i = tre_dfa_hash(d->sets + j * d->words, d->words) & mask;
+  while (d->buckets[i] != -1)
+    i = (i + 1) & mask;
+  d->buckets[i] = j;
+}
+
+static int
+tre_dfa_grow(struct tre_dfa *d)
+{
+  int j, n;
+  void *p, *q, *r;
+  n = d->capacity ? d->capacity * 2 : 16;
+  if (!(p = xrealloc(d->table, n * sizeof(*d->table))))
+    return -1;
+  d->table = p;
+  if (!(q = xrealloc(d->sets, n * d->words * sizeof(*d->sets))))
+    return -1;
+  d->sets = q;
+  if (!(r = xmalloc(n * 2 * sizeof(*d->buckets))))
+    return -1;
+  xfree(d->buckets);
+  d->buckets = r;
+  d->capacity = n;
+  memset(d->buckets, -1, n * 2 * sizeof(*d->buckets));
+  for (j = 0; j < d->count; j++)
+    tre_dfa_insert(d, j);
+  return 0;
+}
+
+static void
+tre_dfa_flush(struct tre_dfa *d)
+{
+  d->count = 0;
+  d->flushes++;
+  d->start[0] = d->start[1] = -1;
+  memset(d->buckets, -1, d->capacity * 2 * sizeof(*d->buckets));
+}
+
+static int
+tre_dfa_flags(const struct tre_dfa *d, const uint64_t *set)
+{
+  int i, b, flags = 0;
+  for (i = 0; i < TRE_DFA_FLAGS; i++)
+    {
+      b = d->tnfa->num_states + i;
+      flags |= ((set[b / 64] >> (b % 64)) & 1) << i;
+    }
+  return flags;
+}
+
+static int
+tre_dfa_empty(const uint64_t *set, int words)
+{
+  int i;
+  for (i = 0; i < words; i++)
+    if (set[i])
+      return 0;
+  return 1;
+}
+
+/* Returns index of DFA state for set, or -1 if out of memory. */
+static int
+tre_dfa_intern(struct tre_dfa *d, const uint64_t *set)
+{
+  int j;
+  unsigned i, mask;
+  if (d->capacity)
+    {
+      mask = d->capacity * 2 - 1;
+      for (i = tre_dfa_hash(set, d->words) & mask;
+           (j = d->buckets[i]) != -1; i = (i + 1) & mask)
+        if (!memcmp(d->sets + j * d->words, set,
+                    d->words * sizeof(*set)))
+          return j;
+    }
+  if (d->count == d->capacity)
+    {
+      if (d->capacity < TRE_DFA_MAX_STATES)
+        {
+          if (tre_dfa_grow(d) == -1)
+            return -1;
+        }
+      else
+        tre_dfa_flush(d);
+    }
+  j = d->count++;
+  memcpy(d->sets + j * d->words, set, d->words * sizeof(*set));
+  memset(d->table[j].next, -1, sizeof(d->table[j].next));
+  d->table[j].flags = tre_dfa_flags(d, set);
+  d->table[j].dead = d->anchored && tre_dfa_empty(set, d->words);
+  tre_dfa_insert(d, j);
+  return j;
+}
+
+static int
+tre_dfa_class(const tre_tnfa_t *tnfa, const tre_tnfa_transition_t *t,
+              tre_cint_t c)
+{
+  tre_ctype_t *p;
+  int icase = tnfa->cflags & REG_ICASE;
+  if ((t->assertions & ASSERT_CHAR_CLASS) &&
+      (icase ? !tre_isctype(tre_tolower(c), t->u.class) &&
+                   !tre_isctype(tre_toupper(c), t->u.class)
+             : !tre_isctype(c, t->u.class)))
+    return 0;
+  if (t->assertions & ASSERT_CHAR_CLASS_NEG)
+    for (p = t->neg_classes; *p; p++)
+      if (icase ? tre_isctype(tre_toupper(c), *p) ||
+                      tre_isctype(tre_tolower(c), *p)
+                : tre_isctype(c, *p))
+        return 0;
+  return 1;
+}
+
+/* Adds destination of transition to set if its assertions hold, where
+   `prev_c' is the character before the new position, `atbol' is true
+   at the start of a string not flagged REG_NOTBOL, and `consumed' says
+   whether `t' consumed `prev_c' rather than starting a new match. */
+static void
+tre_dfa_add(struct tre_dfa *d, uint64_t *set, const tre_tnfa_transition_t *t,
+            tre_cint_t prev_c, int atbol, int consumed)
+{
+  int b, a = t->assertions;
+  const tre_tnfa_t *tnfa = d->tnfa;
+  if ((a & ASSERT_AT_BOL) && !atbol &&
+      (prev_c != L'\n' || !(tnfa->cflags & REG_NEWLINE)))
+    return;
+  if (consumed && (a & (ASSERT_CHAR_CLASS | ASSERT_CHAR_CLASS_NEG)) &&
+      !tre_dfa_class(tnfa, t, prev_c))
+    return;
+  if (t->state == tnfa->final)
+    b = tnfa->num_states + (consumed ? TRE_DFA_ACCEPT : TRE_DFA_INITIAL) +
+        !!(a & ASSERT_AT_EOL);
+  else if (a & ASSERT_AT_EOL)
+    return; /* only the end of the string satisfies this */
+  else
+    b = t->state_id;
+  set[b / 64] |= 1ull << (b % 64);
+}
+
+static void
+tre_dfa_step(struct tre_dfa *d, const uint64_t *from, tre_cint_t c,
+             uint64_t *to)
+{
+  int i, b;
+  uint64_t w;
+  const tre_tnfa_transition_t *t;
+  memset(to, 0, d->words * sizeof(*to));
+  for (i = 0; i < d->words; i++)
+    for (w = from[i]; w; w &= w - 1)
+      {
+        if ((b = i * 64 + __builtin_ctzll(w)) >= d->tnfa->num_states)
+          break;
+        for (t = d->states[b]; t && t->state; t++)
+          if (t->code_min <= c && c <= t->code_max)
+            tre_dfa_add(d, to, t, c, 0, 1);
+      }
+  for (t = d->tnfa->initial; t->state; t++)
+    tre_dfa_add(d, to, t, c, 0, 0);
+}
+
+/* Decodes character like GET_NEXT_WCHAR() returning bytes consumed. */
+static int
+tre_dfa_decode(tre_cint_t *c, const char *s)
+{
+  int n;
+  wchar_t wc;
+  if (!(*s & 0x80))
+    {
+      *c = *s;
+      return 1;
+    }
+  if ((n = mbtowc(&wc, s, MB_LEN_MAX)) < 0)
+    return -1;
+  *c = wc;
+  return n ? n : 1;
+}
+
+int
+tre_dfa_run(struct tre_dfa *d, const char *s, int eflags)
+{
+  int k, n, cur, nxt, eol, flags, flushes, rc;
+  const tre_tnfa_transition_t *t;
+  tre_cint_t c, next_c;
+
+  /* regexec() is thread safe but our cache isn't */
+  if (atomic_exchange_explicit(&d->busy, 1, memory_order_acquire))
+    return -1;
+
+  rc = REG_NOMATCH;
+  if ((n = tre_dfa_decode(&next_c, s)) < 0)
+    goto done;
+  s += n;
+
+  k = !!(eflags & REG_NOTBOL);
+  if ((cur = d->start[k]) == -1)
+    {
+      memset(d->scratch, 0, d->words * sizeof(*d->scratch));
+      for (t = d->tnfa->initial; t->state; t++)
+        tre_dfa_add(d, d->scratch, t, 0, !k, 0);
+      if ((cur = tre_dfa_intern(d, d->scratch)) == -1)
+        {
+          rc = -1;
+          goto done;
+        }
+      d->start[k] = cur;
+    }
+
+  for (;;)
+    {
+      if ((flags = d->table[cur].flags))
+        {
+          eol = (next_c == 0 && !(eflags & REG_NOTEOL)) ||
+                (next_c == L'\n' && (d->tnfa->cflags & REG_NEWLINE));
+          if (!eol)
+            flags &= ~(1 << TRE_DFA_ACCEPT_EOL | 1 << TRE_DFA_INITIAL_EOL);
+          if (flags & (1 << TRE_DFA_ACCEPT | 1 << TRE_DFA_ACCEPT_EOL))
+            {
+              rc = REG_OK;
+              break;
+            }
+          if (flags)
+            {
+              /* the tnfa matcher decodes one more character here */
+              if (!next_c || tre_dfa_decode(&c, s) >= 0)
+                rc = REG_OK;
+              break;
+            }
+        }
+      if (!next_c || d->table[cur].dead)
+        break;
+      c = next_c;
+      if ((n = tre_dfa_decode(&next_c, s)) < 0)
+        break;
+      s += n;
+      if (c < TRE_DFA_ASCII && (nxt = d->table[cur].next[c]) != -1)
+        {
+          cur = nxt;
+          continue;
+        }
+      tre_dfa_step(d, d->sets + cur * d->words, c, d->scratch);
+      flushes = d->flushes;
+      if ((nxt = tre_dfa_intern(d, d->scratch)) == -1)
+        {
+          rc = -1;
+          break;
+        }
+      if (c < TRE_DFA_ASCII && flushes == d->flushes)
+        d->table[cur].next[c] = nxt;
+      cur = nxt;
+    }
+
+done:
+  atomic_store_explicit(&d->busy, 0, memory_order_release);
+  return rc;
+}
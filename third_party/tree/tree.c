@@ -25,6 +25,7 @@
 #include "libc/mem/mem.h"
 #include "libc/calls/calls.h"
 #include "libc/sysv/consts/f.h"
+#include "libc/sysv/consts/at.h"
 #include "libc/calls/struct/stat.h"
 #include "libc/calls/struct/stat.macros.h"
 #include "libc/calls/struct/dirent.h"
@@ -734,7 +735,7 @@ int patinclude(char *name, int isdir)
 /**
  * Split out stat portion from read_dir as prelude to just using stat structure directly.
  */
-struct _info *getinfo(char *name, char *path)
+struct _info *getinfo(int dfd, char *name, char *path)
 {
   static char *lbuf = NULL;
   static int lbufsize = 0;
@@ -744,10 +745,12 @@ struct _info *getinfo(char *name, char *path)
 
   if (lbuf == NULL) lbuf = xmalloc(lbufsize = PATH_MAX);
 
-  if (lstat(path,&lst) < 0) return NULL;
+  /* stat relative to the open directory, so the kernel needn't resolve
+   * every component of path again for each entry. */
+  if (fstatat(dfd,name,&lst,AT_SYMLINK_NOFOLLOW) < 0) return NULL;
 
   if ((lst.st_mode & S_IFMT) == S_IFLNK) {
-    if ((rs = stat(path,&st)) < 0) memset(&st, 0, sizeof(st));
+    if ((rs = fstatat(dfd,name,&st,0)) < 0) memset(&st, 0, sizeof(st));
   } else {
     rs = 0;
     st.st_mode = lst.st_mode;
@@ -855,7 +858,7 @@ struct _info **read_dir(char *dir, int *n, int infotop)
     if (es) sprintf(path, "%s%s", dir, ent->d_name);
     else sprintf(path,"%s/%s",dir,ent->d_name);
 
-    info = getinfo(ent->d_name, path);
+    info = getinfo(dirfd(d), ent->d_name, path);
     if (info) {
       if (showinfo && (com = infocheck(path, ent->d_name, infotop, info->isdir))) {
 	for(i = 0; com->desc[i] != NULL; i++);
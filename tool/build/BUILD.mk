@@ -60,6 +60,7 @@ TOOL_BUILD_DIRECTDEPS =							\
 	THIRD_PARTY_XED							\
 	THIRD_PARTY_ZLIB						\
 	THIRD_PARTY_ZLIB_GZ						\
+	THIRD_PARTY_ZSTD						\
 	TOOL_BUILD_LIB
 
 TOOL_BUILD_DEPS :=							\
@@ -53,6 +53,7 @@
 #include "third_party/getopt/getopt.internal.h"
 #include "third_party/zlib/zlib.h"
 #include "tool/build/lib/lib.h"
+#include "tool/build/lib/zipalign.h"
 
 #define VERSION                     \
   "apelink v0.1\n"                  \
@@ -142,6 +143,10 @@
   "  -B         force bypassing of any binfmt_misc loader\n"   \
   "             by using alternative 'APEDBG=' file magic\n"   \
   "\n"                                                         \
+  "  -a ALIGN   align stored zip assets at least ALIGN in\n"   \
+  "             size to ALIGN byte boundaries, e.g. 65536\n"   \
+  "             so zipos can mmap() them from the binary\n"    \
+  "\n"                                                         \
   "ARGUMENTS\n"                                                \
   "\n"                                                         \
   "  OUTPUT     is your ape executable\n"                      \
@@ -234,6 +239,7 @@ struct Assets {
 
 static int outfd;
 static int hashes;
+static size_t zipalign;
 static const char *prog;
 static bool want_stripped;
 static int support_vector;
@@ -985,8 +991,16 @@ static void AddLoader(const char *path) {
 static void GetOpts(int argc, char *argv[]) {
   int opt, bits;
   bool got_support_vector = false;
-  while ((opt = getopt(argc, argv, "hvgsGBo:l:S:M:V:")) != -1) {
+  while ((opt = getopt(argc, argv, "hvgsGBo:l:S:M:V:a:")) != -1) {
     switch (opt) {
+      case 'a':
+        HashInputString("-a");
+        HashInputString(optarg);
+        zipalign = atoi(optarg);
+        if (zipalign < 512 || zipalign > 65536 || !IS2POW(zipalign)) {
+          Die(prog, "-a alignment must be two power between 512 and 65536");
+        }
+        break;
       case 'o':
         outpath = optarg;
         break;
@@ -1796,6 +1810,28 @@ static void IndexZipAssetsFromElf(struct Input *in) {
   }
 }
 
+// pads extra field of large stored assets so their content lands on
+// a zipalign boundary in the output file.
+static void AlignZipAssets(Elf64_Off offset) {
+  int i;
+  size_t pad, hdrsize, size;
+  unsigned char *lfile, *lfile2;
+  for (i = 0; i < assets.n; ++i) {
+    lfile = assets.p[i].lfile;
+    size = ZIP_LFILE_SIZE(lfile);
+    if ((pad = GetZipLfilePadding(lfile, offset, zipalign))) {
+      lfile2 = Malloc(size + pad);
+      hdrsize = PadZipLfileHdr(lfile2, lfile, pad, zipalign);
+      memcpy(lfile2 + hdrsize, ZIP_LFILE_CONTENT(lfile),
+             ZIP_LFILE_COMPRESSEDSIZE(lfile));
+      assets.p[i].lfile = lfile2;
+      assets.total_local_file_bytes += pad;
+      size += pad;
+    }
+    offset += size;
+  }
+}
+
 static void CopyZips(Elf64_Off offset) {
   int i;
   for (i = 0; i < inputs.n; ++i) {
@@ -1807,6 +1843,9 @@ static void CopyZips(Elf64_Off offset) {
   if (!assets.n) {
     return;  // nothing to do
   }
+  if (zipalign) {
+    AlignZipAssets(offset);
+  }
   if (offset + assets.total_local_file_bytes + assets.total_centraldir_bytes +
           kZipCdirHdrMinSize >
       INT_MAX) {
@@ -27,6 +27,7 @@
 #include "libc/runtime/runtime.h"
 #include "libc/stdio/ftw.h"
 #include "libc/stdio/stdio.h"
+#include "libc/stdio/sysparam.h"
 #include "libc/str/str.h"
 #include "libc/sysv/consts/at.h"
 #include "libc/sysv/consts/ex.h"
@@ -36,6 +37,7 @@
 #include "libc/sysv/consts/s.h"
 #include "libc/x/x.h"
 #include "third_party/getopt/getopt.internal.h"
+#include "tool/build/lib/copy.h"
 
 #define USAGE \
   " SRC... DST\n\
@@ -66,6 +68,7 @@ char dstdir[PATH_MAX];
 char srcfile[PATH_MAX];
 char dstfile[PATH_MAX];
 char linkbuf[PATH_MAX];
+struct Copier *copier;
 
 void Cp(char *, char *);
 
@@ -161,24 +164,6 @@ char *Join(const char *a, const char *b) {
   return dstfile;
 }
 
-bool MovePreservingDestinationInode(const char *from, const char *to) {
-  bool res;
-  struct stat st;
-  int fdin, fdout;
-  if ((fdin = open(from, O_RDONLY)) == -1) {
-    return false;
-  }
-  fstat(fdin, &st);
-  if ((fdout = creat(to, st.st_mode)) == -1) {
-    close(fdin);
-    return false;
-  }
-  res = copyfd(fdin, fdout, -1) != -1;
-  close(fdin);
-  close(fdout);
-  return res;
-}
-
 void Cp(char *src, char *dst) {
   ssize_t rc;
   const char *s;
@@ -234,10 +219,7 @@ void Cp(char *src, char *dst) {
       exit(1);
     }
   } else {
-    if (!MovePreservingDestinationInode(src, dst)) {
-      perror(src);
-      exit(1);
-    }
+    CopyLater(copier, src, dst, 0);
   }
 }
 
@@ -255,9 +237,16 @@ int main(int argc, char *argv[]) {
     exit(1);
   }
 
+  // copying many files is mostly waiting, so overlap it
+  if (recursive || argc - optind > 2) {
+    copier = NewCopier(MIN(__get_cpu_count(), 16));
+  } else {
+    copier = NewCopier(0);
+  }
+
   for (i = optind; i < argc - 1; ++i) {
     Cp(argv[i], argv[argc - 1]);
   }
 
-  return 0;
+  return FreeCopier(copier) ? 1 : 0;
 }
@@ -54,6 +54,7 @@ TOOL_BUILD_LIB_A_DIRECTDEPS =				\
 	THIRD_PARTY_MBEDTLS				\
 	THIRD_PARTY_XED					\
 	THIRD_PARTY_ZLIB				\
+	THIRD_PARTY_ZSTD				\
 	THIRD_PARTY_TZ
 
 TOOL_BUILD_LIB_A_DEPS :=				\
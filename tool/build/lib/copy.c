@@ -0,0 +1,354 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "tool/build/lib/copy.h"
+#include "libc/calls/calls.h"
+#include "libc/calls/struct/stat.h"
+#include "libc/calls/struct/timespec.h"
+#include "libc/dce.h"
+#include "libc/errno.h"
+#include "libc/mem/mem.h"
+#include "libc/runtime/runtime.h"
+#include "libc/sock/sock.h"
+#include "libc/stdio/stdio.h"
+#include "libc/stdio/sysparam.h"
+#include "libc/str/str.h"
+#include "libc/sysv/consts/o.h"
+#include "libc/thread/thread.h"
+
+#define FICLONE 0x40049409 /* linux _IOW(0x94, 9, int) */
+#define CHUNK   0x7ffff000 /* largest transfer linux allows */
+#define BUFSZ   65536
+
+struct Copier {
+  int threads;
+  bool closing;
+  _Atomic(int) failures;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  struct CopyJob {
+    struct CopyJob *next;
+    int flags;
+    char *src;
+    char *dst;
+  } *head, **tail;
+  pthread_t th[];
+};
+
+// returns true if a fancier copy method just isn't available here, in
+// which case we should move on to the next one. since these all use an
+// implicit file position, a method giving up halfway through is fine.
+static bool IsUnsupported(int e) {
+  return e == ENOSYS ||      //
+         e == EXDEV ||       //
+         e == EINVAL ||      //
+         e == EOPNOTSUPP ||  //
+         e == EBADF ||       //
+         e == ENOTSOCK ||    //
+         e == ESPIPE;
+}
+
+static int CopyRemaining(int in, int out) {
+  char *buf;
+  ssize_t rc, wrote;
+  size_t i;
+  if (!(buf = malloc(BUFSZ)))
+    return -1;
+  for (;;) {
+    if ((rc = read(in, buf, BUFSZ)) == -1) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    if (!rc)
+      break;
+    for (i = 0; i < rc; i += wrote) {
+      if ((wrote = write(out, buf + i, rc - i)) == -1) {
+        if (errno == EINTR) {
+          wrote = 0;
+          continue;
+        }
+        free(buf);
+        return -1;
+      }
+    }
+  }
+  free(buf);
+  return rc ? -1 : 0;
+}
+
+/**
+ * Copies remaining content of file `in` to file `out`.
+ *
+ * This tries a reflink clone first, which is instant on copy-on-write
+ * filesystems like btrfs and xfs. Then copy_file_range() is attempted,
+ * so the kernel may share extents or use server-side copy. Then there
+ * is sendfile(), which at least avoids copying through userspace. If
+ * none of those are possible, we fall back to read() and write().
+ *
+ * Cloning replaces the whole of `out` with the whole of `in` so it's
+ * only attempted when both file positions are at the beginning.
+ *
+ * @return 0 on success, or -1 w/ errno
+ */
+int CopyData(int in, int out) {
+  ssize_t rc;
+  if (IsLinux() &&                   //
+      !lseek(in, 0, SEEK_CUR) &&     //
+      !lseek(out, 0, SEEK_CUR) &&    //
+      !ioctl(out, FICLONE, (void *)(intptr_t)in)) {
+    return 0;
+  }
+  for (;;) {
+    if ((rc = copy_file_range(in, 0, out, 0, CHUNK, 0)) > 0)
+      continue;
+    if (!rc)
+      return 0;
+    if (errno == EINTR)
+      continue;
+    if (!IsUnsupported(errno))
+      return -1;
+    break;
+  }
+  for (;;) {
+    if ((rc = sendfile(out, in, 0, CHUNK)) > 0)
+      continue;
+    if (!rc)
+      return 0;
+    if (errno == EINTR)
+      continue;
+    if (!IsUnsupported(errno))
+      return -1;
+    break;
+  }
+  return CopyRemaining(in, out);
+}
+
+/**
+ * Copies `n` bytes from `in` at `inoff` to `out` at `outoff`.
+ *
+ * Neither file position is changed. This uses copy_file_range() when
+ * possible and otherwise falls back to pread() and pwrite().
+ *
+ * @return bytes copied, which is less than `n` only on end of file,
+ *     or -1 w/ errno
+ */
+ssize_t CopyRange(int in, int64_t inoff, int out, int64_t outoff, size_t n) {
+  char *buf;
+  size_t i, j;
+  ssize_t rc, wrote;
+  for (i = 0; i < n; i += rc) {
+    rc = copy_file_range(in, &inoff, out, &outoff, MIN(n - i, CHUNK), 0);
+    if (rc > 0)
+      continue;
+    if (!rc)
+      return i;
+    if (errno == EINTR) {
+      rc = 0;
+      continue;
+    }
+    if (!IsUnsupported(errno))
+      return -1;
+    break;
+  }
+  if (i == n)
+    return i;
+  if (!(buf = malloc(BUFSZ)))
+    return -1;
+  while (i < n) {
+    if ((rc = pread(in, buf, MIN(n - i, BUFSZ), inoff)) == -1) {
+      if (errno == EINTR)
+        continue;
+      free(buf);
+      return -1;
+    }
+    if (!rc)
+      break;
+    for (j = 0; j < rc; j += wrote) {
+      if ((wrote = pwrite(out, buf + j, rc - j, outoff + j)) == -1) {
+        if (errno == EINTR) {
+          wrote = 0;
+          continue;
+        }
+        free(buf);
+        return -1;
+      }
+    }
+    inoff += rc;
+    outoff += rc;
+    i += rc;
+  }
+  free(buf);
+  return i;
+}
+
+/**
+ * Copies regular file from `src` to `dst`.
+ *
+ * The destination is created with the mode bits of the source, or is
+ * truncated if it already exists, so its inode is preserved. It's
+ * removed if the copy fails partway.
+ *
+ * @param flags may have COPY_MOVE to unlink `src` afterwards, in which
+ *     case its timestamps and ownership are kept too, like rename()
+ * @return 0 on success, or -1 w/ errno
+ */
+int CopyPath(const char *src, const char *dst, int flags) {
+  int rc, e;
+  int in, out;
+  struct stat st;
+  if ((in = open(src, O_RDONLY)) == -1)
+    return -1;
+  if (fstat(in, &st) == -1 || (out = creat(dst, st.st_mode & 07777)) == -1) {
+    e = errno;
+    close(in);
+    errno = e;
+    return -1;
+  }
+  rc = CopyData(in, out);
+  e = errno;
+  close(in);
+  if (!rc && (flags & COPY_MOVE)) {
+    fchown(out, st.st_uid, st.st_gid);  // best effort unless root
+    if (fchmod(out, st.st_mode & 07777) ||
+        futimens(out, (struct timespec[]){st.st_atim, st.st_mtim})) {
+      e = errno;
+      rc = -1;
+    }
+  }
+  if (close(out) && !rc) {
+    e = errno;
+    rc = -1;
+  }
+  if (rc)
+    unlink(dst);
+  else if (flags & COPY_MOVE)
+    if ((rc = unlink(src)))
+      e = errno;
+  errno = e;
+  return rc;
+}
+
+static void *CopyWorker(void *arg) {
+  struct CopyJob *job;
+  struct Copier *c = arg;
+  for (;;) {
+    pthread_mutex_lock(&c->lock);
+    while (!(job = c->head) && !c->closing)
+      pthread_cond_wait(&c->cond, &c->lock);
+    if (job && !(c->head = job->next))
+      c->tail = &c->head;
+    pthread_mutex_unlock(&c->lock);
+    if (!job)
+      return 0;
+    if (CopyPath(job->src, job->dst, job->flags)) {
+      tinyprint(2, job->src, ": ", strerror(errno), "\n", NULL);
+      ++c->failures;
+    }
+    free(job->src);
+    free(job->dst);
+    free(job);
+  }
+}
+
+/**
+ * Creates pool of threads for copying many files concurrently.
+ *
+ * Build tools like cp and mv spend most of their time waiting on i/o
+ * for small files, so overlapping that latency helps a lot even when
+ * the kernel is doing the actual copying.
+ *
+ * @param threads is worker count, where 0 means copy synchronously
+ * @return object which must be freed using FreeCopier()
+ */
+struct Copier *NewCopier(int threads) {
+  int i;
+  struct Copier *c;
+  threads = MAX(threads, 0);
+  if ((c = calloc(1, sizeof(*c) + threads * sizeof(pthread_t)))) {
+    pthread_mutex_init(&c->lock, 0);
+    pthread_cond_init(&c->cond, 0);
+    c->tail = &c->head;
+    for (i = 0; i < threads; ++i) {
+      if (pthread_create(c->th + i, 0, CopyWorker, c))
+        break;
+      ++c->threads;
+    }
+  }
+  return c;
+}
+
+/**
+ * Schedules copy of `src` to `dst`.
+ *
+ * If the copier has no workers, the copy happens synchronously. Errors
+ * are reported on standard error and counted by FreeCopier().
+ *
+ * @param flags may have COPY_MOVE to unlink `src` afterwards
+ */
+void CopyLater(struct Copier *c, const char *src, const char *dst, int flags) {
+  struct CopyJob *job;
+  if (!c || !c->threads || !(job = malloc(sizeof(*job)))) {
+    if (CopyPath(src, dst, flags)) {
+      tinyprint(2, src, ": ", strerror(errno), "\n", NULL);
+      if (c)
+        ++c->failures;
+      else
+        exit(1);
+    }
+    return;
+  }
+  job->next = 0;
+  job->flags = flags;
+  job->src = strdup(src);
+  job->dst = strdup(dst);
+  if (!job->src || !job->dst) {
+    free(job->src);
+    free(job->dst);
+    free(job);
+    tinyprint(2, src, ": out of memory\n", NULL);
+    exit(1);
+  }
+  pthread_mutex_lock(&c->lock);
+  *c->tail = job;
+  c->tail = &job->next;
+  pthread_cond_signal(&c->cond);
+  pthread_mutex_unlock(&c->lock);
+}
+
+/**
+ * Waits for scheduled copies to finish and frees copier.
+ *
+ * @return number of copies that failed
+ */
+int FreeCopier(struct Copier *c) {
+  int i, failures;
+  if (!c)
+    return 0;
+  pthread_mutex_lock(&c->lock);
+  c->closing = true;
+  pthread_cond_broadcast(&c->cond);
+  pthread_mutex_unlock(&c->lock);
+  for (i = 0; i < c->threads; ++i)
+    pthread_join(c->th[i], 0);
+  failures = c->failures;
+  pthread_cond_destroy(&c->cond);
+  pthread_mutex_destroy(&c->lock);
+  free(c);
+  return failures;
+}
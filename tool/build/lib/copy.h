@@ -0,0 +1,19 @@
+#ifndef COSMOPOLITAN_TOOL_BUILD_LIB_COPY_H_
+#define COSMOPOLITAN_TOOL_BUILD_LIB_COPY_H_
+
+#define COPY_MOVE 1 /* unlink source once copy succeeds */
+
+COSMOPOLITAN_C_START_
+
+struct Copier;
+
+int CopyData(int, int);
+ssize_t CopyRange(int, int64_t, int, int64_t, size_t);
+int CopyPath(const char *, const char *, int);
+
+struct Copier *NewCopier(int);
+void CopyLater(struct Copier *, const char *, const char *, int);
+int FreeCopier(struct Copier *);
+
+COSMOPOLITAN_C_END_
+#endif /* COSMOPOLITAN_TOOL_BUILD_LIB_COPY_H_ */
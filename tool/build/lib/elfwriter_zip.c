@@ -36,14 +36,16 @@
 #include "libc/zip.h"
 #include "net/http/http.h"
 #include "third_party/zlib/zlib.h"
+#include "third_party/zstd/zstd.h"
 #include "tool/build/lib/elfwriter.h"
 
 #define ZIP_CFILE_HDR_SIZE (kZipCfileHdrMinSize + 36)
 
 static bool ShouldCompress(const char *name, size_t namesize,
                            const unsigned char *data, size_t datasize,
-                           bool nocompress) {
-  return !nocompress && datasize >= 64 && !IsNoCompressExt(name, namesize) &&
+                           int method) {
+  return method != kZipCompressionNone && datasize >= 64 &&
+         !IsNoCompressExt(name, namesize) &&
          (datasize < 1000 || MeasureEntropy((void *)data, 1000) < 7);
 }
 
@@ -56,7 +58,9 @@ static void GetDosLocalTime(int64_t utcunixts, uint16_t *out_time,
 }
 
 static int DetermineVersionNeededToExtract(int method) {
-  if (method == kZipCompressionDeflate) {
+  if (method == kZipCompressionZstd) {
+    return kZipEra2020;
+  } else if (method == kZipCompressionDeflate) {
     return kZipEra1993;
   } else {
     return kZipEra1989;
@@ -139,17 +143,20 @@ static void EmitZipCdirHdr(unsigned char *p, const void *name, size_t namesize,
 
 /**
  * Embeds zip file in elf object.
+ *
+ * @param method is kZipCompressionDeflate or kZipCompressionZstd, which
+ *     is used unless content is incompressible, or kZipCompressionNone
  */
 void elfwriter_zip(struct ElfWriter *elf, const char *symbol, const char *cname,
                    size_t namesize, const void *data, size_t size,
                    uint32_t mode, struct timespec mtim, struct timespec atim,
-                   struct timespec ctim, bool nocompress) {
+                   struct timespec ctim, int method) {
   z_stream zs;
   uint8_t era;
   uint32_t crc;
   unsigned char *lfile, *cfile;
   struct ElfWriterSymRef lfilesym;
-  uint16_t method, gflags, mtime, mdate, iattrs;
+  uint16_t gflags, mtime, mdate, iattrs;
   size_t lfilehdrsize, uncompsize, compsize, commentsize;
 
   CHECK_NE(0, mtim.tv_sec);
@@ -175,9 +182,8 @@ void elfwriter_zip(struct ElfWriter *elf, const char *symbol, const char *cname,
   if (S_ISREG(mode) && istext(data, size)) {
     iattrs |= kZipIattrText;
   }
-  method = ShouldCompress(name, namesize, data, size, nocompress)
-               ? kZipCompressionDeflate
-               : kZipCompressionNone;
+  if (!ShouldCompress(name, namesize, data, size, method))
+    method = kZipCompressionNone;
 
   /* emit embedded file content w/ pkzip local file header */
   elfwriter_align(elf, 1, 0);
@@ -199,13 +205,23 @@ void elfwriter_zip(struct ElfWriter *elf, const char *symbol, const char *cname,
     } else {
       method = kZipCompressionNone;
     }
+  } else if (method == kZipCompressionZstd) {
+    compsize = ZSTD_compressBound(uncompsize);
+    lfile = elfwriter_reserve(elf, lfilehdrsize + compsize);
+    compsize = ZSTD_compress(lfile + lfilehdrsize, compsize, data, uncompsize,
+                             ZSTD_CLEVEL_DEFAULT);
+    CHECK(!ZSTD_isError(compsize));
+    if (compsize >= uncompsize) {
+      compsize = uncompsize;
+      method = kZipCompressionNone;
+    }
   } else {
     lfile = elfwriter_reserve(elf, lfilehdrsize + uncompsize);
   }
   if (method == kZipCompressionNone) {
     memcpy(lfile + lfilehdrsize, data, uncompsize);
   }
-  era = method ? kZipEra1993 : kZipEra1989;
+  era = DetermineVersionNeededToExtract(method);
   EmitZipLfileHdr(lfile, name, namesize, crc, era, gflags, method, mtime, mdate,
                   compsize, uncompsize);
   elfwriter_commit(elf, lfilehdrsize + compsize);
@@ -0,0 +1,260 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "tool/build/lib/walk.h"
+#include "libc/calls/calls.h"
+#include "libc/calls/struct/dirent.h"
+#include "libc/calls/struct/stat.h"
+#include "libc/errno.h"
+#include "libc/intrin/atomic.h"
+#include "libc/limits.h"
+#include "libc/mem/mem.h"
+#include "libc/str/str.h"
+#include "libc/sysv/consts/at.h"
+#include "libc/sysv/consts/dt.h"
+#include "libc/sysv/consts/o.h"
+#include "libc/sysv/consts/s.h"
+#include "libc/thread/thread.h"
+
+struct WalkDir {
+  struct WalkDir *next;
+  struct WalkDir *parent;
+  _Atomic(int) pending;
+  char path[];
+};
+
+struct Walker {
+  int err;
+  bool done;
+  void *arg;
+  walk_f *fn;
+  _Atomic(bool) stop;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  struct WalkDir *stack;
+};
+
+static int GetDirentType(unsigned mode) {
+  return (mode & S_IFMT) >> 12;
+}
+
+static void StopWalk(struct Walker *w, int err) {
+  if (!atomic_exchange(&w->stop, true)) {
+    w->err = err;
+  }
+}
+
+static bool Visit(struct Walker *w, int dirfd, const char *name,
+                  const char *path, int type, int how) {
+  if (w->stop)
+    return false;
+  if (w->fn(dirfd, name, path, type, how, w->arg) == -1) {
+    StopWalk(w, errno);
+    return false;
+  }
+  return true;
+}
+
+static struct WalkDir *NewDir(struct Walker *w, struct WalkDir *parent,
+                              const char *name) {
+  char *p;
+  size_t n, m;
+  struct WalkDir *d;
+  n = parent ? strlen(parent->path) : 0;
+  m = strlen(name);
+  if (n + 1 + m + 1 > PATH_MAX) {
+    StopWalk(w, ENAMETOOLONG);
+    return 0;
+  }
+  if (!(d = malloc(sizeof(*d) + n + 1 + m + 1))) {
+    StopWalk(w, errno);
+    return 0;
+  }
+  d->next = 0;
+  d->parent = parent;
+  d->pending = 1;
+  p = d->path;
+  if (n) {
+    p = stpcpy(p, parent->path);
+    if (p[-1] != '/')
+      *p++ = '/';
+  }
+  stpcpy(p, name);
+  return d;
+}
+
+// directories are kept on a stack, so the walk stays mostly depth first
+// and the number of directories waiting around is bounded by the width
+// of the tree rather than its total size.
+static void PushDir(struct Walker *w, struct WalkDir *d) {
+  pthread_mutex_lock(&w->lock);
+  d->next = w->stack;
+  w->stack = d;
+  pthread_cond_signal(&w->cond);
+  pthread_mutex_unlock(&w->lock);
+}
+
+static struct WalkDir *PopDir(struct Walker *w) {
+  struct WalkDir *d;
+  pthread_mutex_lock(&w->lock);
+  while (!(d = w->stack) && !w->done)
+    pthread_cond_wait(&w->cond, &w->lock);
+  if (d)
+    w->stack = d->next;
+  pthread_mutex_unlock(&w->lock);
+  return d;
+}
+
+// releases reference on directory. whichever thread drops the last one
+// gets to visit it in post order, and then releases its parent too.
+static void FinishDir(struct Walker *w, struct WalkDir *d) {
+  struct WalkDir *parent;
+  for (; d; d = parent) {
+    if (--d->pending)
+      return;
+    Visit(w, AT_FDCWD, d->path, d->path, DT_DIR, WALK_POST);
+    parent = d->parent;
+    free(d);
+  }
+  pthread_mutex_lock(&w->lock);
+  w->done = true;
+  pthread_cond_broadcast(&w->cond);
+  pthread_mutex_unlock(&w->lock);
+}
+
+static void ScanDir(struct Walker *w, struct WalkDir *d) {
+  DIR *dir;
+  int fd, type;
+  bool retried;
+  size_t n, m;
+  struct stat st;
+  struct dirent *ent;
+  struct WalkDir *child;
+  char path[PATH_MAX];
+  if (!Visit(w, AT_FDCWD, d->path, d->path, DT_DIR, WALK_DIR))
+    goto Finish;
+  for (retried = false;; retried = true) {
+    fd = open(d->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd != -1)
+      break;
+    if (retried || !Visit(w, AT_FDCWD, d->path, d->path, DT_DIR, WALK_DNR))
+      goto Finish;
+  }
+  if (!(dir = fdopendir(fd))) {
+    StopWalk(w, errno);
+    close(fd);
+    goto Finish;
+  }
+  n = stpcpy(path, d->path) - path;
+  if (path[n - 1] != '/')
+    path[n++] = '/';
+  while (!w->stop && (ent = readdir(dir))) {
+    if (ent->d_name[0] == '.' &&
+        (!ent->d_name[1] || (ent->d_name[1] == '.' && !ent->d_name[2])))
+      continue;
+    if ((type = ent->d_type) == DT_UNKNOWN) {
+      if (fstatat(fd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) != -1)
+        type = GetDirentType(st.st_mode);
+    }
+    if (type == DT_DIR) {
+      if ((child = NewDir(w, d, ent->d_name))) {
+        ++d->pending;
+        PushDir(w, child);
+      }
+    } else {
+      m = strlen(ent->d_name);
+      if (n + m + 1 > PATH_MAX) {
+        StopWalk(w, ENAMETOOLONG);
+        break;
+      }
+      memcpy(path + n, ent->d_name, m + 1);
+      Visit(w, fd, ent->d_name, path, type, WALK_FILE);
+    }
+  }
+  closedir(dir);
+Finish:
+  FinishDir(w, d);
+}
+
+static void *WalkWorker(void *arg) {
+  struct WalkDir *d;
+  struct Walker *w = arg;
+  while ((d = PopDir(w)))
+    ScanDir(w, d);
+  return 0;
+}
+
+/**
+ * Walks directory tree using multiple threads.
+ *
+ * This is intended for build tools that need to chew through output
+ * trees with millions of files, e.g. `rm -rf o/`. Unlike nftw() this
+ * doesn't stat() every entry; the type comes from the getdents() batch
+ * whenever the filesystem provides it. Non-directories are reported
+ * with a file descriptor of their parent, so `fn` may use the `*at()`
+ * system calls to avoid path resolution. Subdirectories get scanned
+ * concurrently, but a directory is only visited as `WALK_POST` after
+ * everything beneath it has been visited.
+ *
+ * The callback is `fn(dirfd, name, path, type, how, arg)` where type is
+ * a `DT_*` constant and how is a `WALK_*` constant. It may be called by
+ * several threads at once. Returning -1 halts the walk with its errno.
+ * For `WALK_DNR` returning 0 causes the open to be retried once, which
+ * lets callers fix permissions.
+ *
+ * Symbolic links are never followed. If `path` isn't a directory then
+ * `fn` is simply called once for it, with `dirfd` being `AT_FDCWD`.
+ *
+ * @param threads is number of threads, including the caller's own
+ * @return 0 on success, or -1 w/ errno
+ */
+int WalkTree(const char *path, walk_f *fn, void *arg, int threads) {
+  int i, n;
+  pthread_t *th;
+  struct stat st;
+  struct WalkDir *root;
+  struct Walker w = {.fn = fn, .arg = arg};
+  if (fstatat(AT_FDCWD, path, &st, AT_SYMLINK_NOFOLLOW) == -1)
+    return -1;
+  if (!S_ISDIR(st.st_mode))
+    return fn(AT_FDCWD, path, path, GetDirentType(st.st_mode), WALK_FILE, arg);
+  if (!(root = NewDir(&w, 0, path))) {
+    errno = w.err;
+    return -1;
+  }
+  pthread_mutex_init(&w.lock, 0);
+  pthread_cond_init(&w.cond, 0);
+  w.stack = root;
+  n = 0;
+  th = 0;
+  if (threads > 1 && (th = malloc((threads - 1) * sizeof(*th))))
+    for (i = 0; i < threads - 1; ++i)
+      if (!pthread_create(th + n, 0, WalkWorker, &w))
+        ++n;
+  WalkWorker(&w);
+  for (i = 0; i < n; ++i)
+    pthread_join(th[i], 0);
+  free(th);
+  pthread_cond_destroy(&w.cond);
+  pthread_mutex_destroy(&w.lock);
+  if (w.stop) {
+    errno = w.err;
+    return -1;
+  }
+  return 0;
+}
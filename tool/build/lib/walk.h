@@ -0,0 +1,16 @@
+#ifndef COSMOPOLITAN_TOOL_BUILD_LIB_WALK_H_
+#define COSMOPOLITAN_TOOL_BUILD_LIB_WALK_H_
+
+#define WALK_FILE 0 /* non-directory, relative to dirfd */
+#define WALK_DIR  1 /* directory, before its contents */
+#define WALK_POST 2 /* directory, after all its contents */
+#define WALK_DNR  3 /* directory that couldn't be opened */
+
+COSMOPOLITAN_C_START_
+
+typedef int walk_f(int, const char *, const char *, int, int, void *);
+
+int WalkTree(const char *, walk_f *, void *, int);
+
+COSMOPOLITAN_C_END_
+#endif /* COSMOPOLITAN_TOOL_BUILD_LIB_WALK_H_ */
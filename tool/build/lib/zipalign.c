@@ -0,0 +1,76 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "tool/build/lib/zipalign.h"
+#include "libc/serialize.h"
+#include "libc/stdio/sysparam.h"
+#include "libc/str/str.h"
+#include "libc/zip.h"
+
+/**
+ * Returns padding needed to align stored content of zip local file.
+ *
+ * Stored assets whose content begins on a page boundary may be mapped
+ * straight out of the executable by zipos mmap(), so every process can
+ * share the same page cache. Padding goes in the extra field, which is
+ * what Android's zipalign does, so other zip tools don't mind.
+ *
+ * @param lfile is local file header followed by its content
+ * @param offset is where `lfile` is going to be written in output
+ * @param align is a two power, or 0 to disable alignment
+ * @return bytes of padding to add, which is 0 if `lfile` isn't stored,
+ *     is too small to be worth aligning, or can't be padded
+ */
+size_t GetZipLfilePadding(const unsigned char *lfile, uint64_t offset,
+                          size_t align) {
+  size_t pad;
+  if (!align)
+    return 0;
+  if (ZIP_LFILE_COMPRESSIONMETHOD(lfile) != kZipCompressionNone)
+    return 0;
+  if (ZIP_LFILE_COMPRESSEDSIZE(lfile) < align)
+    return 0;
+  if (!(pad = -(offset + ZIP_LFILE_HDRSIZE(lfile)) & (align - 1)))
+    return 0;
+  if (pad < kZipExtraHdrSize + 2)
+    pad += align;
+  if (ZIP_LFILE_EXTRASIZE(lfile) + pad > 65535)
+    return 0;
+  return pad;
+}
+
+/**
+ * Copies local file header adding padding to its extra field.
+ *
+ * @param out needs `ZIP_LFILE_HDRSIZE(lfile) + pad` bytes
+ * @param pad was returned by GetZipLfilePadding()
+ * @param align is alignment passed to GetZipLfilePadding()
+ * @return bytes written to `out`
+ */
+size_t PadZipLfileHdr(unsigned char *out, const unsigned char *lfile,
+                      size_t pad, size_t align) {
+  unsigned char *p;
+  size_t n = ZIP_LFILE_HDRSIZE(lfile);
+  p = mempcpy(out, lfile, n);
+  WRITE16LE(out + kZipLfileOffsetExtrasize, ZIP_LFILE_EXTRASIZE(lfile) + pad);
+  p = WRITE16LE(p, kZipExtraAlign);
+  p = WRITE16LE(p, pad - kZipExtraHdrSize);
+  p = WRITE16LE(p, MIN(align, 65535));
+  bzero(p, pad - kZipExtraHdrSize - 2);
+  return n + pad;
+}
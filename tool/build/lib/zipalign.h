@@ -0,0 +1,9 @@
+#ifndef COSMOPOLITAN_TOOL_BUILD_LIB_ZIPALIGN_H_
+#define COSMOPOLITAN_TOOL_BUILD_LIB_ZIPALIGN_H_
+COSMOPOLITAN_C_START_
+
+size_t GetZipLfilePadding(const unsigned char *, uint64_t, size_t);
+size_t PadZipLfileHdr(unsigned char *, const unsigned char *, size_t, size_t);
+
+COSMOPOLITAN_C_END_
+#endif /* COSMOPOLITAN_TOOL_BUILD_LIB_ZIPALIGN_H_ */
@@ -0,0 +1,76 @@
+/*-*- mode:c;indent-tabs-mode:nil;c-basic-offset:2;tab-width:8;coding:utf-8 -*-│
+│ vi: set et ft=c ts=2 sts=2 sw=2 fenc=utf-8                               :vi │
+╞══════════════════════════════════════════════════════════════════════════════╡
+│ Copyright 2024 Justine Alexandra Roberts Tunney                              │
+│                                                                              │
+│ Permission to use, copy, modify, and/or distribute this software for         │
+│ any purpose with or without fee is hereby granted, provided that the         │
+│ above copyright notice and this permission notice appear in all copies.      │
+│                                                                              │
+│ THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL                │
+│ WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED                │
+│ WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE             │
+│ AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL         │
+│ DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR        │
+│ PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER               │
+│ TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR             │
+│ PERFORMANCE OF THIS SOFTWARE.                                                │
+╚─────────────────────────────────────────────────────────────────────────────*/
+#include "tool/build/lib/zipzstd.h"
+#include "libc/mem/mem.h"
+#include "libc/runtime/internal.h"
+#include "libc/serialize.h"
+#include "libc/zip.h"
+#include "third_party/zlib/zlib.h"
+#include "third_party/zstd/zstd.h"
+
+/**
+ * Recompresses deflated zip local file content with zstd.
+ *
+ * If this succeeds, then the compression method, version needed, and
+ * compressed size fields of both `lfile` and `cfile` are updated to
+ * describe the returned content, which replaces the old content.
+ *
+ * @param lfile is local file header followed by its content
+ * @param cfile is central directory record of `lfile`
+ * @param level is zstd compression level, e.g. 19
+ * @param out_size receives byte length of returned content
+ * @return new content, which caller must free(), or NULL if `lfile`
+ *     isn't deflated, is zip64, has a data descriptor, is corrupt, or
+ *     wouldn't get any smaller
+ */
+void *RecompressZipLfile(unsigned char *lfile, unsigned char *cfile,
+                         int level, size_t *out_size) {
+  void *data, *res;
+  size_t size, compsize, zsize;
+  if (ZIP_LFILE_COMPRESSIONMETHOD(lfile) != kZipCompressionDeflate)
+    return 0;
+  if (ZIP_LFILE_GENERALFLAG(lfile) & 8)
+    return 0;  // sizes are in data descriptor
+  size = ZIP_LFILE_UNCOMPRESSEDSIZE(lfile);
+  compsize = ZIP_LFILE_COMPRESSEDSIZE(lfile);
+  if (size == 0xffffffff || compsize == 0xffffffff)
+    return 0;
+  if (!(data = malloc(size + 1)))
+    return 0;
+  res = 0;
+  if (!__inflate(data, size, ZIP_LFILE_CONTENT(lfile), compsize) &&
+      crc32_z(0, data, size) == ZIP_LFILE_CRC32(lfile) &&
+      (res = malloc((zsize = ZSTD_compressBound(size))))) {
+    zsize = ZSTD_compress(res, zsize, data, size, level);
+    if (!ZSTD_isError(zsize) && zsize < compsize) {
+      lfile[kZipLfileOffsetVersionNeeded] = kZipEra2020;
+      WRITE16LE(lfile + kZipLfileOffsetCompressionmethod, kZipCompressionZstd);
+      WRITE32LE(lfile + kZipLfileOffsetCompressedsize, zsize);
+      cfile[kZipCfileOffsetVersionNeeded] = kZipEra2020;
+      WRITE16LE(cfile + kZipCfileOffsetCompressionmethod, kZipCompressionZstd);
+      WRITE32LE(cfile + kZipCfileOffsetCompressedsize, zsize);
+      *out_size = zsize;
+    } else {
+      free(res);
+      res = 0;
+    }
+  }
+  free(data);
+  return res;
+}
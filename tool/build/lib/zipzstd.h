@@ -0,0 +1,8 @@
+#ifndef COSMOPOLITAN_TOOL_BUILD_LIB_ZIPZSTD_H_
+#define COSMOPOLITAN_TOOL_BUILD_LIB_ZIPZSTD_H_
+COSMOPOLITAN_C_START_
+
+void *RecompressZipLfile(unsigned char *, unsigned char *, int, size_t *);
+
+COSMOPOLITAN_C_END_
+#endif /* COSMOPOLITAN_TOOL_BUILD_LIB_ZIPZSTD_H_ */
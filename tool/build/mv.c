@@ -27,12 +27,14 @@
 #include "libc/runtime/runtime.h"
 #include "libc/stdio/ftw.h"
 #include "libc/stdio/stdio.h"
+#include "libc/stdio/sysparam.h"
 #include "libc/str/str.h"
 #include "libc/sysv/consts/at.h"
 #include "libc/sysv/consts/ok.h"
 #include "libc/sysv/consts/s.h"
 #include "libc/x/x.h"
 #include "third_party/getopt/getopt.internal.h"
+#include "tool/build/lib/copy.h"
 
 #define USAGE \
   " SRC... DST\n\
@@ -59,6 +61,7 @@ char dstdir[PATH_MAX];
 char srcfile[PATH_MAX];
 char dstfile[PATH_MAX];
 char linkbuf[PATH_MAX];
+struct Copier *copier;
 
 void Mv(char *, char *);
 
@@ -207,7 +210,11 @@ void Mv(char *src, char *dst) {
     }
   } else {
     if (rename(src, dst)) {
-      SysDie(src, "rename");
+      if (errno != EXDEV) {
+        SysDie(src, "rename");
+      }
+      // moving across filesystems means copying it
+      CopyLater(copier, src, dst, COPY_MOVE);
     }
   }
 }
@@ -220,8 +227,13 @@ int main(int argc, char *argv[]) {
   GetOpts(argc, argv);
   if (argc - optind < 2)
     PrintUsage(1, 2);
+  if (recursive || argc - optind > 2) {
+    copier = NewCopier(MIN(__get_cpu_count(), 16));
+  } else {
+    copier = NewCopier(0);
+  }
   for (i = optind; i < argc - 1; ++i) {
     Mv(argv[i], argv[argc - 1]);
   }
-  return 0;
+  return FreeCopier(copier) ? 1 : 0;
 }
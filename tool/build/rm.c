@@ -21,12 +21,15 @@
 #include "libc/errno.h"
 #include "libc/fmt/magnumstrs.internal.h"
 #include "libc/runtime/runtime.h"
-#include "libc/stdio/ftw.h"
 #include "libc/stdio/stdio.h"
+#include "libc/stdio/sysparam.h"
 #include "libc/str/str.h"
+#include "libc/sysv/consts/at.h"
+#include "libc/sysv/consts/dt.h"
 #include "libc/sysv/consts/ok.h"
 #include "libc/sysv/consts/s.h"
 #include "third_party/getopt/getopt.internal.h"
+#include "tool/build/lib/walk.h"
 
 #define USAGE \
   " FILE...\n\
@@ -75,26 +78,38 @@ static void GetOpts(int argc, char *argv[]) {
   }
 }
 
-static int OnFile(const char *fpath, const struct stat *st, int typeflag,
-                  struct FTW *ftwbuf) {
+static int OnFile(int dirfd, const char *name, const char *path, int type,
+                  int how, void *arg) {
   int rc;
-  if (!force && typeflag == FTW_DNR) {
-    rc = -1;
-  } else if (!force && !S_ISLNK(st->st_mode) && access(fpath, W_OK)) {
-    rc = -1;
-  } else if (typeflag == FTW_DNR) {
-    if (!(rc = chmod(fpath, 0700))) {
-      rc = nftw(fpath, OnFile, 128 - ftwbuf->level, FTW_PHYS | FTW_DEPTH);
-    }
-  } else if (typeflag == FTW_DP) {
-    rc = rmdir(fpath);
-  } else {
-    rc = unlink(fpath);
+  switch (how) {
+    case WALK_DIR:
+      return 0;
+    case WALK_DNR:
+      if (force) {
+        rc = chmod(path, 0700);  // retry
+      } else {
+        rc = -1;
+      }
+      break;
+    case WALK_POST:
+      if (!force && access(path, W_OK)) {
+        rc = -1;
+      } else {
+        rc = rmdir(path);
+      }
+      break;
+    default:
+      if (!force && type != DT_LNK && faccessat(dirfd, name, W_OK, 0)) {
+        rc = -1;
+      } else {
+        rc = unlinkat(dirfd, name, 0);
+      }
+      break;
   }
   if (rc == -1) {
     if (force && errno == ENOENT)
       return 0;
-    perror(fpath);
+    perror(path);
     exit(1);
   }
   return 0;
@@ -108,7 +123,7 @@ static void Remove(const char *path) {
     exit(1);
   }
   if (recursive) {
-    rc = nftw(path, OnFile, 128, FTW_PHYS | FTW_DEPTH);
+    rc = WalkTree(path, OnFile, 0, MIN(__get_cpu_count(), 16));
   } else {
     if (lstat(path, &st)) {
       if (force && errno == ENOENT)
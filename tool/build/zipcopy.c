@@ -22,8 +22,11 @@
 #include "libc/elf/struct/ehdr.h"
 #include "libc/elf/struct/shdr.h"
 #include "libc/errno.h"
+#include "libc/fmt/conv.h"
 #include "libc/fmt/magnumstrs.internal.h"
 #include "libc/limits.h"
+#include "libc/macros.h"
+#include "libc/mem/mem.h"
 #include "libc/runtime/runtime.h"
 #include "libc/serialize.h"
 #include "libc/stdio/stdio.h"
@@ -34,9 +37,14 @@
 #include "libc/sysv/consts/prot.h"
 #include "libc/zip.h"
 #include "third_party/getopt/getopt.internal.h"
+#include "tool/build/lib/copy.h"
+#include "tool/build/lib/zipalign.h"
+#include "tool/build/lib/zipzstd.h"
 
 static int infd;
 static int outfd;
+static size_t align;
+static int zstdlevel;
 static ssize_t insize;
 static ssize_t outsize;
 static const char *prog;
@@ -83,6 +91,11 @@ DESCRIPTION\n\
 FLAGS\n\
 \n\
   -h            show this help\n\
+  -a ALIGN      align stored assets at least ALIGN bytes in size\n\
+                to ALIGN byte boundaries, e.g. 65536, so zipos\n\
+                can mmap() them straight from the executable\n\
+  -z LEVEL      recompress deflated assets with zstd at LEVEL, e.g.\n\
+                19, when doing so makes them smaller\n\
 \n\
 EXAMPLE\n\
 \n\
@@ -97,8 +110,20 @@ EXAMPLE\n\
 
 static void GetOpts(int argc, char *argv[]) {
   int opt;
-  while ((opt = getopt(argc, argv, "h")) != -1) {
+  while ((opt = getopt(argc, argv, "ha:z:")) != -1) {
     switch (opt) {
+      case 'a':
+        align = atoi(optarg);
+        if (align < 512 || align > 65536 || !IS2POW(align)) {
+          Die(prog, "alignment must be two power between 512 and 65536");
+        }
+        break;
+      case 'z':
+        zstdlevel = atoi(optarg);
+        if (zstdlevel < 1 || zstdlevel > 22) {
+          Die(prog, "zstd level must be between 1 and 22");
+        }
+        break;
       case 'h':
         PrintUsage(1, 0);
       default:
@@ -112,11 +137,44 @@ static void GetOpts(int argc, char *argv[]) {
   outpath = argv[optind + 1];
 }
 
+static void CopyLocalFiles(unsigned long off, unsigned long dest,
+                           unsigned long length) {
+  if (length && CopyRange(infd, off, outfd, dest, length) != length) {
+    SysDie(outpath, "lfile copy");
+  }
+}
+
+static void CopyAlignedLocalFile(unsigned char *lfile, size_t pad,
+                                 unsigned long dest) {
+  unsigned char *hdr;
+  size_t hdrsize = ZIP_LFILE_HDRSIZE(lfile);
+  hdr = malloc(hdrsize + pad);
+  hdrsize = PadZipLfileHdr(hdr, lfile, pad, align);
+  if (pwrite(outfd, hdr, hdrsize, dest) != hdrsize) {
+    SysDie(outpath, "lfile pwrite");
+  }
+  free(hdr);
+  CopyLocalFiles(ZIP_LFILE_CONTENT(lfile) - inmap, dest + hdrsize,
+                 ZIP_LFILE_COMPRESSEDSIZE(lfile));
+}
+
+static void CopyRecompressedLocalFile(unsigned char *lfile, void *data,
+                                      unsigned long dest) {
+  size_t hdrsize = ZIP_LFILE_HDRSIZE(lfile);
+  size_t size = ZIP_LFILE_COMPRESSEDSIZE(lfile);
+  if (pwrite(outfd, lfile, hdrsize, dest) != hdrsize ||
+      pwrite(outfd, data, size, dest + hdrsize) != size) {
+    SysDie(outpath, "lfile pwrite");
+  }
+}
+
 static void CopyZip(void) {
   char *secstrs;
-  int rela, recs;
+  int i, rela, recs;
+  void **zstd = 0;
+  size_t zsize;
   Elf64_Ehdr *ehdr;
-  unsigned long ldest, cdest, ltotal, ctotal, length;
+  unsigned long ldest, cdest, ltotal, ctotal, length, runoff, runlen, pad;
   unsigned char *ineof, *stop, *eocd, *cdir, *lfile, *cfile;
 
   // find zip eocd header
@@ -179,6 +237,26 @@ static void CopyZip(void) {
     Die(outpath, "the time has come to upgrade to zip64");
   }
 
+  // recompress deflated assets
+  //
+  // this rewrites the headers in our private mapping of the input, so
+  // the size computations below see the new content length.
+  //
+  if (zstdlevel && recs) {
+    if (!(zstd = calloc(recs, sizeof(*zstd)))) {
+      SysDie(prog, "calloc");
+    }
+    for (i = 0, cfile = cdir; cfile < stop;
+         ++i, cfile += ZIP_CFILE_HDRSIZE(cfile)) {
+      lfile = inmap + ZIP_CFILE_OFFSET(cfile);
+      length = ZIP_LFILE_SIZE(lfile);
+      if ((zstd[i] = RecompressZipLfile(lfile, cfile, zstdlevel, &zsize))) {
+        ltotal -= length;
+        ltotal += ZIP_LFILE_SIZE(lfile);
+      }
+    }
+  }
+
   // write output
   if ((outfd = open(outpath, O_WRONLY | O_CREAT, 0644)) == -1) {
     SysDie(outpath, "open");
@@ -186,15 +264,47 @@ static void CopyZip(void) {
   if ((outsize = lseek(outfd, 0, SEEK_END)) == -1) {
     SysDie(outpath, "lseek");
   }
+  if (align) {
+    for (ldest = outsize, cfile = cdir; cfile < stop;
+         cfile += ZIP_CFILE_HDRSIZE(cfile)) {
+      lfile = inmap + ZIP_CFILE_OFFSET(cfile);
+      pad = GetZipLfilePadding(lfile, ldest, align);
+      ldest += ZIP_LFILE_SIZE(lfile) + pad;
+      ltotal += pad;
+    }
+    if (outsize + ltotal + ctotal + ZIP_CDIR_HDRSIZE(eocd) > INT_MAX) {
+      Die(outpath, "the time has come to upgrade to zip64");
+    }
+  }
   ldest = outsize;
   cdest = outsize + ltotal;
-  for (cfile = cdir; cfile < stop; cfile += ZIP_CFILE_HDRSIZE(cfile)) {
+  runoff = runlen = 0;
+  for (i = 0, cfile = cdir; cfile < stop;
+       ++i, cfile += ZIP_CFILE_HDRSIZE(cfile)) {
     lfile = inmap + ZIP_CFILE_OFFSET(cfile);
     WRITE32LE(cfile + kZipCfileOffsetOffset, ldest);
     // write local file
+    //
+    // local files are usually adjacent, in which case we coalesce them
+    // into a single copy_file_range() that the kernel can reflink.
+    //
     length = ZIP_LFILE_SIZE(lfile);
-    if (pwrite(outfd, lfile, length, ldest) != length) {
-      SysDie(outpath, "lfile pwrite");
+    if (zstd && zstd[i]) {
+      CopyLocalFiles(runoff, ldest - runlen, runlen);
+      CopyRecompressedLocalFile(lfile, zstd[i], ldest);
+      free(zstd[i]);
+      runlen = 0;
+    } else if ((pad = GetZipLfilePadding(lfile, ldest, align))) {
+      CopyLocalFiles(runoff, ldest - runlen, runlen);
+      CopyAlignedLocalFile(lfile, pad, ldest);
+      runlen = 0;
+      length += pad;
+    } else if (runlen && lfile - inmap == runoff + runlen) {
+      runlen += length;
+    } else {
+      CopyLocalFiles(runoff, ldest - runlen, runlen);
+      runoff = lfile - inmap;
+      runlen = length;
     }
     ldest += length;
     // write directory entry
@@ -204,6 +314,8 @@ static void CopyZip(void) {
     }
     cdest += length;
   }
+  CopyLocalFiles(runoff, ldest - runlen, runlen);
+  free(zstd);
   WRITE32LE(eocd + kZipCdirOffsetOffset, outsize + ltotal);
   length = ZIP_CDIR_HDRSIZE(eocd);
   if (pwrite(outfd, eocd, length, cdest) != length) {
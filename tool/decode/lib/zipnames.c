@@ -23,6 +23,7 @@
 const struct IdName kZipCompressionNames[] = {
     {kZipCompressionNone, "kZipCompressionNone"},
     {kZipCompressionDeflate, "kZipCompressionDeflate"},
+    {kZipCompressionZstd, "kZipCompressionZstd"},
     {0, 0},
 };
 
@@ -69,5 +70,6 @@ const struct IdName kZipEraNames[] = {
     {kZipEra1989, "kZipEra1989"},
     {kZipEra1993, "kZipEra1993"},
     {kZipEra2001, "kZipEra2001"},
+    {kZipEra2020, "kZipEra2020"},
     {0, 0},
 };
@@ -730,6 +730,23 @@ function SetHeader(name, value) end
 ---@param options { Expires: string|integer?, MaxAge: integer?, Domain: string?, Path: string?, Secure: boolean?, HttpOnly: boolean?, SameSite: "Strict"|"Lax"|"None"? }?
 function SetCookie(name, value, options) end
 
+--- Asks redbean to remember the response of this Lua Server Page for the
+--- specified number of seconds, so identical requests can be answered
+--- from shared memory without running Lua again. Responses are keyed by
+--- the method (only `GET` and `HEAD` are cached), the Host, and the
+--- request target including its query string. Any header names that are
+--- passed, e.g. `"Cookie"` or `"Accept-Language"`, are also made part of
+--- the key. When an entry expires, one worker regenerates it while the
+--- others keep serving the stale copy. Responses with Set-Cookie headers,
+--- 5xx statuses, or output that was yielded by coroutines aren't cached.
+--- Since the cache is consulted before `OnHttpRequest` is called, access
+--- checks won't be performed on cache hits, unless the relevant headers
+--- are listed. Passing `0` disables caching for the current response.
+--- See also `ProgramPageCache`.
+---@param seconds number
+---@param ... string names of request headers that vary the response
+function SetCacheTTL(seconds, ...) end
+
 --- Returns first value associated with name. name is handled in a case-sensitive manner. This function checks Request-URL parameters first. Then it checks `application/x-www-form-urlencoded` from the message body, if it exists, which is common for HTML forms sending `POST` requests. If a parameter is supplied matching name that has no value, e.g. `foo` in `?foo&bar=value`, then the returned value will be `nil`, whereas for `?foo=&bar=value` it would be `""`. To differentiate between no-equal and absent, use the `HasParam` function. The returned value is decoded from ISO-8859-1 (only in the case of Request-URL) and we assume that percent-encoded characters were supplied by the client as UTF-8 sequences, which are returned exactly as the client supplied them, and may therefore may contain overlong sequences, control codes, `NUL` characters, and even numbers which have been banned by the IETF. It is the responsibility of the caller to impose further restrictions on validity, if they're desired.
 ---@param name string
 ---@return string value
@@ -1672,6 +1689,25 @@ function ProgramTimeout(milliseconds) end
 ---@param uint16 integer
 function ProgramPort(uint16) end
 
+--- Sets the size of the shared memory arena in which redbean keeps
+--- gzip encoded copies of static assets, so they only need to be
+--- compressed once, rather than on every request. This applies to
+--- local files served via -D as well as uncompressed (stored) zip
+--- assets. The default is 16mb. Assets larger than an eighth of
+--- the cache are compressed on the fly as before. The cache is
+--- emptied whenever it fills up. Passing 0 disables it. This
+--- function can only be called from `.init.lua`.
+---@param bytes integer
+function ProgramGzipCache(bytes) end
+
+--- Sets the size of the shared memory arena in which redbean keeps
+--- responses of Lua Server Pages that called `SetCacheTTL`. The default
+--- is 8mb. Responses larger than an eighth of the cache are never cached.
+--- The cache is emptied whenever it fills up. Passing 0 disables it.
+--- This function can only be called from `.init.lua`.
+---@param bytes integer
+function ProgramPageCache(bytes) end
+
 --- Sets the maximum HTTP message payload size in bytes. The
 --- default is very conservatively set to 65536 so this is
 --- something many people will want to increase. This limit is
@@ -1705,7 +1741,10 @@ function ProgramRedirect(code, src, location) end
 
 --- Defaults to `86400` (24 hours). This may be set to `≤0` to disable SSL tickets.
 --- It's a good idea to use these since it increases handshake performance 10x and
---- eliminates a network round trip. This function is not available in unsecure mode.
+--- eliminates a network round trip. It also bounds how long sessions resumed by
+--- id are remembered in the cache that's shared between worker processes, which
+--- is used by clients that don't support tickets. This function is not available
+--- in unsecure mode.
 ---@param seconds integer
 function ProgramSslTicketLifetime(seconds) end
 
@@ -1852,6 +1891,29 @@ function ProgramLogPath(str) end
 ---@param str string
 function ProgramPidPath(str) end
 
+--- Same as the `-N` flag if called from `.init.lua`. Rather than forking a process
+--- for each connection, redbean keeps a pool of `workers` long-lived processes (one
+--- per CPU if 0), each of which serves many connections. On Linux every worker
+--- accepts on its own `SO_REUSEPORT` listener so the kernel spreads the load. Each
+--- worker serves one connection at a time, so it ends a keep-alive connection after
+--- the current response whenever other clients are queued on its listener. A
+--- worker is replaced after it has served `connections` clients (default 10000) or
+--- its peak resident memory has grown by `bytes` (default 64mb).
+---@param workers integer
+---@param connections integer?
+---@param bytes integer?
+function ProgramPrefork(workers, connections, bytes) end
+
+--- Same as the `-Y` flag if called from `.init.lua`. Rather than forking a process
+--- for each connection, redbean starts `workers` threads (one per CPU if 0) that
+--- each poll many idle keep-alive connections and only serve one once its next
+--- message arrives. Each thread gets a copy of the Lua state made by `.init.lua`.
+--- Userdata and coroutines aren't copied, so those should be created by
+--- `OnWorkerStart`, which every thread calls. SSL is disabled in this mode, and
+--- `Fetch()` returns an error for HTTPS URLs.
+---@param workers integer
+function ProgramThreads(workers) end
+
 --- Same as the `-u` flag if called from `.init.lua`. Can be used to configure the
 --- uniprocess mode. The current value is returned.
 ---@param bool boolean?
@@ -3720,7 +3782,7 @@ function re.Regex:search(str, flags) end
 --- - `re.NOTBOL`
 --- - `re.NOTEOL`
 ---
---- This has exponential complexity. Please use `re.compile()` to compile your regular expressions once from `/.init.lua`. This API exists for convenience. This isn't recommended for prod.
+--- The sixteen most recently used patterns are kept compiled, so searching with a constant regex is fast. Using `re.compile()` is still recommended for patterns that vary or are plentiful.
 ---
 --- This uses POSIX extended syntax by default.
 ---@return string match, string ... the match, followed by any captured groups
@@ -7009,7 +7071,7 @@ function unix.getrusage(who) end
 ---
 --- ### dns
 ---
---- Allows sendto, recvfrom, socket(AF_INET), connect.
+--- Allows sendto, sendmmsg, recvfrom, socket(AF_INET), connect.
 ---
 --- ### recvfd
 ---
@@ -22,11 +22,13 @@
 #include "libc/log/check.h"
 #include "libc/runtime/runtime.h"
 #include "libc/sock/sock.h"
+#include "libc/sock/struct/mmsghdr.h"
 #include "libc/sock/struct/sockaddr.h"
 #include "libc/stdio/rand.h"
 #include "libc/str/str.h"
 #include "libc/sysv/consts/af.h"
 #include "libc/sysv/consts/ipproto.h"
+#include "libc/sysv/consts/msg.h"
 #include "libc/sysv/consts/sock.h"
 #include "net/http/http.h"
 #include "net/http/ip.h"
@@ -36,8 +38,14 @@
  * use it to fill your network with junk data
  */
 
+#define BATCH 32  // datagrams per system call
+
 int sock;
 char buf[1000];
+char bufs[BATCH][1000];
+struct iovec iov[BATCH];
+struct mmsghdr msgs[BATCH];
+struct sockaddr_in addrs[BATCH];
 struct sockaddr_in addr = {0};
 uint32_t addrsize = sizeof(struct sockaddr_in);
 
@@ -49,9 +57,24 @@ void PrintUsage(char **argv) {
   exit(1);
 }
 
+void SetUpBatch(void) {
+  int i;
+  for (i = 0; i < BATCH; ++i) {
+    iov[i].iov_base = bufs[i];
+    iov[i].iov_len = sizeof(bufs[i]);
+    msgs[i].msg_hdr.msg_iov = iov + i;
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+}
+
+void SendBatch(int n) {
+  int i, rc;
+  for (i = 0; i < n; i += rc)
+    CHECK_NE(-1, (rc = sendmmsg(sock, msgs + i, n - i, 0)));
+}
+
 void UdpServer(void) {
-  int ip;
-  ssize_t rc;
+  int i, n, ip;
   struct sockaddr_in addr2;
   uint32_t addrsize2 = sizeof(struct sockaddr_in);
   CHECK_NE(-1, (sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)));
@@ -60,20 +83,27 @@ void UdpServer(void) {
   ip = ntohl(addr2.sin_addr.s_addr);
   kprintf("udp server %hhu.%hhu.%hhu.%hhu %hu%n", ip >> 24, ip >> 16, ip >> 8,
           ip, ntohs(addr2.sin_port));
+  SetUpBatch();
   for (;;) {
-    CHECK_NE(-1, (rc = recvfrom(sock, buf, sizeof(buf), 0,
-                                (struct sockaddr *)&addr2, &addrsize2)));
-    CHECK_NE(-1,
-             sendto(sock, buf, rc, 0, (struct sockaddr *)&addr2, addrsize2));
+    for (i = 0; i < BATCH; ++i) {
+      iov[i].iov_len = sizeof(bufs[i]);
+      msgs[i].msg_hdr.msg_name = addrs + i;
+      msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+    }
+    CHECK_NE(-1, (n = recvmmsg(sock, msgs, BATCH, MSG_WAITFORONE, 0)));
+    for (i = 0; i < n; ++i)
+      iov[i].iov_len = msgs[i].msg_len;
+    SendBatch(n);
   }
 }
 
 void UdpClient(void) {
   CHECK_NE(-1, (sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)));
   CHECK_NE(-1, connect(sock, (struct sockaddr *)&addr, addrsize));
+  SetUpBatch();
   for (;;) {
-    rngset(buf, sizeof(buf), _rand64, -1);
-    CHECK_NE(-1, write(sock, &addr, addrsize));
+    rngset(bufs, sizeof(bufs), _rand64, -1);
+    SendBatch(BATCH);
   }
 }
 
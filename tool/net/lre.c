@@ -17,15 +17,33 @@
 │ PERFORMANCE OF THIS SOFTWARE.                                                │
 ╚─────────────────────────────────────────────────────────────────────────────*/
 #include "libc/macros.h"
+#include "libc/mem/mem.h"
 #include "libc/str/str.h"
 #include "third_party/lua/lauxlib.h"
 #include "third_party/regex/regex.h"
 
+#define RE_CACHE_SIZE 16
+
 struct ReErrno {
   int err;
   char doc[64];
 };
 
+// recently used patterns of re.search(), most recent first
+struct ReCache {
+  int n;
+  struct ReCacheEntry {
+    int flags;
+    size_t size;
+    char *pattern;
+    regex_t rx;
+  } e[RE_CACHE_SIZE];
+};
+
+// address is registry key of re.Cache, which isn't kept in an upvalue
+// since redbean's thread workers can't copy userdata when cloning lua
+static const char kReCacheKey = 'r';
+
 static void LuaSetIntField(lua_State *L, const char *k, lua_Integer v) {
   lua_pushinteger(L, v);
   lua_setfield(L, -2, k);
@@ -74,14 +92,71 @@ static int LuaReSearchImpl(lua_State *L, regex_t *r, const char *s, int f) {
   }
 }
 
+static struct ReCache *LuaReGetCache(lua_State *L) {
+  struct ReCache *c;
+  if (lua_rawgetp(L, LUA_REGISTRYINDEX, &kReCacheKey) == LUA_TUSERDATA) {
+    c = lua_touserdata(L, -1);
+  } else {
+    lua_pop(L, 1);
+    c = lua_newuserdatauv(L, sizeof(struct ReCache), 0);
+    c->n = 0;
+    luaL_setmetatable(L, "re.Cache");
+    lua_pushvalue(L, -1);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &kReCacheKey);
+  }
+  lua_pop(L, 1);  // registry keeps it alive
+  return c;
+}
+
+static regex_t *LuaReCompileCached(lua_State *L, const char *p, size_t n,
+                                   int f) {
+  int i, rc;
+  regex_t rx;
+  char *pattern;
+  struct ReCache *c;
+  struct ReCacheEntry e;
+  c = LuaReGetCache(L);
+  f &= REG_EXTENDED | REG_ICASE | REG_NEWLINE | REG_NOSUB;
+  for (i = 0; i < c->n; ++i) {
+    if (c->e[i].flags == f && c->e[i].size == n &&
+        !memcmp(c->e[i].pattern, p, n)) {
+      e = c->e[i];
+      memmove(c->e + 1, c->e, i * sizeof(*c->e));
+      c->e[0] = e;
+      return &c->e[0].rx;
+    }
+  }
+  if ((rc = regcomp(&rx, p, f ^ REG_EXTENDED)) != REG_OK) {
+    LuaReReturnError(L, &rx, rc);
+    return NULL;
+  }
+  if (!(pattern = malloc(n))) {
+    regfree(&rx);
+    luaL_error(L, "out of memory");
+    __builtin_unreachable();
+  }
+  if (c->n == RE_CACHE_SIZE) {
+    --c->n;
+    regfree(&c->e[c->n].rx);
+    free(c->e[c->n].pattern);
+  }
+  memmove(c->e + 1, c->e, c->n++ * sizeof(*c->e));
+  c->e[0].flags = f;
+  c->e[0].size = n;
+  c->e[0].pattern = memcpy(pattern, p, n);
+  c->e[0].rx = rx;
+  return &c->e[0].rx;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // re
 
 static int LuaReSearch(lua_State *L) {
   int f;
+  size_t n;
   regex_t *r;
   const char *p, *s;
-  p = luaL_checkstring(L, 1);
+  p = luaL_checklstring(L, 1, &n);
   s = luaL_checkstring(L, 2);
   f = luaL_optinteger(L, 3, 0);
   if (f & ~(REG_EXTENDED | REG_ICASE | REG_NEWLINE | REG_NOSUB |
@@ -89,7 +164,7 @@ static int LuaReSearch(lua_State *L) {
     luaL_argerror(L, 3, "invalid flags");
     __builtin_unreachable();
   }
-  if ((r = LuaReCompileImpl(L, p, f))) {
+  if ((r = LuaReCompileCached(L, p, n, f))) {
     return LuaReSearchImpl(L, r, s, f);
   } else {
     return 2;
@@ -203,6 +278,32 @@ static void LuaReErrnoObj(lua_State *L) {
   lua_pop(L, 1);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// re.Cache
+
+static int LuaReCacheGc(lua_State *L) {
+  int i;
+  struct ReCache *c;
+  c = luaL_checkudata(L, 1, "re.Cache");
+  for (i = 0; i < c->n; ++i) {
+    regfree(&c->e[i].rx);
+    free(c->e[i].pattern);
+  }
+  c->n = 0;
+  return 0;
+}
+
+static const luaL_Reg kLuaReCacheMeta[] = {
+    {"__gc", LuaReCacheGc},  //
+    {0},                     //
+};
+
+static void LuaReCacheObj(lua_State *L) {
+  luaL_newmetatable(L, "re.Cache");
+  luaL_setfuncs(L, kLuaReCacheMeta, 0);
+  lua_pop(L, 1);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 _Alignas(1) static const struct thatispacked {
@@ -231,6 +332,7 @@ _Alignas(1) static const struct thatispacked {
 int LuaRe(lua_State *L) {
   int i;
   char buf[9];
+  LuaReCacheObj(L);
   luaL_newlib(L, kLuaRe);
   LuaSetIntField(L, "NOTBOL", REG_NOTBOL << 8);  // search flag
   LuaSetIntField(L, "NOTEOL", REG_NOTEOL << 8);  // search flag
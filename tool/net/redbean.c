@@ -97,11 +97,15 @@
 #include "libc/sysv/consts/s.h"
 #include "libc/sysv/consts/sa.h"
 #include "libc/sysv/consts/sig.h"
+#include "libc/sysv/consts/so.h"
 #include "libc/sysv/consts/sock.h"
+#include "libc/sysv/consts/sol.h"
+#include "libc/sysv/consts/tcp.h"
 #include "libc/sysv/consts/termios.h"
 #include "libc/sysv/consts/timer.h"
 #include "libc/sysv/consts/w.h"
 #include "libc/sysv/errfuns.h"
+#include "libc/thread/percpu.h"
 #include "libc/thread/thread.h"
 #include "libc/thread/tls.h"
 #include "libc/x/x.h"
@@ -131,6 +135,7 @@
 #include "third_party/mbedtls/x509_crt.h"
 #include "third_party/musl/netdb.h"
 #include "third_party/zlib/zlib.h"
+#include "third_party/zstd/zstd.h"
 #include "tool/build/lib/case.h"
 #include "tool/net/lfinger.h"
 #include "tool/net/lfuncs.h"
@@ -173,6 +178,11 @@ __static_yoink("blink_xnu_aarch64");    // is apple silicon
 //                         XXYYZZ
 #define VERSION          0x030000
 #define HASH_LOAD_FACTOR /* 1. / */ 4
+#define FILE_CACHE_MAX   64
+#define FILE_CACHE_HINTS 16     // -D paths forked workers report to main
+#define PAGE_CACHE_FILL  10000  // ms before another worker may regenerate
+#define SSL_CACHE_SLOTS  4096   // sessions remembered by id, two power
+#define SENDFILE_MIN     16384  // smaller bodies are cheaper to writev()
 #define READ(F, P, N)    readv(F, &(struct iovec){P, N}, 1)
 #define WRITE(F, P, N)   writev(F, &(struct iovec){P, N}, 1)
 #define AppendCrlf(P)    mempcpy(P, "\r\n", 2)
@@ -187,6 +197,8 @@ __static_yoink("blink_xnu_aarch64");    // is apple silicon
 #define LockDec(P)                                            \
   atomic_fetch_add_explicit((_Atomic(typeof(*(P))) *)(P), -1, \
                             memory_order_relaxed)
+#define CountInc(C) PERCPU_ADD(shared->c, C, 1)
+#define CountGet(C) PERCPU_SUM(shared->c, C)
 
 #define TRACE_BEGIN         \
   do {                      \
@@ -212,11 +224,11 @@ __static_yoink("blink_xnu_aarch64");    // is apple silicon
     }                       \
   } while (0)
 
-// letters not used: INOQYnoqwxy
+// letters not used: IOQnoqxy
 // digits not used:  0123456789
 // puncts not used:  !"#$&'()+,-./;<=>@[\]^_`{|}~
 #define GETOPTS \
-  "*%BEJSVXZabdfghijkmsuvzA:C:D:F:G:H:K:L:M:P:R:T:U:W:c:e:l:p:r:t:w:"
+  "*%BEJSVXZabdfghijkmsuvzA:C:D:F:G:H:K:L:M:N:P:R:T:U:W:Y:c:e:l:p:r:t:w:"
 
 static const uint8_t kGzipHeader[] = {
     0x1F,        // MAGNUM
@@ -250,6 +262,7 @@ struct Buffer {
 
 struct TlsBio {
   int fd, c;
+  bool ktls;  // kernel encrypts what we send, so mbedtls mustn't
   unsigned a, b;
   unsigned char t[4000];
   unsigned char u[1430];
@@ -287,16 +300,17 @@ static struct Servers {
   size_t n;
   struct Server {
     int fd;
+    int *listeners;  // SO_REUSEPORT socket for each prefork worker
     struct sockaddr_in addr;
   } *p;
 } servers;
 
-static struct Freelist {
+static _Thread_local struct Freelist {
   size_t n, c;
   void **p;
 } freelist;
 
-static struct Unmaplist {
+static _Thread_local struct Unmaplist {
   size_t n, c;
   struct Unmap {
     int f;
@@ -305,6 +319,20 @@ static struct Unmaplist {
   } *p;
 } unmaplist;
 
+// idle connections a thread worker polls along with the listeners
+static _Thread_local struct Parked {
+  size_t n, c;
+  struct Connection {
+    int fd;
+    int messages;
+    uint32_t addrsize;
+    struct sockaddr_in addr;
+    struct sockaddr_in *server;
+    struct timespec start;
+    struct timespec idle;
+  } *p;
+} parked;
+
 static struct Psks {
   size_t n;
   struct Psk {
@@ -347,10 +375,84 @@ static struct Assets {
     struct File {
       struct String path;
       struct stat st;
+      const char *ct;  // content type if cached
+      bool cached;     // owned by filecache
+      int fd;          // descriptor of map if non-null
+      void *map;       // content if cached and mapped
     } *file;
   } *p;
 } assets;
 
+// each thread worker keeps its own, since entries are evicted while
+// other messages might be using them
+static _Thread_local struct FileCache {
+  size_t n;
+  uint64_t tick;
+  struct FileCacheEntry {
+    uint32_t hash;
+    uint32_t dir;
+    uint64_t used;
+    struct timespec checked;  // shared->nowish when file was last stat'd
+    struct String key;
+    struct Asset asset;
+    struct File file;
+    char lastmodifiedstr[30];
+  } *p[FILE_CACHE_MAX];
+} filecache;
+
+// deflated -D files and stored zip assets, shared by every worker so a
+// static asset is only compressed once rather than on every request
+static struct GzipCache {
+  size_t n;     // slots in table, which is a two power
+  size_t size;  // bytes in arena
+  char *arena;
+  struct GzipCacheShared {
+    pthread_spinlock_t lock;
+    atomic_long epoch;  // bumped when arena is recycled
+    size_t used;        // bytes of arena handed out
+    size_t count;       // slots in use
+    struct GzipCacheEntry {
+      uint64_t key;
+      size_t off;
+      uint32_t size;  // of deflated content
+      uint32_t crc;   // of identity content
+    } p[];
+  } *s;
+} gzipcache;
+
+// responses of lua pages that called SetCacheTTL(), shared by every
+// worker so pages which change once a second aren't rendered on every
+// hit; records are a struct PageRecord followed by the reason, headers,
+// identity content and deflated content, or names of headers varied by
+static struct PageCache {
+  size_t n;     // slots in table, which is a two power
+  size_t size;  // bytes in arena
+  char *arena;
+  struct PageCacheShared {
+    pthread_spinlock_t lock;
+    atomic_long epoch;  // bumped when arena is recycled
+    size_t used;        // bytes of arena handed out
+    size_t count;       // slots in use
+    struct PageCacheEntry {
+      uint64_t key;
+      size_t off;
+      size_t size;      // of record
+      int64_t expires;  // unix time in milliseconds
+      int64_t filling;  // deadline of worker regenerating expired record
+    } p[];
+  } *s;
+} pagecache;
+
+struct PageRecord {
+  uint16_t statuscode;  // zero if record only names headers varied by
+  bool branded;
+  uint32_t crc;  // of identity content
+  uint32_t reasonlen;
+  uint32_t headerslen;
+  uint32_t identitylen;
+  uint32_t gziplen;
+};
+
 static struct TrustedIps {
   size_t n;
   struct TrustedIp {
@@ -388,8 +490,25 @@ static struct Shared {
 #define C(x) long x;
 #include "tool/net/counters.inc"
 #undef C
-  } c;
+  } __attribute__((__aligned__(64))) c[PERCPU_SLOTS];
   pthread_spinlock_t montermlock;
+  // tls sessions by id, so clients may resume with any worker process
+  struct SslCacheEntry {
+    atomic_uint seq;  // odd while entry is being written
+    uint16_t size;    // of serialized session
+    uint8_t idlen;
+    int64_t expires;  // unix seconds
+    unsigned char id[32];
+    unsigned char data[200];  // from mbedtls_ssl_session_save()
+  } sslcache[SSL_CACHE_SLOTS];
+  // -D assets that forked workers served, so main process caches them
+  // for the workers it forks later
+  atomic_uint filehintpos;
+  struct FileCacheHint {
+    atomic_uint seq;  // odd while hint is being written
+    uint8_t len;
+    char path[251];
+  } filehints[FILE_CACHE_HINTS];
 } *shared;
 
 static const char kCounterNames[] =
@@ -401,22 +520,31 @@ static const char kCounterNames[] =
 typedef ssize_t (*reader_f)(int, void *, size_t);
 typedef ssize_t (*writer_f)(int, struct iovec *, int);
 
-struct ClearedPerMessage {
+_Thread_local struct ClearedPerMessage {
   bool istext;
   bool branded;
   bool hascontenttype;
   bool gotcachecontrol;
   bool gotxcontenttypeoptions;
+  bool gotsetcookie;
   int frags;
   int statuscode;
   int isyielding;
   char *outbuf;
   char *content;
   size_t gzipped;
+  size_t zstdsize;         // original size of zstd content sent as-is
   size_t contentlength;
   char *luaheaderp;
   const char *referrerpolicy;
+  int64_t cachettl;        // milliseconds lua asked to cache response
+  const char *cachevary;   // header names, each ending with newline
+  uint64_t cacheclaim;     // page cache key we're regenerating
   size_t msgsize;
+  int sendfd;              // file backing sendbase for sendfile()
+  int64_t sendoff;         // file offset of sendbase
+  size_t sendsize;         // bytes at sendbase that are backed by file
+  const char *sendbase;    // content may be transmitted via sendfile()
   ssize_t (*generator)(struct iovec[3]);
   struct Strings loops;
   struct HttpMessage msg;
@@ -425,7 +553,6 @@ struct ClearedPerMessage {
 static bool suiteb;
 static bool killed;
 static bool zombied;
-static bool usingssl;
 static bool funtrace;
 static bool systrace;
 static bool meltdown;
@@ -448,7 +575,6 @@ static bool sslfetchverify;
 static bool selfmodifiable;
 static bool interpretermode;
 static bool sslclientverify;
-static bool connectionclose;
 static bool hasonloglatency;
 static bool hasonworkerstop;
 static bool isexitingworker;
@@ -456,18 +582,18 @@ static bool hasonworkerstart;
 static bool leakcrashreports;
 static bool hasonhttprequest;
 static bool hasonerror;
-static bool ishandlingrequest;
 static bool listeningonport443;
 static bool hasonprocesscreate;
 static bool hasonprocessdestroy;
-static bool ishandlingconnection;
 static bool hasonclientconnection;
 static bool evadedragnetsurveillance;
 
 static int zfd;
 static int gmtoff;
-static int client;
 static int mainpid;
+static int threads;
+static int preforks;
+static int *preforkpids;
 static int sandboxed;
 static int changeuid;
 static int changegid;
@@ -475,69 +601,98 @@ static int maxworkers;
 static int shutdownsig;
 static int sslpskindex;
 static int oldloglevel;
-static int messageshandled;
 static int sslticketlifetime;
-static uint32_t clientaddrsize;
 
 static char *brand;
 static size_t zsize;
-static lua_State *GL;
-static lua_State *YL;
 static uint8_t *zmap;
 static uint8_t *zcdir;
-static size_t hdrsize;
-static size_t amtread;
-static reader_f reader;
-static writer_f writer;
 static char *extrahdrs;
 static const char *zpath;
 static char *serverheader;
-static char gzip_footer[8];
+static long preforkmemory;
+static long gzipcachesize;
+static long pagecachesize;
 static long maxpayloadsize;
 static const char *pidpath;
 static const char *logpath;
 static uint32_t *interfaces;
-static struct pollfd *polls;
-static size_t payloadlength;
 static int64_t cacheseconds;
 static char *cachedirective;
+static long servedconnections;
+static long preforkconnections;
 static struct Strings stagedirs;
 static struct Strings hidepaths;
 static const char *launchbrowser;
 static const char ctIdx = 'c';  // a pseudo variable to get address of
 
-static struct Buffer inbuf_actual;
-static struct Buffer inbuf;
-static struct Buffer oldin;
-static struct Buffer hdrbuf;
 static struct timeval timeout;
-static struct Buffer effectivepath;
 static struct timespec heartbeatinterval;
 
-static struct Url url;
-
 static struct stat zst;
-static struct timespec startread;
 static struct timespec lastrefresh;
 static struct timespec startserver;
-static struct timespec startrequest;
 static struct timespec lastheartbeat;
-static struct timespec startconnection;
-static struct sockaddr_in clientaddr;
-static struct sockaddr_in *serveraddr;
+static struct timespec lastpreforkfail;
+
+static pthread_t *threadworkers;
+static atomic_int luageneration;
+static pthread_rwlock_t reloadlock = PTHREAD_RWLOCK_INITIALIZER;
+
+// thread workers send responses after releasing the reload lock, so
+// they take a reference to the zip mapping which the content is from
+static struct ZipMapping {
+  atomic_int refs;
+  uint8_t *map;
+  size_t size;
+} *zipmapping;
 
 static mbedtls_ssl_config conf;
 static mbedtls_ssl_context ssl;
 static mbedtls_ctr_drbg_context rng;
 static mbedtls_ssl_ticket_context ssltick;
+static struct KernelTls ktls;
 
 static mbedtls_ssl_config confcli;
 static mbedtls_ssl_context sslcli;
 static mbedtls_ctr_drbg_context rngcli;
 
-static struct TlsBio g_bio;
-static char slashpath[PATH_MAX];
-static struct DeflateGenerator dg;
+// the connection being served, which is private to each thread worker
+// so that many of them can be multiplexed by one process
+static _Thread_local int client;
+static _Thread_local bool usingssl;
+static _Thread_local lua_State *GL;
+static _Thread_local lua_State *YL;
+static _Thread_local size_t amtread;
+static _Thread_local size_t hdrsize;
+static _Thread_local struct Url url;
+static _Thread_local reader_f reader;
+static _Thread_local writer_f writer;
+static _Thread_local bool isthreadworker;
+static _Thread_local bool holdingreloadlock;
+static int lockedthreadworkers;  // main thread's nested reloadlock writes
+static _Thread_local struct ZipMapping *pinnedzip;
+static _Thread_local char gzip_footer[8];
+static _Thread_local int messageshandled;
+static _Thread_local struct Buffer inbuf;
+static _Thread_local struct Buffer oldin;
+static _Thread_local struct TlsBio g_bio;
+static _Thread_local bool connectionclose;
+static _Thread_local size_t payloadlength;
+static _Thread_local struct Buffer hdrbuf;
+static _Thread_local struct pollfd *polls;
+static _Thread_local bool ishandlingrequest;
+static _Thread_local uint32_t clientaddrsize;
+static _Thread_local char slashpath[PATH_MAX];
+static _Thread_local bool ishandlingconnection;
+static _Thread_local struct timespec startread;
+static _Thread_local struct Buffer inbuf_actual;
+static _Thread_local struct DeflateGenerator dg;
+static _Thread_local struct Buffer effectivepath;
+static _Thread_local struct timespec startrequest;
+static _Thread_local struct sockaddr_in clientaddr;
+static _Thread_local struct sockaddr_in *serveraddr;
+static _Thread_local struct timespec startconnection;
 
 static char *Route(const char *, size_t, const char *, size_t);
 static char *RouteHost(const char *, size_t, const char *, size_t);
@@ -545,6 +700,7 @@ static char *RoutePath(const char *, size_t);
 static char *HandleAsset(struct Asset *, const char *, size_t);
 static char *ServeAsset(struct Asset *, const char *, size_t);
 static char *SetStatus(unsigned, const char *);
+static const char *GetContentTypeExt(const char *, size_t);
 
 static void TlsInit(void);
 
@@ -611,6 +767,13 @@ static void UnmapLater(int f, void *p, size_t n) {
   unmaplist.p[unmaplist.n - 1].n = n;
 }
 
+static void SendfileLater(int fd, int64_t off, const void *p, size_t n) {
+  cpm.sendfd = fd;
+  cpm.sendoff = off;
+  cpm.sendbase = p;
+  cpm.sendsize = n;
+}
+
 static void CollectGarbage(void) {
   __log_level = oldloglevel;
   DestroyHttpMessage(&cpm.msg);
@@ -828,6 +991,14 @@ static void ProgramMaxPayloadSize(long x) {
   maxpayloadsize = MAX(1450, x);
 }
 
+static void ProgramGzipCache(long x) {
+  gzipcachesize = MAX(0, x);
+}
+
+static void ProgramPageCache(long x) {
+  pagecachesize = MAX(0, x);
+}
+
 static void ProgramSslTicketLifetime(long x) {
   sslticketlifetime = x;
 }
@@ -988,7 +1159,7 @@ static char *DescribeClient(void) {
   char str[40];
   uint16_t port;
   uint32_t client;
-  static char description[128];
+  static _Thread_local char description[128];
   GetClientAddr(&client, &port);
   if (HasHeader(kHttpXForwardedFor) && IsTrustedIp(client)) {
     DescribeAddress(str, client, port);
@@ -1004,7 +1175,7 @@ static char *DescribeClient(void) {
 static char *DescribeServer(void) {
   uint32_t ip;
   uint16_t port;
-  static char serveraddrstr[40];
+  static _Thread_local char serveraddrstr[40];
   GetServerAddr(&ip, &port);
   DescribeAddress(serveraddrstr, ip, port);
   return serveraddrstr;
@@ -1046,6 +1217,14 @@ static void ProgramTimeout(long ms) {
   }
 }
 
+static void ProgramPrefork(long workers) {
+  preforks = workers > 0 ? workers : __get_cpu_count();
+}
+
+static void ProgramThreads(long workers) {
+  threads = workers > 0 ? workers : __get_cpu_count();
+}
+
 static void ProgramCache(long x, const char *s) {
   cacheseconds = x;
   if (s)
@@ -1057,6 +1236,10 @@ static void SetDefaults(void) {
                             VERSION >> 010, VERSION >> 000)));
   __log_level = kLogInfo;
   maxpayloadsize = 64 * 1024;
+  preforkmemory = 64 * 1024 * 1024;
+  preforkconnections = 10000;
+  gzipcachesize = 16 * 1024 * 1024;
+  pagecachesize = 8 * 1024 * 1024;
   ProgramCache(-1, "must-revalidate");
   ProgramTimeout(60 * 1000);
   ProgramSslTicketLifetime(24 * 60 * 60);
@@ -1354,14 +1537,14 @@ static void ReportWorkerExit(int pid, int ws) {
   workers = atomic_fetch_sub(&shared->workers, 1) - 1;
   if (WIFEXITED(ws)) {
     if (WEXITSTATUS(ws)) {
-      LockInc(&shared->c.failedchildren);
+      CountInc(failedchildren);
       WARNF("(stat) %d exited with %d (%,d workers remain)", pid,
             WEXITSTATUS(ws), workers);
     } else {
       DEBUGF("(stat) %d exited (%,d workers remain)", pid, workers);
     }
   } else {
-    LockInc(&shared->c.terminatedchildren);
+    CountInc(terminatedchildren);
     WARNF("(stat) %d terminated with %s (%,d workers remain)", pid,
           strsignal(WTERMSIG(ws)), workers);
   }
@@ -1382,8 +1565,18 @@ static void ReportWorkerResources(int pid, struct rusage *ru) {
 }
 
 static void HandleWorkerExit(int pid, int ws, struct rusage *ru) {
-  LockInc(&shared->c.connectionshandled);
+  CountInc(connectionshandled);
   rusage_add(&shared->children, ru);
+  if (preforks && !(WIFEXITED(ws) && !WEXITSTATUS(ws))) {
+    lastpreforkfail = timespec_real();  // don't respawn crashes in a loop
+  }
+  if (preforkpids) {
+    for (int i = 0; i < preforks; ++i) {
+      if (preforkpids[i] == pid) {
+        preforkpids[i] = 0;  // the next worker takes over its listeners
+      }
+    }
+  }
   ReportWorkerExit(pid, ws);
   ReportWorkerResources(pid, ru);
   if (hasonprocessdestroy) {
@@ -1498,7 +1691,7 @@ static ssize_t WritevAll(int fd, struct iovec *iov, int iovlen) {
       } while (wrote);
     } else if (errno == EINTR) {
       errno = 0;
-      LockInc(&shared->c.writeinterruputs);
+      CountInc(writeinterruputs);
       if (killed || IsTakingTooLong()) {
         return total ? total : -1;
       }
@@ -1538,6 +1731,10 @@ static int TlsFlush(struct TlsBio *bio, const unsigned char *buf, size_t len) {
 static int TlsSend(void *ctx, const unsigned char *buf, size_t len) {
   int rc;
   struct TlsBio *bio = ctx;
+  // records mbedtls sends after offload (e.g. alerts from SslRead) use
+  // its stale sequence number, so they'd corrupt the connection stream
+  if (bio->ktls)
+    return len;
   if (bio->c >= 0 && bio->c + len <= sizeof(bio->u)) {
     memcpy(bio->u + bio->c, buf, len);
     bio->c += len;
@@ -1669,7 +1866,11 @@ static void NotifyClose(void) {
 #ifndef UNSECURE
   if (usingssl) {
     DEBUGF("(ssl) SSL notifying close");
-    mbedtls_ssl_close_notify(&ssl);
+    if (writer == SslWrite) {
+      mbedtls_ssl_close_notify(&ssl);
+    } else {
+      CloseKernelTls(client);
+    }
   }
 #endif
 }
@@ -1809,6 +2010,81 @@ static int TlsRoutePsk(void *ctx, mbedtls_ssl_context *ssl,
   return -1;
 }
 
+static struct SslCacheEntry *GetSslCacheSlot(const unsigned char *id,
+                                             size_t idlen) {
+  unsigned h = 0;
+  memcpy(&h, id, MIN(idlen, sizeof(h)));  // session ids are random
+  return shared->sslcache + (h & (SSL_CACHE_SLOTS - 1));
+}
+
+// restores session being resumed by id, which may have been negotiated
+// by another worker process; entries are copied out optimistically and
+// discarded if a writer changed them in the meantime
+static int TlsGetSession(void *ctx, mbedtls_ssl_session *session) {
+  int rc;
+  unsigned seq;
+  mbedtls_ssl_session tmp;
+  struct SslCacheEntry *e, t;
+  e = GetSslCacheSlot(session->id, session->id_len);
+  if ((seq = atomic_load_explicit(&e->seq, memory_order_acquire)) & 1)
+    return 1;
+  memcpy(&t, e, sizeof(t));
+  atomic_thread_fence(memory_order_acquire);
+  if (atomic_load_explicit(&e->seq, memory_order_relaxed) != seq)
+    return 1;
+  rc = 1;
+  if (t.idlen == session->id_len && t.size <= sizeof(t.data) &&
+      t.expires > shared->nowish.tv_sec &&
+      !timingsafe_bcmp(t.id, session->id, t.idlen)) {
+    mbedtls_ssl_session_init(&tmp);
+    if (!mbedtls_ssl_session_load(&tmp, t.data, t.size) &&
+        tmp.ciphersuite == session->ciphersuite &&
+        tmp.compression == session->compression &&
+        tmp.id_len == session->id_len &&
+        !timingsafe_bcmp(tmp.id, session->id, tmp.id_len)) {
+      mbedtls_ssl_session_free(session);
+      memcpy(session, &tmp, sizeof(tmp));
+      DEBUGF("(ssl) resuming session from cache");
+      rc = 0;
+    } else {
+      mbedtls_ssl_session_free(&tmp);
+    }
+  }
+  mbedtls_platform_zeroize(&t, sizeof(t));
+  return rc;
+}
+
+static int TlsSetSession(void *ctx, const mbedtls_ssl_session *session) {
+  size_t n;
+  unsigned seq;
+  struct SslCacheEntry *e, t;
+  if (sslticketlifetime <= 0 || !session->id_len ||
+      session->id_len > sizeof(t.id)) {
+    return 1;
+  }
+  if (mbedtls_ssl_session_save(session, t.data, sizeof(t.data), &n)) {
+    mbedtls_platform_zeroize(t.data, sizeof(t.data));  // may be partial
+    return 1;  // e.g. peer certificate too large
+  }
+  e = GetSslCacheSlot(session->id, session->id_len);
+  seq = atomic_load_explicit(&e->seq, memory_order_relaxed);
+  if ((seq & 1) || !atomic_compare_exchange_strong_explicit(
+                       &e->seq, &seq, seq + 1, memory_order_acquire,
+                       memory_order_relaxed)) {
+    mbedtls_platform_zeroize(t.data, sizeof(t.data));
+    return 1;  // another worker is writing this slot
+  }
+  atomic_thread_fence(memory_order_release);
+  e->size = n;
+  e->idlen = session->id_len;
+  e->expires = shared->nowish.tv_sec + sslticketlifetime;
+  memcpy(e->id, session->id, session->id_len);
+  memcpy(e->data, t.data, n);
+  atomic_store_explicit(&e->seq, seq + 2, memory_order_release);
+  mbedtls_platform_zeroize(t.data, sizeof(t.data));
+  return 0;
+}
+
 static bool TlsSetup(void) {
   int r;
   oldin.p = inbuf.p;
@@ -1821,30 +2097,41 @@ static bool TlsSetup(void) {
   g_bio.a = 0;
   g_bio.b = 0;
   g_bio.c = 0;
+  g_bio.ktls = false;
   sslpskindex = 0;
   for (;;) {
     if (!(r = mbedtls_ssl_handshake(&ssl)) && TlsFlush(&g_bio, 0, 0) != -1) {
-      LockInc(&shared->c.sslhandshakes);
+      CountInc(sslhandshakes);
       g_bio.c = -1;
       usingssl = true;
       reader = SslRead;
-      writer = SslWrite;
+      if (!ssl.session->compression && EnableKernelTls(client, &ssl, &ktls)) {
+        // kernel encrypts what we write, so responses can use sendfile()
+        CountInc(kerneltls);
+        g_bio.ktls = true;
+        writer = WritevAll;
+      } else {
+        writer = SslWrite;
+      }
+      mbedtls_platform_zeroize(&ktls, sizeof(ktls));
       WipeServingKeys();
-      VERBOSEF("(ssl) shaken %s %s %s%s %s", DescribeClient(),
+      VERBOSEF("(ssl) shaken %s %s %s%s %s%s", DescribeClient(),
                mbedtls_ssl_get_ciphersuite(&ssl), mbedtls_ssl_get_version(&ssl),
                ssl.session->compression ? " COMPRESSED" : "",
-               ssl.curve ? ssl.curve->name : "uncurved");
+               ssl.curve ? ssl.curve->name : "uncurved",
+               writer == WritevAll ? " KTLS" : "");
       DEBUGF("(ssl) client ciphersuite preference was %s",
              gc(FormatSslClientCiphers(&ssl)));
       return true;
     } else if (r == MBEDTLS_ERR_SSL_WANT_READ) {
-      LockInc(&shared->c.handshakeinterrupts);
+      CountInc(handshakeinterrupts);
       if (terminated || killed || IsTakingTooLong()) {
         return false;
       }
     } else {
-      LockInc(&shared->c.sslhandshakefails);
+      CountInc(sslhandshakefails);
       mbedtls_ssl_session_reset(&ssl);
+      mbedtls_platform_zeroize(&ktls, sizeof(ktls));
       switch (r) {
         case MBEDTLS_ERR_SSL_CONN_EOF:
           DEBUGF("(ssl) %s SSL handshake EOF", DescribeClient());
@@ -1853,35 +2140,35 @@ static bool TlsSetup(void) {
           DEBUGF("(ssl) %s SSL handshake reset", DescribeClient());
           return false;
         case MBEDTLS_ERR_SSL_TIMEOUT:
-          LockInc(&shared->c.ssltimeouts);
+          CountInc(ssltimeouts);
           DEBUGF("(ssl) %s %s", DescribeClient(), "ssltimeouts");
           return false;
         case MBEDTLS_ERR_SSL_NO_CIPHER_CHOSEN:
-          LockInc(&shared->c.sslnociphers);
+          CountInc(sslnociphers);
           WARNF("(ssl) %s %s %s", DescribeClient(), "sslnociphers",
                 gc(FormatSslClientCiphers(&ssl)));
           return false;
         case MBEDTLS_ERR_SSL_NO_USABLE_CIPHERSUITE:
-          LockInc(&shared->c.sslcantciphers);
+          CountInc(sslcantciphers);
           WARNF("(ssl) %s %s %s", DescribeClient(), "sslcantciphers",
                 gc(FormatSslClientCiphers(&ssl)));
           return false;
         case MBEDTLS_ERR_SSL_BAD_HS_PROTOCOL_VERSION:
-          LockInc(&shared->c.sslnoversion);
+          CountInc(sslnoversion);
           WARNF("(ssl) %s %s %s", DescribeClient(), "sslnoversion",
                 mbedtls_ssl_get_version(&ssl));
           return false;
         case MBEDTLS_ERR_SSL_INVALID_MAC:
-          LockInc(&shared->c.sslshakemacs);
+          CountInc(sslshakemacs);
           WARNF("(ssl) %s %s", DescribeClient(), "sslshakemacs");
           return false;
         case MBEDTLS_ERR_SSL_NO_CLIENT_CERTIFICATE:
-          LockInc(&shared->c.sslnoclientcert);
+          CountInc(sslnoclientcert);
           WARNF("(ssl) %s %s", DescribeClient(), "sslnoclientcert");
           NotifyClose();
           return false;
         case MBEDTLS_ERR_X509_CERT_VERIFY_FAILED:
-          LockInc(&shared->c.sslverifyfailed);
+          CountInc(sslverifyfailed);
           WARNF("(ssl) %s SSL %s", DescribeClient(),
                 gc(DescribeSslVerifyFailure(
                     ssl.session_negotiate->verify_result)));
@@ -1889,11 +2176,11 @@ static bool TlsSetup(void) {
         case MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE:
           switch (ssl.fatal_alert) {
             case MBEDTLS_SSL_ALERT_MSG_CERT_UNKNOWN:
-              LockInc(&shared->c.sslunknowncert);
+              CountInc(sslunknowncert);
               DEBUGF("(ssl) %s %s", DescribeClient(), "sslunknowncert");
               return false;
             case MBEDTLS_SSL_ALERT_MSG_UNKNOWN_CA:
-              LockInc(&shared->c.sslunknownca);
+              CountInc(sslunknownca);
               DEBUGF("(ssl) %s %s", DescribeClient(), "sslunknownca");
               return false;
             default:
@@ -2118,6 +2405,11 @@ static bool ClientAcceptsGzip(void) {
          HeaderHas(&cpm.msg, inbuf.p, kHttpAcceptEncoding, "gzip", 4);
 }
 
+static bool ClientAcceptsZstd(void) {
+  return cpm.msg.version >= 10 && /* RFC8878 § 7.2 */
+         HeaderHas(&cpm.msg, inbuf.p, kHttpAcceptEncoding, "zstd", 4);
+}
+
 char *FormatUnixHttpDateTime(char *s, int64_t t) {
   struct tm tm;
   gmtime_r(&t, &tm);
@@ -2142,7 +2434,12 @@ static int64_t GetGmtOffset(int64_t t) {
 
 forceinline bool IsCompressed(struct Asset *a) {
   return !a->file &&
-         ZIP_LFILE_COMPRESSIONMETHOD(zmap + a->lf) == kZipCompressionDeflate;
+         ZIP_LFILE_COMPRESSIONMETHOD(zmap + a->lf) != kZipCompressionNone;
+}
+
+forceinline bool IsZstd(struct Asset *a) {
+  return !a->file &&
+         ZIP_LFILE_COMPRESSIONMETHOD(zmap + a->lf) == kZipCompressionZstd;
 }
 
 forceinline int GetMode(struct Asset *a) {
@@ -2150,7 +2447,9 @@ forceinline int GetMode(struct Asset *a) {
 }
 
 forceinline bool IsCompressionMethodSupported(int method) {
-  return method == kZipCompressionNone || method == kZipCompressionDeflate;
+  return method == kZipCompressionNone ||     //
+         method == kZipCompressionDeflate ||  //
+         method == kZipCompressionZstd;
 }
 
 static inline unsigned Hash(const void *p, unsigned long n) {
@@ -2223,6 +2522,13 @@ static void IndexAssets(void) {
   assets.n = m;
 }
 
+static void DropZipMapping(struct ZipMapping *z) {
+  if (atomic_fetch_sub(&z->refs, 1) == 1) {
+    LOGIFNEG1(munmap(z->map, z->size));
+    free(z);
+  }
+}
+
 static bool OpenZip(bool force) {
   int fd;
   size_t n;
@@ -2240,9 +2546,13 @@ static bool OpenZip(bool force) {
           MAP_FAILED) {
         n = st.st_size;
         if ((d = GetZipEocd(m, n, 0))) {
-          if (zmap) {
-            LOGIFNEG1(munmap(zmap, zsize));
+          if (zipmapping) {
+            DropZipMapping(zipmapping);
           }
+          zipmapping = xmalloc(sizeof(*zipmapping));
+          zipmapping->refs = 1;
+          zipmapping->map = m;
+          zipmapping->size = n;
           zmap = m;
           zsize = n;
           zcdir = d;
@@ -2286,29 +2596,229 @@ static struct Asset *GetAssetZip(const char *path, size_t pathlen) {
   }
 }
 
+static void FreeAssetFile(struct FileCacheEntry *f, bool later) {
+  if (later) {
+    if (f->file.map)
+      UnmapLater(f->file.fd, f->file.map, f->file.st.st_size);
+    FreeLater((void *)f->file.path.s);
+    FreeLater((void *)f->key.s);
+    FreeLater(f);
+  } else {
+    if (f->file.map) {
+      LOGIFNEG1(munmap(f->file.map, f->file.st.st_size));
+      LOGIFNEG1(close(f->file.fd));
+    }
+    free((void *)f->file.path.s);
+    free((void *)f->key.s);
+    free(f);
+  }
+}
+
+static void EvictAssetFile(size_t i, bool later) {
+  FreeAssetFile(filecache.p[i], later);
+  filecache.p[i] = filecache.p[--filecache.n];
+}
+
+static void FreeAssetFiles(void) {
+  while (filecache.n)
+    EvictAssetFile(filecache.n - 1, false);
+}
+
+// checks cached -D asset didn't change or become shadowed on disk. as
+// with the zip, a mapped file that gets truncated in place before this
+// notices may raise SIGBUS, so files should be renamed into place
+static bool IsAssetFileFresh(struct FileCacheEntry *e) {
+  char *s;
+  size_t j, n;
+  struct stat st;
+  CountInc(stats);
+  if (stat(e->file.path.s, &st) == -1 || st.st_ino != e->file.st.st_ino ||
+      st.st_dev != e->file.st.st_dev || st.st_size != e->file.st.st_size ||
+      timespec_cmp(st.st_mtim, e->file.st.st_mtim)) {
+    return false;
+  }
+  for (j = 0; j < e->dir; ++j) {
+    s = MergePaths(stagedirs.p[j].s, stagedirs.p[j].n, e->key.s, e->key.n,
+                   &n);
+    n = stat(s, &st) != -1;
+    free(s);
+    if (n)
+      return false;
+  }
+  e->checked = shared->nowish;
+  return true;
+}
+
+// drops cached -D assets that changed, which is done on the heartbeat
+// so that cache hits don't need any system calls
+static void RevalidateAssetFiles(void) {
+  size_t i;
+  for (i = 0; i < filecache.n;) {
+    if (!IsAssetFileFresh(filecache.p[i])) {
+      EvictAssetFile(i, false);
+    } else {
+      ++i;
+    }
+  }
+}
+
+static struct Asset *GetCachedAssetFile(uint32_t hash, const char *path,
+                                        size_t pathlen) {
+  size_t i;
+  struct FileCacheEntry *e;
+  for (i = 0; i < filecache.n; ++i) {
+    e = filecache.p[i];
+    if (e->hash == hash && e->key.n == pathlen &&
+        !memcmp(e->key.s, path, pathlen)) {
+      // fork() per connection workers don't have heartbeats, so the
+      // entries they inherit are checked once per heartbeat of main
+      if (timespec_cmp(e->checked, shared->nowish) && !IsAssetFileFresh(e)) {
+        EvictAssetFile(i, true);
+        return 0;
+      }
+      e->used = ++filecache.tick;
+      return &e->asset;
+    }
+  }
+  return 0;
+}
+
+static struct Asset *CacheAssetFile(uint32_t hash, const char *path,
+                                    size_t pathlen, size_t dir,
+                                    struct Asset *a) {
+  size_t i, j;
+  struct FileCacheEntry *e;
+  if (filecache.n == FILE_CACHE_MAX) {
+    for (j = 0, i = 1; i < filecache.n; ++i) {
+      if (filecache.p[i]->used < filecache.p[j]->used) {
+        j = i;
+      }
+    }
+    // current message might still be using it
+    EvictAssetFile(j, true);
+  }
+  e = xcalloc(1, sizeof(struct FileCacheEntry));
+  e->hash = hash;
+  e->dir = dir;
+  e->used = ++filecache.tick;
+  e->checked = shared->nowish;
+  e->key.s = xstrndup(path, pathlen);
+  e->key.n = pathlen;
+  e->file.st = a->file->st;
+  e->file.path.s = xstrndup(a->file->path.s, a->file->path.n);
+  e->file.path.n = a->file->path.n;
+  e->file.ct = GetContentTypeExt(e->file.path.s, e->file.path.n);
+  e->file.cached = true;
+  e->asset.file = &e->file;
+  e->asset.lastmodified = a->lastmodified;
+  e->asset.lastmodifiedstr = strcpy(e->lastmodifiedstr, a->lastmodifiedstr);
+  filecache.p[filecache.n++] = e;
+  return &e->asset;
+}
+
+// asks main process to cache a -D asset this forked worker served, so
+// that workers forked afterwards inherit the entry and its mapping
+static void HintAssetFile(const char *path, size_t pathlen) {
+  unsigned seq;
+  struct FileCacheHint *h;
+  if (pathlen > sizeof(h->path))
+    return;
+  h = shared->filehints +
+      atomic_fetch_add_explicit(&shared->filehintpos, 1,
+                                memory_order_relaxed) %
+          FILE_CACHE_HINTS;
+  seq = atomic_load_explicit(&h->seq, memory_order_relaxed);
+  if ((seq & 1) || !atomic_compare_exchange_strong_explicit(
+                       &h->seq, &seq, seq + 1, memory_order_acquire,
+                       memory_order_relaxed)) {
+    return;  // another worker is writing this slot
+  }
+  atomic_thread_fence(memory_order_release);
+  h->len = pathlen;
+  memcpy(h->path, path, pathlen);
+  atomic_store_explicit(&h->seq, seq + 2, memory_order_release);
+}
+
 static struct Asset *GetAssetFile(const char *path, size_t pathlen) {
   size_t i;
+  uint32_t hash;
   struct Asset *a;
   if (stagedirs.n) {
+    hash = Hash(path, pathlen);
+    if ((a = GetCachedAssetFile(hash, path, pathlen))) {
+      CountInc(filecachehits);
+      return a;
+    }
     a = FreeLater(xcalloc(1, sizeof(struct Asset)));
-    a->file = FreeLater(xmalloc(sizeof(struct File)));
+    a->file = FreeLater(xcalloc(1, sizeof(struct File)));
     for (i = 0; i < stagedirs.n; ++i) {
-      LockInc(&shared->c.stats);
+      CountInc(stats);
       a->file->path.s = FreeLater(MergePaths(stagedirs.p[i].s, stagedirs.p[i].n,
                                              path, pathlen, &a->file->path.n));
       if (stat(a->file->path.s, &a->file->st) != -1) {
         a->lastmodifiedstr = FormatUnixHttpDateTime(
             FreeLater(xmalloc(30)),
             (a->lastmodified = a->file->st.st_mtim.tv_sec));
+        if (S_ISREG(a->file->st.st_mode)) {
+          a = CacheAssetFile(hash, path, pathlen, i, a);
+          if (__isworker)
+            HintAssetFile(path, pathlen);
+        }
         return a;
       } else {
-        LockInc(&shared->c.statfails);
+        CountInc(statfails);
       }
     }
   }
   return NULL;
 }
 
+// maps cached -D asset in main process so forked workers inherit it
+static void MapAssetFile(struct Asset *a) {
+  int fd;
+  void *map;
+  if (!a || !a->file || !a->file->cached || a->file->map ||
+      !a->file->st.st_size)
+    return;
+  if ((fd = open(a->file->path.s, O_RDONLY | O_CLOEXEC)) == -1)
+    return;
+  if ((map = mmap(0, a->file->st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) !=
+      MAP_FAILED) {
+    CountInc(maps);
+    a->file->fd = fd;
+    a->file->map = map;
+  } else {
+    close(fd);
+  }
+}
+
+// caches the -D assets forked workers reported since last heartbeat
+static void AdoptAssetFileHints(void) {
+  size_t i, n;
+  unsigned seq;
+  char path[256];
+  struct FileCacheHint *h;
+  for (i = 0; i < FILE_CACHE_HINTS; ++i) {
+    h = shared->filehints + i;
+    seq = atomic_load_explicit(&h->seq, memory_order_acquire);
+    if (!(n = h->len) || (seq & 1))
+      continue;
+    if (n > sizeof(h->path))
+      n = sizeof(h->path);
+    memcpy(path, h->path, n);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&h->seq, memory_order_relaxed) != seq)
+      continue;
+    if (!atomic_compare_exchange_strong_explicit(&h->seq, &seq, seq + 1,
+                                                 memory_order_acquire,
+                                                 memory_order_relaxed))
+      continue;
+    h->len = 0;
+    atomic_store_explicit(&h->seq, seq + 2, memory_order_release);
+    MapAssetFile(GetAssetFile(path, n));
+  }
+}
+
 static struct Asset *GetAsset(const char *path, size_t pathlen) {
   struct Asset *a;
   if (!(a = GetAssetFile(path, pathlen))) {
@@ -2329,6 +2839,18 @@ static char *AppendHeader(char *p, const char *k, const char *v) {
   return AppendCrlf(stpcpy(stpcpy(stpcpy(p, k), ": "), v));
 }
 
+// grows header buffer so n more bytes can be appended at p
+static char *ReserveHeaders(char *p, size_t n) {
+  char *q;
+  while (p - hdrbuf.p + n + 512 > hdrbuf.n) {
+    hdrbuf.n += hdrbuf.n >> 1;
+    q = xrealloc(hdrbuf.p, hdrbuf.n);
+    p = q + (p - hdrbuf.p);
+    hdrbuf.p = q;
+  }
+  return p;
+}
+
 static char *AppendContentType(char *p, const char *ct) {
   p = stpcpy(p, "Content-Type: ");
   p = stpcpy(p, ct);
@@ -2388,17 +2910,30 @@ static char *AppendContentRange(char *p, long a, long b, long c) {
 }
 
 static bool Inflate(void *dp, size_t dn, const void *sp, size_t sn) {
-  LockInc(&shared->c.inflates);
+  CountInc(inflates);
   return !__inflate(dp, dn, sp, sn);
 }
 
+static bool Unzstd(void *dp, size_t dn, const void *sp, size_t sn) {
+  size_t rc;
+  CountInc(inflates);
+  rc = ZSTD_decompress(dp, dn, sp, sn);
+  return !ZSTD_isError(rc) && rc == dn;
+}
+
+static bool Decompress(struct Asset *a, void *dp, size_t dn) {
+  const void *sp = ZIP_LFILE_CONTENT(zmap + a->lf);
+  size_t sn = GetZipCfileCompressedSize(zmap + a->cf);
+  return IsZstd(a) ? Unzstd(dp, dn, sp, sn) : Inflate(dp, dn, sp, sn);
+}
+
 static bool Verify(void *data, size_t size, uint32_t crc) {
   uint32_t got;
-  LockInc(&shared->c.verifies);
+  CountInc(verifies);
   if (crc == (got = crc32_z(0, data, size))) {
     return true;
   } else {
-    LockInc(&shared->c.thiscorruption);
+    CountInc(thiscorruption);
     WARNF("(zip) corrupt zip file at %`'.*s had crc 0x%08x but expected 0x%08x",
           cpm.msg.uri.b - cpm.msg.uri.a, inbuf.p + cpm.msg.uri.a, got, crc);
     return false;
@@ -2408,7 +2943,7 @@ static bool Verify(void *data, size_t size, uint32_t crc) {
 static void *Deflate(const void *data, size_t size, size_t *out_size) {
   void *res;
   z_stream zs = {0};
-  LockInc(&shared->c.deflates);
+  CountInc(deflates);
   CHECK_EQ(Z_OK, deflateInit2(&zs, 4, Z_DEFLATED, -MAX_WBITS, DEF_MEM_LEVEL,
                               Z_DEFAULT_STRATEGY));
   zs.next_in = data;
@@ -2421,6 +2956,124 @@ static void *Deflate(const void *data, size_t size, size_t *out_size) {
   return xrealloc(res, zs.total_out);
 }
 
+static void InitGzipCache(void) {
+  char *p;
+  size_t n, m;
+  if (gzipcachesize <= 0)
+    return;
+  // size table for entries averaging 4kb, and keep it half empty
+  gzipcache.n = roundup2pow(MAX(64, gzipcachesize / 4096 * 2));
+  m = ROUNDUP(sizeof(struct GzipCacheShared) +
+                  gzipcache.n * sizeof(struct GzipCacheEntry),
+              64);
+  n = ROUNDUP(m + gzipcachesize, getgransize());
+  CHECK_NE(MAP_FAILED, (p = mmap(0, n, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_ANONYMOUS, -1, 0)));
+  gzipcache.s = (struct GzipCacheShared *)p;
+  gzipcache.arena = p + m;
+  gzipcache.size = n - m;
+}
+
+static uint64_t MixCacheKey(uint64_t h, uint64_t x) {
+  return (h ^ x) * 0x9e3779b97f4a7c15;
+}
+
+// zip assets are keyed by their crc, and files by what stat() says
+static uint64_t GetGzipCacheKey(struct Asset *a) {
+  uint64_t h;
+  struct stat *st;
+  if (!a->file) {
+    h = MixCacheKey(zst.st_ino, a->lf);
+    h = MixCacheKey(h, ZIP_CFILE_CRC32(zmap + a->cf));
+  } else {
+    st = &a->file->st;
+    h = MixCacheKey(Hash(a->file->path.s, a->file->path.n), st->st_ino);
+    h = MixCacheKey(h, st->st_dev);
+    h = MixCacheKey(h, st->st_mtim.tv_sec);
+    h = MixCacheKey(h, st->st_mtim.tv_nsec);
+  }
+  h = MixCacheKey(h, cpm.contentlength);
+  return MAX(1, h ^ h >> 32);
+}
+
+static struct GzipCacheEntry *GetGzipCacheSlot(uint64_t key) {
+  size_t i;
+  struct GzipCacheEntry *e;
+  for (i = key;; ++i) {
+    e = gzipcache.s->p + (i & (gzipcache.n - 1));
+    if (!e->key || e->key == key)
+      return e;
+  }
+}
+
+// copies deflated content out of cache, or returns null if it's not
+// there; the copy is needed because another worker may recycle the
+// arena while we're sending
+static char *GetGzipCache(uint64_t key, size_t *size, uint32_t *crc) {
+  char *p;
+  long epoch;
+  size_t n, off;
+  struct GzipCacheEntry *e;
+  pthread_spin_lock(&gzipcache.s->lock);
+  if ((e = GetGzipCacheSlot(key))->key) {
+    off = e->off;
+    n = e->size;
+    *crc = e->crc;
+    epoch = gzipcache.s->epoch;
+  } else {
+    n = 0;
+  }
+  pthread_spin_unlock(&gzipcache.s->lock);
+  if (!n || !(p = malloc(n)))
+    return 0;
+  memcpy(p, gzipcache.arena + off, n);
+  atomic_thread_fence(memory_order_acquire);
+  if (atomic_load(&gzipcache.s->epoch) != epoch) {
+    free(p);
+    return 0;
+  }
+  *size = n;
+  return p;
+}
+
+static void PutGzipCache(uint64_t key, const char *p, size_t n, uint32_t crc) {
+  long epoch;
+  size_t off;
+  struct GzipCacheEntry *e;
+  if (n > gzipcache.size / 8)
+    return;
+  pthread_spin_lock(&gzipcache.s->lock);
+  if (gzipcache.s->used + n > gzipcache.size ||
+      (gzipcache.s->count + 1) * 2 > gzipcache.n) {
+    // rather than tracking which entries are hot, start over when full
+    DEBUGF("(srvr) recycling gzip cache with %,zu entries",
+           gzipcache.s->count);
+    atomic_fetch_add(&gzipcache.s->epoch, 1);
+    bzero(gzipcache.s->p, gzipcache.n * sizeof(*gzipcache.s->p));
+    gzipcache.s->used = 0;
+    gzipcache.s->count = 0;
+  }
+  off = gzipcache.s->used;
+  gzipcache.s->used += n;
+  epoch = gzipcache.s->epoch;
+  pthread_spin_unlock(&gzipcache.s->lock);
+  atomic_thread_fence(memory_order_release);
+  memcpy(gzipcache.arena + off, p, n);
+  pthread_spin_lock(&gzipcache.s->lock);
+  if (gzipcache.s->epoch == epoch && !(e = GetGzipCacheSlot(key))->key) {
+    e->key = key;
+    e->off = off;
+    e->size = n;
+    e->crc = crc;
+    ++gzipcache.s->count;
+  }
+  pthread_spin_unlock(&gzipcache.s->lock);
+}
+
+static bool CanCacheGzip(void) {
+  return gzipcache.s && !usingssl && cpm.contentlength <= gzipcache.size / 8;
+}
+
 static void *LoadAsset(struct Asset *a, size_t *out_size) {
   size_t size;
   uint8_t *data;
@@ -2433,8 +3086,7 @@ static void *LoadAsset(struct Asset *a, size_t *out_size) {
     if (size == SIZE_MAX || !(data = malloc(size + 1)))
       return NULL;
     if (IsCompressed(a)) {
-      if (!Inflate(data, size, ZIP_LFILE_CONTENT(zmap + a->lf),
-                   GetZipCfileCompressedSize(zmap + a->cf))) {
+      if (!Decompress(a, data, size)) {
         free(data);
         return NULL;
       }
@@ -2450,7 +3102,7 @@ static void *LoadAsset(struct Asset *a, size_t *out_size) {
       *out_size = size;
     return data;
   } else {
-    LockInc(&shared->c.slurps);
+    CountInc(slurps);
     return xslurp(a->file->path.s, out_size);
   }
 }
@@ -2486,37 +3138,385 @@ static void AppendLogo(void) {
   }
 }
 
+static void OnSendError(void) {
+  if (errno == ECONNRESET) {
+    CountInc(writeresets);
+    DEBUGF("(rsp) %s write reset", DescribeClient());
+  } else if (errno == EAGAIN) {
+    CountInc(writetimeouts);
+    WARNF("(rsp) %s write timeout", DescribeClient());
+    errno = 0;
+  } else {
+    CountInc(writeerrors);
+    if (errno == EBADF) {  // don't warn on close/bad fd
+      DEBUGF("(rsp) %s write badf", DescribeClient());
+    } else {
+      WARNF("(rsp) %s write error: %m", DescribeClient());
+    }
+  }
+  connectionclose = true;
+}
+
 static ssize_t Send(struct iovec *iov, int iovlen) {
   ssize_t rc;
-  if ((rc = writer(client, iov, iovlen)) == -1) {
-    if (errno == ECONNRESET) {
-      LockInc(&shared->c.writeresets);
-      DEBUGF("(rsp) %s write reset", DescribeClient());
-    } else if (errno == EAGAIN) {
-      LockInc(&shared->c.writetimeouts);
-      WARNF("(rsp) %s write timeout", DescribeClient());
+  if ((rc = writer(client, iov, iovlen)) == -1)
+    OnSendError();
+  return rc;
+}
+
+// returns true if response body can be transmitted using sendfile()
+static bool CanSendfile(void) {
+  return writer == WritevAll && cpm.sendbase &&
+         cpm.contentlength >= SENDFILE_MIN && cpm.content >= cpm.sendbase &&
+         cpm.content + cpm.contentlength <= cpm.sendbase + cpm.sendsize;
+}
+
+// transmits response body straight from file without copying, or
+// returns -1 w/ errno preserved if nothing could be sent that way
+static ssize_t SendfileAll(void) {
+  ssize_t rc;
+  int64_t off;
+  size_t total;
+  off = cpm.sendoff + (cpm.content - cpm.sendbase);
+  for (total = 0; total < cpm.contentlength;) {
+    if ((rc = sendfile(client, cpm.sendfd, &off,
+                       cpm.contentlength - total)) > 0) {
+      total += rc;
+    } else if (!rc) {
+      break;  // file was truncated
+    } else if (errno == EINTR) {
       errno = 0;
+      CountInc(writeinterruputs);
+      if (killed || IsTakingTooLong())
+        break;
     } else {
-      LockInc(&shared->c.writeerrors);
-      if (errno == EBADF) {  // don't warn on close/bad fd
-        DEBUGF("(rsp) %s write badf", DescribeClient());
-      } else {
-        WARNF("(rsp) %s write error: %m", DescribeClient());
-      }
+      if (!total)
+        return -1;
+      break;
     }
+  }
+  if (total < cpm.contentlength)
     connectionclose = true;
+  return total;
+}
+
+// holds back partial segments so headers and body share packets,
+// since otherwise nagle and delayed acks can stall us for 40ms
+static void CorkClient(bool cork) {
+  int x = cork;
+  if (TCP_CORK)
+    setsockopt(client, IPPROTO_TCP, TCP_CORK, &x, sizeof(x));
+}
+
+static ssize_t SendContent(struct iovec *iov) {
+  ssize_t rc;
+  if ((rc = SendfileAll()) != -1) {
+    CountInc(sendfiles);
+    return rc;
   }
-  return rc;
+  if (errno == ENOSYS || errno == EINVAL || errno == EBADF ||
+      errno == EOPNOTSUPP || errno == ESPIPE) {
+    errno = 0;  // e.g. openbsd, or not a tcp socket
+    return Send(iov, 1);
+  }
+  OnSendError();
+  return -1;
 }
 
 static bool IsSslCompressed(void) {
   return usingssl && ssl.session->compression;
 }
 
+static void InitPageCache(void) {
+  char *p;
+  size_t n, m;
+  if (pagecachesize <= 0)
+    return;
+  pagecache.n = roundup2pow(MAX(64, pagecachesize / 4096 * 2));
+  m = ROUNDUP(sizeof(struct PageCacheShared) +
+                  pagecache.n * sizeof(struct PageCacheEntry),
+              64);
+  n = ROUNDUP(m + pagecachesize, getgransize());
+  CHECK_NE(MAP_FAILED, (p = mmap(0, n, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_ANONYMOUS, -1, 0)));
+  pagecache.s = (struct PageCacheShared *)p;
+  pagecache.arena = p + m;
+  pagecache.size = n - m;
+}
+
+static uint64_t HashCacheKey(uint64_t h, const char *p, size_t n) {
+  size_t i;
+  for (i = 0; i < n; ++i)
+    h = MixCacheKey(h, p[i] & 255);
+  return MixCacheKey(h, n);
+}
+
+static int64_t GetPageCacheTime(void) {
+  return timespec_tomillis(timespec_real());
+}
+
+static uint64_t GetPageCacheKey(void) {
+  uint64_t h;
+  h = MixCacheKey(0, cpm.msg.method);
+  h = HashCacheKey(h, url.host.p, url.host.n);
+  h = HashCacheKey(h, inbuf.p + cpm.msg.uri.a, cpm.msg.uri.b - cpm.msg.uri.a);
+  return MAX(1, h ^ h >> 32);
+}
+
+static const char *FindRequestHeader(const char *k, size_t n, size_t *vn) {
+  int h;
+  size_t i;
+  if ((h = GetHttpHeader(k, n)) != -1) {
+    if (HasHeader(h)) {
+      *vn = HeaderLength(h);
+      return HeaderData(h);
+    }
+  } else {
+    for (i = 0; i < cpm.msg.xheaders.n; ++i) {
+      if (SlicesEqualCase(
+              k, n, inbuf.p + cpm.msg.xheaders.p[i].k.a,
+              cpm.msg.xheaders.p[i].k.b - cpm.msg.xheaders.p[i].k.a)) {
+        *vn = cpm.msg.xheaders.p[i].v.b - cpm.msg.xheaders.p[i].v.a;
+        return inbuf.p + cpm.msg.xheaders.p[i].v.a;
+      }
+    }
+  }
+  return 0;
+}
+
+// mixes values of request headers named by newline terminated list
+static uint64_t GetPageCacheVaryKey(uint64_t h, const char *s, size_t n) {
+  size_t vn;
+  const char *v, *e;
+  while (n && (e = memchr(s, '\n', n))) {
+    h = HashCacheKey(h, s, e - s);
+    if ((v = FindRequestHeader(s, e - s, &vn))) {
+      h = HashCacheKey(h, v, vn);
+    } else {
+      h = MixCacheKey(h, -1);
+    }
+    n -= e + 1 - s;
+    s = e + 1;
+  }
+  return MAX(1, h ^ h >> 32);
+}
+
+static struct PageCacheEntry *GetPageCacheSlot(uint64_t key) {
+  size_t i;
+  struct PageCacheEntry *e;
+  for (i = key;; ++i) {
+    e = pagecache.s->p + (i & (pagecache.n - 1));
+    if (!e->key || e->key == key)
+      return e;
+  }
+}
+
+// copies record out of cache, or returns null if there's none that's
+// fresh; once a record expires, the first worker to ask for it claims
+// it and gets null, so it can regenerate it, while everyone else keeps
+// getting the stale copy in the meantime
+static struct PageRecord *GetPageCache(uint64_t key) {
+  char *p;
+  long epoch;
+  bool stale;
+  int64_t now;
+  size_t n, off;
+  struct PageCacheEntry *e;
+  n = 0;
+  stale = false;
+  now = GetPageCacheTime();
+  pthread_spin_lock(&pagecache.s->lock);
+  if ((e = GetPageCacheSlot(key))->key) {
+    if (now < e->expires || (stale = now < e->filling)) {
+      off = e->off;
+      n = e->size;
+      epoch = pagecache.s->epoch;
+    } else {
+      e->filling = now + PAGE_CACHE_FILL;
+      cpm.cacheclaim = key;
+    }
+  }
+  pthread_spin_unlock(&pagecache.s->lock);
+  if (!n || !(p = malloc(n)))
+    return 0;
+  memcpy(p, pagecache.arena + off, n);
+  atomic_thread_fence(memory_order_acquire);
+  if (atomic_load(&pagecache.s->epoch) != epoch) {
+    free(p);
+    return 0;
+  }
+  if (stale)
+    CountInc(pagecachestale);
+  return FreeLater(p);
+}
+
+static void PutPageCache(uint64_t key, const void *p, size_t n,
+                         int64_t expires) {
+  long epoch;
+  size_t off;
+  struct PageCacheEntry *e;
+  if (n > pagecache.size / 8)
+    return;
+  pthread_spin_lock(&pagecache.s->lock);
+  if (pagecache.s->used + n > pagecache.size ||
+      (pagecache.s->count + 1) * 2 > pagecache.n) {
+    DEBUGF("(srvr) recycling page cache with %,zu entries",
+           pagecache.s->count);
+    atomic_fetch_add(&pagecache.s->epoch, 1);
+    bzero(pagecache.s->p, pagecache.n * sizeof(*pagecache.s->p));
+    pagecache.s->used = 0;
+    pagecache.s->count = 0;
+  }
+  off = pagecache.s->used;
+  pagecache.s->used += n;
+  epoch = pagecache.s->epoch;
+  pthread_spin_unlock(&pagecache.s->lock);
+  atomic_thread_fence(memory_order_release);
+  memcpy(pagecache.arena + off, p, n);
+  pthread_spin_lock(&pagecache.s->lock);
+  if (pagecache.s->epoch == epoch) {
+    if (!(e = GetPageCacheSlot(key))->key) {
+      e->key = key;
+      ++pagecache.s->count;
+    }
+    e->off = off;
+    e->size = n;
+    e->expires = expires;
+    e->filling = 0;
+  }
+  pthread_spin_unlock(&pagecache.s->lock);
+}
+
+// invalidates the page we claimed but didn't store, since it mustn't be
+// served stale anymore; the key stays, so probe chains aren't broken
+static void UnclaimPageCache(void) {
+  struct PageCacheEntry *e;
+  pthread_spin_lock(&pagecache.s->lock);
+  if ((e = GetPageCacheSlot(cpm.cacheclaim))->key) {
+    e->size = 0;
+    e->expires = 0;
+    e->filling = 0;
+  }
+  pthread_spin_unlock(&pagecache.s->lock);
+  cpm.cacheclaim = 0;
+}
+
+static bool IsPageCacheable(void) {
+  return pagecache.s &&
+         (cpm.msg.method == kHttpGet || cpm.msg.method == kHttpHead);
+}
+
+static char *ServePageRecord(char *p, struct PageRecord *r) {
+  char *b;
+  b = (char *)(r + 1) + r->reasonlen + 1 + r->headerslen;
+  if (r->gziplen && !IsSslCompressed()) {
+    p = stpcpy(p, "Vary: Accept-Encoding\r\n");
+    if (ClientAcceptsGzip() && !ShouldAvoidGzip()) {
+      cpm.gzipped = r->identitylen;
+      WRITE32LE(gzip_footer + 0, r->crc);
+      WRITE32LE(gzip_footer + 4, r->identitylen);
+      cpm.content = b + r->identitylen;
+      cpm.contentlength = r->gziplen;
+      return p;
+    }
+  }
+  cpm.content = b;
+  cpm.contentlength = r->identitylen;
+  return p;
+}
+
+static char *ServeCachedPage(void) {
+  char *p;
+  uint64_t key;
+  struct PageRecord *r;
+  if (!IsPageCacheable() || !pagecache.s->count)
+    return 0;
+  if (!(r = GetPageCache((key = GetPageCacheKey()))))
+    return 0;
+  if (!r->statuscode) {
+    key = GetPageCacheVaryKey(key, (char *)(r + 1), r->headerslen);
+    if (!(r = GetPageCache(key)) || !r->statuscode)
+      return 0;
+  }
+  CountInc(pagecachehits);
+  p = SetStatus(r->statuscode, (char *)(r + 1));
+  p = ReserveHeaders(p, r->headerslen);
+  p = mempcpy(p, (char *)(r + 1) + r->reasonlen + 1, r->headerslen);
+  cpm.hascontenttype = true;
+  cpm.branded = r->branded;
+  return ServePageRecord(p, r);
+}
+
+// saves lua output to page cache, then serves it from the new record
+static char *StorePage(char *p) {
+  char *b, *q, *gz;
+  const char *reason;
+  size_t n, gzlen, outbuflen;
+  uint64_t key;
+  int64_t expires;
+  struct PageRecord r, *v;
+  CountInc(pagecachestores);
+  // bake in headers that would otherwise be appended afterwards
+  outbuflen = appendz(cpm.outbuf).i;
+  if (!cpm.hascontenttype && outbuflen)
+    p = AppendContentType(p, "text/html");
+  if (cpm.referrerpolicy) {
+    p = stpcpy(p, "Referrer-Policy: ");
+    p = stpcpy(p, cpm.referrerpolicy);
+    p = stpcpy(p, "\r\n");
+    cpm.referrerpolicy = 0;
+  }
+  bzero(&r, sizeof(r));
+  reason = hdrbuf.p + 13;
+  r.statuscode = cpm.statuscode;
+  r.branded = cpm.branded;
+  r.reasonlen = (char *)memmem(reason, p - reason, "\r\n", 2) - reason;
+  r.headerslen = p - (reason + r.reasonlen + 2);
+  r.identitylen = outbuflen;
+  gz = 0;
+  if (cpm.istext && outbuflen >= 100 && !IsTiny()) {
+    r.crc = crc32_z(0, cpm.outbuf, outbuflen);
+    gz = Deflate(cpm.outbuf, outbuflen, &gzlen);
+    r.gziplen = gzlen;
+  }
+  n = sizeof(r) + r.reasonlen + 1 + r.headerslen + r.identitylen + r.gziplen;
+  b = FreeLater(xmalloc(n));
+  q = mempcpy(b, &r, sizeof(r));
+  q = mempcpy(q, reason, r.reasonlen);
+  *q++ = 0;
+  q = mempcpy(q, reason + r.reasonlen + 2, r.headerslen);
+  q = mempcpy(q, cpm.outbuf, r.identitylen);
+  if (gz)
+    memcpy(q, gz, r.gziplen);
+  free(gz);
+  DropOutput();
+  expires = GetPageCacheTime() + cpm.cachettl;
+  key = GetPageCacheKey();
+  if (cpm.cachevary) {
+    n = strlen(cpm.cachevary);
+    v = gc(xcalloc(1, sizeof(*v) + n));
+    v->headerslen = n;
+    memcpy(v + 1, cpm.cachevary, n);
+    PutPageCache(key, v, sizeof(*v) + n, expires);
+    key = GetPageCacheVaryKey(key, cpm.cachevary, n);
+  }
+  PutPageCache(key, b, sizeof(r) + r.reasonlen + 1 + r.headerslen +
+                           r.identitylen + r.gziplen,
+               expires);
+  return ServePageRecord(p, (struct PageRecord *)b);
+}
+
+static bool ShouldStorePage(void) {
+  return cpm.cachettl > 0 && IsPageCacheable() && cpm.msg.version >= 10 &&
+         !cpm.isyielding && !cpm.gotsetcookie && cpm.statuscode < 500;
+}
+
 static char *CommitOutput(char *p) {
   uint32_t crc;
   size_t outbuflen;
   if (!cpm.contentlength) {
+    if (ShouldStorePage())
+      return StorePage(p);
     outbuflen = appendz(cpm.outbuf).i;
     if (cpm.istext && !cpm.isyielding && outbuflen >= 100) {
       if (!IsTiny() && !IsSslCompressed()) {
@@ -2576,7 +3576,7 @@ static char *ServeErrorImplDefault(unsigned code, const char *reason,
   size_t n;
   char *p, *s;
   struct Asset *a;
-  LockInc(&shared->c.errors);
+  CountInc(errors);
   DropOutput();
   p = SetStatus(code, reason);
   s = xasprintf("/%d.html", code);
@@ -2585,7 +3585,7 @@ static char *ServeErrorImplDefault(unsigned code, const char *reason,
   if (!a) {
     return ServeDefaultErrorPage(p, code, reason, details);
   } else if (a->file) {
-    LockInc(&shared->c.slurps);
+    CountInc(slurps);
     cpm.content = FreeLater(xslurp(a->file->path.s, &cpm.contentlength));
     return AppendContentType(p, "text/html; charset=utf-8");
   } else {
@@ -2593,8 +3593,7 @@ static char *ServeErrorImplDefault(unsigned code, const char *reason,
     cpm.contentlength = GetZipCfileCompressedSize(zmap + a->cf);
     if (IsCompressed(a)) {
       n = GetZipLfileUncompressedSize(zmap + a->lf);
-      if ((s = FreeLater(malloc(n))) &&
-          Inflate(s, n, cpm.content, cpm.contentlength)) {
+      if ((s = FreeLater(malloc(n))) && Decompress(a, s, n)) {
         cpm.content = s;
         cpm.contentlength = n;
       } else {
@@ -2771,14 +3770,47 @@ static ssize_t DeflateGenerator(struct iovec v[3]) {
   return v[0].iov_len + v[1].iov_len + v[2].iov_len;
 }
 
-static char *ServeAssetCompressed(struct Asset *a) {
+// serves gzip of asset from the cache, only deflating it the first time
+static char *ServeAssetCachedGzip(struct Asset *a) {
   char *p;
-  LockInc(&shared->c.deflates);
-  LockInc(&shared->c.compressedresponses);
-  DEBUGF("(srvr) ServeAssetCompressed()");
-  dg.t = 0;
-  dg.i = 0;
-  dg.c = 0;
+  size_t n;
+  uint32_t crc;
+  uint64_t key;
+  DEBUGF("(srvr) ServeAssetCachedGzip()");
+  key = GetGzipCacheKey(a);
+  if ((p = GetGzipCache(key, &n, &crc))) {
+    CountInc(gzipcachehits);
+  } else {
+    CountInc(gzipcachemisses);
+    if (!a->file) {
+      crc = ZIP_LFILE_CRC32(zmap + a->lf);
+      if (!Verify(cpm.content, cpm.contentlength, crc))
+        return ServeError(500, "Internal Server Error");
+    } else {
+      crc = crc32_z(0, cpm.content, cpm.contentlength);
+    }
+    p = Deflate(cpm.content, cpm.contentlength, &n);
+    PutGzipCache(key, p, n, crc);
+  }
+  CountInc(compressedresponses);
+  cpm.gzipped = cpm.contentlength;
+  cpm.content = FreeLater(p);
+  cpm.contentlength = n;
+  WRITE32LE(gzip_footer + 0, crc);
+  WRITE32LE(gzip_footer + 4, cpm.gzipped);
+  return SetStatus(200, "OK");
+}
+
+static char *ServeAssetCompressed(struct Asset *a) {
+  char *p;
+  if (CanCacheGzip())
+    return ServeAssetCachedGzip(a);
+  CountInc(deflates);
+  CountInc(compressedresponses);
+  DEBUGF("(srvr) ServeAssetCompressed()");
+  dg.t = 0;
+  dg.i = 0;
+  dg.c = 0;
   if (usingssl) {
     dg.z = 512 + (_rand64() & 1023);
   } else {
@@ -2836,15 +3868,15 @@ static ssize_t InflateGenerator(struct iovec v[3]) {
 static char *ServeAssetDecompressed(struct Asset *a) {
   char *p;
   size_t size;
-  LockInc(&shared->c.inflates);
-  LockInc(&shared->c.decompressedresponses);
+  CountInc(inflates);
+  CountInc(decompressedresponses);
   size = GetZipCfileUncompressedSize(zmap + a->cf);
   DEBUGF("(srvr) ServeAssetDecompressed(%ld)→%ld", cpm.contentlength, size);
   if (cpm.msg.method == kHttpHead) {
     cpm.content = 0;
     cpm.contentlength = size;
     return SetStatus(200, "OK");
-  } else if (!IsTiny()) {
+  } else if (!IsTiny() && !IsZstd(a)) {
     dg.t = 0;
     dg.i = 0;
     dg.c = 0;
@@ -2854,8 +3886,7 @@ static char *ServeAssetDecompressed(struct Asset *a) {
     cpm.generator = InflateGenerator;
     dg.b = FreeLater(malloc(dg.z));
     return SetStatus(200, "OK");
-  } else if ((p = FreeLater(malloc(size))) &&
-             Inflate(p, size, cpm.content, cpm.contentlength) &&
+  } else if ((p = FreeLater(malloc(size))) && Decompress(a, p, size) &&
              Verify(p, size, ZIP_CFILE_CRC32(zmap + a->cf))) {
     cpm.content = p;
     cpm.contentlength = size;
@@ -2866,16 +3897,23 @@ static char *ServeAssetDecompressed(struct Asset *a) {
 }
 
 static inline char *ServeAssetIdentity(struct Asset *a, const char *ct) {
-  LockInc(&shared->c.identityresponses);
+  CountInc(identityresponses);
   DEBUGF("(srvr) ServeAssetIdentity(%`'s)", ct);
   return SetStatus(200, "OK");
 }
 
 static inline char *ServeAssetPrecompressed(struct Asset *a) {
+  char *p;
   size_t size;
   uint32_t crc;
   DEBUGF("(srvr) ServeAssetPrecompressed()");
-  LockInc(&shared->c.precompressedresponses);
+  CountInc(precompressedresponses);
+  if (IsZstd(a)) {
+    // zip stores a complete zstd frame, so it's sent as-is
+    cpm.zstdsize = GetZipCfileUncompressedSize(zmap + a->cf);
+    p = SetStatus(200, "OK");
+    return stpcpy(p, "Content-Encoding: zstd\r\n");
+  }
   crc = ZIP_CFILE_CRC32(zmap + a->cf);
   size = GetZipCfileUncompressedSize(zmap + a->cf);
   cpm.gzipped = size;
@@ -2892,14 +3930,14 @@ static char *ServeAssetRange(struct Asset *a) {
                      cpm.contentlength, &rangestart, &rangelength) &&
       rangestart >= 0 && rangelength >= 0 && rangestart < cpm.contentlength &&
       rangestart + rangelength <= cpm.contentlength) {
-    LockInc(&shared->c.partialresponses);
+    CountInc(partialresponses);
     p = SetStatus(206, "Partial Content");
     p = AppendContentRange(p, rangestart, rangelength, cpm.contentlength);
     cpm.content += rangestart;
     cpm.contentlength = rangelength;
     return p;
   } else {
-    LockInc(&shared->c.badranges);
+    CountInc(badranges);
     WARNF("(client) bad range %`'.*s", HeaderLength(kHttpRange),
           HeaderData(kHttpRange));
     p = SetStatus(416, "Range Not Satisfiable");
@@ -2981,7 +4019,7 @@ static void LaunchBrowser(const char *path) {
 }
 
 static char *BadMethod(void) {
-  LockInc(&shared->c.badmethods);
+  CountInc(badmethods);
   return stpcpy(ServeError(405, "Method Not Allowed"), "Allow: GET, HEAD\r\n");
 }
 
@@ -3016,7 +4054,7 @@ static char *ServeListing(void) {
   struct timespec lastmod;
   size_t n, pathlen, rn[6];
   char rb[8], tb[20], *rp[6];
-  LockInc(&shared->c.listingrequests);
+  CountInc(listingrequests);
   if (cpm.msg.method != kHttpGet && cpm.msg.method != kHttpHead)
     return BadMethod();
   appends(&cpm.outbuf, "\
@@ -3102,7 +4140,7 @@ td { padding-right: 3em; }\r\n\
 <td valign=\"top\">\r\n\
 <a href=\"/statusz\">/statusz</a>\r\n\
 ");
-  if (shared->c.connectionshandled) {
+  if (CountGet(connectionshandled)) {
     appends(&cpm.outbuf, "says your redbean<br>\r\n");
     AppendResourceReport(&cpm.outbuf, &shared->children, "<br>\r\n");
   }
@@ -3126,9 +4164,9 @@ td { padding-right: 3em; }\r\n\
   }
   appendf(&cpm.outbuf, "%s%,ld second%s of operation<br>\r\n", and, y.rem,
           y.rem == 1 ? "" : "s");
-  x = shared->c.messageshandled;
+  x = CountGet(messageshandled);
   appendf(&cpm.outbuf, "%,ld message%s handled<br>\r\n", x, x == 1 ? "" : "s");
-  x = shared->c.connectionshandled;
+  x = CountGet(connectionshandled);
   appendf(&cpm.outbuf, "%,ld connection%s handled<br>\r\n", x,
           x == 1 ? "" : "s");
   x = shared->workers;
@@ -3185,7 +4223,10 @@ static void AppendRusage(const char *a, struct rusage *ru) {
 static void ServeCounters(void) {
   const long *c;
   const char *s;
-  for (c = (const long *)&shared->c, s = kCounterNames; *s;
+  struct Counters sums;
+  percpu_sums((long *)&sums, (const long *)&shared->c[0],
+              sizeof(sums) / sizeof(long), sizeof(shared->c[0]));
+  for (c = (const long *)&sums, s = kCounterNames; *s;
        ++c, s += strlen(s) + 1) {
     AppendLong1(s, *c);
   }
@@ -3193,7 +4234,7 @@ static void ServeCounters(void) {
 
 static char *ServeStatusz(void) {
   char *p;
-  LockInc(&shared->c.statuszrequests);
+  CountInc(statuszrequests);
   if (cpm.msg.method != kHttpGet && cpm.msg.method != kHttpHead) {
     return BadMethod();
   }
@@ -3226,7 +4267,7 @@ static char *ServeStatusz(void) {
 static char *RedirectSlash(void) {
   size_t n, i;
   char *p, *e;
-  LockInc(&shared->c.redirects);
+  CountInc(redirects);
   p = SetStatus(307, "Temporary Redirect");
   p = stpcpy(p, "Location: ");
   e = EscapePath(url.path.p, url.path.n, &n);
@@ -3291,7 +4332,7 @@ static char *ServeLua(struct Asset *a, const char *s, size_t n) {
   char *code;
   size_t codelen;
   lua_State *L = GL;
-  LockInc(&shared->c.dynamicrequests);
+  CountInc(dynamicrequests);
   effectivepath.p = (void *)s;
   effectivepath.n = n;
   if ((code = FreeLater(LoadAsset(a, &codelen)))) {
@@ -3317,19 +4358,19 @@ static char *HandleRedirect(struct Redirect *r) {
   int code;
   struct Asset *a;
   if (!r->code && (a = GetAsset(r->location.s, r->location.n))) {
-    LockInc(&shared->c.rewrites);
+    CountInc(rewrites);
     DEBUGF("(rsp) internal redirect to %`'s", r->location.s);
     if (!HasString(&cpm.loops, r->location.s, r->location.n)) {
       AddString(&cpm.loops, r->location.s, r->location.n);
       return RoutePath(r->location.s, r->location.n);
     } else {
-      LockInc(&shared->c.loops);
+      CountInc(loops);
       return SetStatus(508, "Loop Detected");
     }
   } else if (cpm.msg.version < 10) {
     return ServeError(505, "HTTP Version Not Supported");
   } else {
-    LockInc(&shared->c.redirects);
+    CountInc(redirects);
     code = r->code;
     if (!code)
       code = 307;
@@ -3349,15 +4390,22 @@ static char *HandleFolder(const char *path, size_t pathlen) {
   if ((p = ServeIndex(path, pathlen))) {
     return p;
   } else {
-    LockInc(&shared->c.forbiddens);
+    CountInc(forbiddens);
     WARNF("(srvr) directory %`'.*s lacks index page", pathlen, path);
     return ServeErrorWithPath(403, "Forbidden", path, pathlen);
   }
 }
 
+// tells if reindexing the zip could change assets, without locking
+static bool HasZipChanged(void) {
+  struct stat st;
+  return stat(zpath, &st) != -1 &&
+         (st.st_ino != zst.st_ino || st.st_size > zst.st_size);
+}
+
 static bool Reindex(void) {
   if (OpenZip(false)) {
-    LockInc(&shared->c.reindexes);
+    CountInc(reindexes);
     return true;
   } else {
     return false;
@@ -3405,7 +4453,7 @@ static void OnlyCallFromInitLua(lua_State *L, const char *api) {
 }
 
 static void OnlyCallFromMainProcess(lua_State *L, const char *api) {
-  if (__isworker) {
+  if (__isworker || isthreadworker) {
     luaL_error(L, "%s() should be called %s", api,
                "from .init.lua or the repl");
     __builtin_unreachable();
@@ -3661,6 +4709,20 @@ static void GetDosLocalTime(int64_t utcunixts, uint16_t *out_time,
   *out_date = DOS_DATE(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday + 1);
 }
 
+// keeps thread workers from serving while main thread changes assets,
+// which lua hooks like OnServerReload may do again while it's locked
+static void LockThreadWorkers(void) {
+  if (threads && !lockedthreadworkers++) {
+    pthread_rwlock_wrlock(&reloadlock);
+  }
+}
+
+static void UnlockThreadWorkers(void) {
+  if (threads && !--lockedthreadworkers) {
+    pthread_rwlock_unlock(&reloadlock);
+  }
+}
+
 static void StoreAsset(const char *path, size_t pathlen, const char *data,
                        size_t datalen, int mode) {
   int64_t ft;
@@ -3915,7 +4977,16 @@ static int LuaStoreAsset(lua_State *L) {
   }
   data = luaL_checklstring(L, 2, &datalen);
   mode = luaL_optinteger(L, 3, 0);
+  // thread workers only hold the read side of reloadlock, which can't
+  // be upgraded, and StoreAsset() reindexes the zip underneath them
+  if (isthreadworker) {
+    luaL_error(L, "StoreAsset() can't be called %s",
+               "while handling a request in thread mode");
+    __builtin_unreachable();
+  }
+  LockThreadWorkers();
   StoreAsset(path, pathlen, data, datalen, mode);
+  UnlockThreadWorkers();
   return 0;
 }
 
@@ -4236,6 +5307,14 @@ static int LuaGetResponseBody(lua_State *L) {
              : cpm.gzipped == 0 ? cpm.contentlength
                                 : 0;
   OnlyCallDuringRequest(L, "GetResponseBody");
+  if (cpm.zstdsize) {
+    if (!(s = FreeLater(malloc(cpm.zstdsize))) ||
+        !Unzstd(s, cpm.zstdsize, cpm.content, cpm.contentlength)) {
+      return LuaNilError(L, "failed to decompress response");
+    }
+    lua_pushlstring(L, s, cpm.zstdsize);
+    return 1;
+  }
   if (cpm.gzipped > 0 &&
       (!(s = FreeLater(malloc(cpm.gzipped))) ||
        !Inflate(s, cpm.gzipped, cpm.content, cpm.contentlength))) {
@@ -4281,8 +5360,8 @@ static int LuaGetHeaders(lua_State *L) {
 
 static int LuaSetHeader(lua_State *L) {
   int h;
+  char *p;
   char *eval;
-  char *p, *q;
   const char *key, *val;
   size_t keylen, vallen, evallen;
   OnlyCallDuringRequest(L, "SetHeader");
@@ -4300,13 +5379,7 @@ static int LuaSetHeader(lua_State *L) {
     luaL_argerror(L, 2, "invalid");
     __builtin_unreachable();
   }
-  p = GetLuaResponse();
-  while (p - hdrbuf.p + keylen + 2 + evallen + 2 + 512 > hdrbuf.n) {
-    hdrbuf.n += hdrbuf.n >> 1;
-    q = xrealloc(hdrbuf.p, hdrbuf.n);
-    cpm.luaheaderp = p = q + (p - hdrbuf.p);
-    hdrbuf.p = q;
-  }
+  p = ReserveHeaders(GetLuaResponse(), keylen + 2 + evallen + 2);
   switch (h) {
     case kHttpConnection:
       connectionclose = SlicesEqualCase(eval, evallen, "close", 5);
@@ -4317,6 +5390,10 @@ static int LuaSetHeader(lua_State *L) {
     case kHttpReferrerPolicy:
       cpm.referrerpolicy = FreeLater(strdup(eval));
       break;
+    case kHttpSetCookie:
+      cpm.gotsetcookie = true;
+      p = AppendHeader(p, key, eval);
+      break;
     case kHttpServer:
       cpm.branded = true;
       p = AppendHeader(p, "Server", eval);
@@ -4339,6 +5416,33 @@ static int LuaSetHeader(lua_State *L) {
   return 0;
 }
 
+static int LuaSetCacheTTL(lua_State *L) {
+  int i, n;
+  char *vary;
+  size_t keylen;
+  const char *key;
+  lua_Number seconds;
+  OnlyCallDuringRequest(L, "SetCacheTTL");
+  seconds = luaL_checknumber(L, 1);
+  if (!(seconds > 0))
+    seconds = 0;  // including nan
+  if (seconds > 3e9)
+    seconds = 3e9;  // about a century
+  for (vary = 0, n = lua_gettop(L), i = 2; i <= n; ++i) {
+    key = luaL_checklstring(L, i, &keylen);
+    if (!IsValidHttpToken(key, keylen)) {
+      free(vary);
+      luaL_argerror(L, i, "invalid");
+      __builtin_unreachable();
+    }
+    appendd(&vary, key, keylen);
+    appendw(&vary, '\n');
+  }
+  cpm.cachettl = seconds * 1000;
+  cpm.cachevary = FreeLater(vary);
+  return 0;
+}
+
 static int LuaGetCookie(lua_State *L) {
   char *cookie = 0, *cookietmpl, *cookieval;
   OnlyCallDuringRequest(L, "GetCookie");
@@ -4546,6 +5650,16 @@ static int LuaProgramGid(lua_State *L) {
   return LuaProgramInt(L, ProgramGid);
 }
 
+static int LuaProgramGzipCache(lua_State *L) {
+  OnlyCallFromInitLua(L, "ProgramGzipCache");
+  return LuaProgramInt(L, ProgramGzipCache);
+}
+
+static int LuaProgramPageCache(lua_State *L) {
+  OnlyCallFromInitLua(L, "ProgramPageCache");
+  return LuaProgramInt(L, ProgramPageCache);
+}
+
 static int LuaProgramMaxPayloadSize(lua_State *L) {
   OnlyCallFromInitLua(L, "ProgramMaxPayloadSize");
   return LuaProgramInt(L, ProgramMaxPayloadSize);
@@ -4579,6 +5693,24 @@ static int LuaProgramUniprocess(lua_State *L) {
   return 1;
 }
 
+static int LuaProgramPrefork(lua_State *L) {
+  OnlyCallFromInitLua(L, "ProgramPrefork");
+  ProgramPrefork(luaL_checkinteger(L, 1));
+  preforkconnections = luaL_optinteger(L, 2, preforkconnections);
+  preforkmemory = luaL_optinteger(L, 3, preforkmemory);
+  if (preforkconnections < 1)
+    return luaL_argerror(L, 2, "connections must be positive");
+  if (preforkmemory < 1)
+    return luaL_argerror(L, 3, "memory must be positive");
+  return 0;
+}
+
+static int LuaProgramThreads(lua_State *L) {
+  OnlyCallFromInitLua(L, "ProgramThreads");
+  ProgramThreads(luaL_checkinteger(L, 1));
+  return 0;
+}
+
 static int LuaProgramHeartbeatInterval(lua_State *L) {
   int64_t millis;
   OnlyCallFromMainProcess(L, "ProgramHeartbeatInterval");
@@ -5180,14 +6312,18 @@ static const char *const kDontAutoComplete[] = {
     "ProgramBrand",              //
     "ProgramCertificate",        // TODO
     "ProgramGid",                //
+    "ProgramGzipCache",          //
     "ProgramLogPath",            // TODO
     "ProgramMaxPayloadSize",     // TODO
+    "ProgramPageCache",          //
     "ProgramPidPath",            // TODO
     "ProgramPort",               // TODO
+    "ProgramPrefork",            //
     "ProgramPrivateKey",         // TODO
     "ProgramSslCiphersuite",     // TODO
     "ProgramSslClientVerify",    // TODO
     "ProgramSslTicketLifetime",  //
+    "ProgramThreads",            //
     "ProgramTimeout",            // TODO
     "ProgramUid",                //
     "ProgramUniprocess",         //
@@ -5200,6 +6336,7 @@ static const char *const kDontAutoComplete[] = {
     "ServeListing",              //
     "ServeRedirect",             //
     "ServeStatusz",              //
+    "SetCacheTTL",               //
     "SetCookie",                 //
     "SetHeader",                 //
     "SslInit",                   // TODO
@@ -5324,6 +6461,7 @@ static const luaL_Reg kLuaFuncs[] = {
     {"ProgramContentType", LuaProgramContentType},              //
     {"ProgramDirectory", LuaProgramDirectory},                  //
     {"ProgramGid", LuaProgramGid},                              //
+    {"ProgramGzipCache", LuaProgramGzipCache},                  //
     {"ProgramHeader", LuaProgramHeader},                        //
     {"ProgramHeartbeatInterval", LuaProgramHeartbeatInterval},  //
     {"ProgramLogBodies", LuaProgramLogBodies},                  //
@@ -5331,9 +6469,12 @@ static const luaL_Reg kLuaFuncs[] = {
     {"ProgramLogPath", LuaProgramLogPath},                      //
     {"ProgramMaxPayloadSize", LuaProgramMaxPayloadSize},        //
     {"ProgramMaxWorkers", LuaProgramMaxWorkers},                //
+    {"ProgramPageCache", LuaProgramPageCache},                  //
     {"ProgramPidPath", LuaProgramPidPath},                      //
     {"ProgramPort", LuaProgramPort},                            //
+    {"ProgramPrefork", LuaProgramPrefork},                      //
     {"ProgramRedirect", LuaProgramRedirect},                    //
+    {"ProgramThreads", LuaProgramThreads},                      //
     {"ProgramTimeout", LuaProgramTimeout},                      //
     {"ProgramTrustedIp", LuaProgramTrustedIp},                  // undocumented
     {"ProgramUid", LuaProgramUid},                              //
@@ -5352,6 +6493,7 @@ static const luaL_Reg kLuaFuncs[] = {
     {"ServeListing", LuaServeListing},                          //
     {"ServeRedirect", LuaServeRedirect},                        //
     {"ServeStatusz", LuaServeStatusz},                          //
+    {"SetCacheTTL", LuaSetCacheTTL},                            //
     {"SetCookie", LuaSetCookie},                                //
     {"SetHeader", LuaSetHeader},                                //
     {"SetLogLevel", LuaSetLogLevel},                            //
@@ -5431,11 +6573,10 @@ static void LuaSetConstant(lua_State *L, const char *s, long x) {
   lua_setglobal(L, s);
 }
 
-static void LuaStart(void) {
 #ifndef STATIC
+static lua_State *LuaNewState(void) {
   size_t i;
-  lua_State *L = GL = luaL_newstate();
-  g_lua_path_default = DEFAULTLUAPATH;
+  lua_State *L = luaL_newstate();
   luaL_openlibs(L);
   for (i = 0; i < ARRAYLEN(kLuaLibs); ++i) {
     luaL_requiref(L, kLuaLibs[i].name, kLuaLibs[i].func, 1);
@@ -5457,8 +6598,255 @@ static void LuaStart(void) {
   lua_pushlightuserdata(L, (void *)&ctIdx);  // push address as unique key
   lua_newtable(L);
   lua_settable(L, LUA_REGISTRYINDEX);  // registry[&ctIdx] = {}
+  return L;
+}
 #endif
+
+static void LuaStart(void) {
+#ifndef STATIC
+  g_lua_path_default = DEFAULTLUAPATH;
+  GL = LuaNewState();
+#endif
+}
+
+#ifndef STATIC
+struct LuaCloner {
+  lua_State *src;
+  int memo;     // dst table mapping src object addresses to their copies
+  int upvals;   // dst table mapping src upvalue ids to {closure, index}
+  int skipped;  // userdata and coroutines, which can't be copied
+};
+
+static void LuaCloneValue(lua_State *, struct LuaCloner *, int, int);
+
+static int LuaCloneWriter(lua_State *L, const void *p, size_t n, void *b) {
+  appendd(b, p, n);
+  return 0;
+}
+
+static bool LuaCloneLookup(lua_State *L, struct LuaCloner *c, const void *p) {
+  if (lua_rawgetp(L, c->memo, p) != LUA_TNIL)
+    return true;
+  lua_pop(L, 1);
+  return false;
+}
+
+static void LuaCloneRemember(lua_State *L, struct LuaCloner *c,
+                             const void *p) {
+  lua_pushvalue(L, -1);
+  lua_rawsetp(L, c->memo, p);
+}
+
+// copies fields of src table at index i into the table atop L
+static void LuaCloneTable(lua_State *L, struct LuaCloner *c, int i,
+                          int depth) {
+  lua_State *S = c->src;
+  i = lua_absindex(S, i);
+  if (!lua_checkstack(S, 4))
+    luaL_error(L, "clone stack overflow");
+  lua_pushnil(S);
+  while (lua_next(S, i)) {
+    LuaCloneValue(L, c, -2, depth);
+    LuaCloneValue(L, c, -1, depth);
+    if (!lua_isnil(L, -2) && !lua_isnil(L, -1)) {
+      lua_rawset(L, -3);
+    } else {
+      lua_pop(L, 2);
+    }
+    lua_pop(S, 1);
+  }
+  if (lua_getmetatable(S, i)) {
+    LuaCloneValue(L, c, -1, depth);
+    if (lua_istable(L, -1)) {
+      lua_setmetatable(L, -2);
+    } else {
+      lua_pop(L, 1);
+    }
+    lua_pop(S, 1);
+  }
+}
+
+// copies function, keeping upvalues shared between closures shared
+static void LuaCloneFunction(lua_State *L, struct LuaCloner *c, int i,
+                             int depth) {
+  int f, j;
+  void *id;
+  char *b = 0;
+  lua_CFunction cf;
+  lua_State *S = c->src;
+  i = lua_absindex(S, i);
+  if ((cf = lua_tocfunction(S, i))) {
+    for (j = 1; lua_getupvalue(S, i, j); ++j) {
+      LuaCloneValue(L, c, -1, depth);
+      lua_pop(S, 1);
+    }
+    lua_pushcclosure(L, cf, j - 1);
+    LuaCloneRemember(L, c, lua_topointer(S, i));
+    return;
+  }
+  lua_pushvalue(S, i);
+  lua_dump(S, LuaCloneWriter, &b, false);
+  lua_pop(S, 1);
+  if (luaL_loadbufferx(L, b, appendz(b).i, "=clone", "b") != LUA_OK) {
+    free(b);
+    lua_error(L);
+  }
+  free(b);
+  f = lua_gettop(L);
+  LuaCloneRemember(L, c, lua_topointer(S, i));
+  for (j = 1; lua_getupvalue(S, i, j); ++j) {
+    id = lua_upvalueid(S, i, j);
+    if (lua_rawgetp(L, c->upvals, id) == LUA_TTABLE) {
+      lua_rawgeti(L, -1, 1);
+      lua_rawgeti(L, -2, 2);
+      lua_upvaluejoin(L, f, j, -2, lua_tointeger(L, -1));
+      lua_pop(L, 3);
+    } else {
+      lua_pop(L, 1);
+      lua_createtable(L, 2, 0);
+      lua_pushvalue(L, f);
+      lua_rawseti(L, -2, 1);
+      lua_pushinteger(L, j);
+      lua_rawseti(L, -2, 2);
+      lua_rawsetp(L, c->upvals, id);
+      LuaCloneValue(L, c, -1, depth);
+      lua_setupvalue(L, f, j);
+    }
+    lua_pop(S, 1);
+  }
+}
+
+// pushes copy of value at index i of source state onto L
+static void LuaCloneValue(lua_State *L, struct LuaCloner *c, int i,
+                          int depth) {
+  size_t n;
+  const char *s;
+  const void *p;
+  lua_State *S = c->src;
+  luaL_checkstack(L, 8, "clone");
+  switch (lua_type(S, i)) {
+    case LUA_TNIL:
+      lua_pushnil(L);
+      break;
+    case LUA_TBOOLEAN:
+      lua_pushboolean(L, lua_toboolean(S, i));
+      break;
+    case LUA_TLIGHTUSERDATA:
+      lua_pushlightuserdata(L, lua_touserdata(S, i));
+      break;
+    case LUA_TNUMBER:
+      if (lua_isinteger(S, i)) {
+        lua_pushinteger(L, lua_tointeger(S, i));
+      } else {
+        lua_pushnumber(L, lua_tonumber(S, i));
+      }
+      break;
+    case LUA_TSTRING:
+      s = lua_tolstring(S, i, &n);
+      lua_pushlstring(L, s, n);
+      break;
+    case LUA_TTABLE:
+    case LUA_TFUNCTION:
+      p = lua_topointer(S, i);
+      if (LuaCloneLookup(L, c, p))
+        break;
+      if (depth >= 200) {
+        ++c->skipped;
+        lua_pushnil(L);
+      } else if (lua_istable(S, i)) {
+        lua_newtable(L);
+        LuaCloneRemember(L, c, p);
+        LuaCloneTable(L, c, i, depth + 1);
+      } else {
+        LuaCloneFunction(L, c, i, depth + 1);
+      }
+      break;
+    default:
+      ++c->skipped;
+      lua_pushnil(L);
+      break;
+  }
+}
+
+// merges table at src registry key k into the one of L
+static void LuaCloneRegistry(lua_State *L, struct LuaCloner *c,
+                             const void *k) {
+  if (lua_rawgetp(c->src, LUA_REGISTRYINDEX, k) == LUA_TTABLE) {
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, k) == LUA_TTABLE) {
+      LuaCloneRemember(L, c, lua_topointer(c->src, -1));
+      LuaCloneTable(L, c, -1, 0);
+    }
+    lua_pop(L, 1);
+  }
+  lua_pop(c->src, 1);
+}
+
+static int LuaCloneImpl(lua_State *L) {
+  int pass;
+  const void *g, *m;
+  struct LuaCloner *c = lua_touserdata(L, 1);
+  lua_State *S = c->src;
+  lua_newtable(L);
+  c->memo = lua_gettop(L);
+  lua_newtable(L);
+  c->upvals = lua_gettop(L);
+  // the modules both states loaded are the same, so they're merged
+  // rather than copied, e.g. string.foo added by .init.lua ends up
+  // in the string table used by the string metatable
+  lua_rawgeti(S, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+  lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+  LuaCloneRemember(L, c, (g = lua_topointer(S, -1)));
+  lua_getfield(S, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+  lua_getfield(L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+  LuaCloneRemember(L, c, (m = lua_topointer(S, -1)));
+  for (pass = 0; pass < 2; ++pass) {
+    lua_pushnil(S);
+    while (lua_next(S, -2)) {
+      if (lua_istable(S, -1) && lua_type(S, -2) == LUA_TSTRING &&
+          lua_topointer(S, -1) != g && lua_topointer(S, -1) != m) {
+        if (lua_getfield(L, -1, lua_tostring(S, -2)) == LUA_TTABLE) {
+          if (!pass) {
+            LuaCloneRemember(L, c, lua_topointer(S, -1));
+          } else {
+            LuaCloneTable(L, c, -1, 0);
+          }
+        }
+        lua_pop(L, 1);
+      }
+      lua_pop(S, 1);
+    }
+  }
+  LuaCloneTable(L, c, -1, 0);
+  lua_pop(L, 1);
+  lua_pop(S, 1);
+  LuaCloneTable(L, c, -1, 0);
+  lua_pop(L, 1);
+  lua_pop(S, 1);
+  LuaCloneRegistry(L, c, &ctIdx);
+  return 0;
+}
+
+// creates lua state for thread worker from the state .init.lua made
+static lua_State *LuaClone(lua_State *S) {
+  int top;
+  lua_State *L;
+  struct LuaCloner c = {S};
+  L = LuaNewState();
+  top = lua_gettop(S);
+  lua_pushcfunction(L, LuaCloneImpl);
+  lua_pushlightuserdata(L, &c);
+  if (lua_pcall(L, 1, 0, 0) != LUA_OK) {
+    WARNF("(lua) failed to clone lua state: %s", lua_tostring(L, -1));
+    lua_pop(L, 1);
+  }
+  lua_settop(S, top);
+  if (c.skipped) {
+    VERBOSEF("(lua) thread worker didn't inherit %d userdata or coroutines",
+             c.skipped);
+  }
+  return L;
 }
+#endif
 
 static bool ShouldAutocomplete(const char *s) {
   int c, m, l, r;
@@ -5593,6 +6981,7 @@ static void LuaDestroy(void) {
 
 static void MemDestroy(void) {
   FreeAssets();
+  FreeAssetFiles();
   CollectGarbage();
   inbuf.p = 0, inbuf.n = 0, inbuf.c = 0;
   Free(&inbuf_actual.p), inbuf_actual.n = inbuf_actual.c = 0;
@@ -5676,7 +7065,7 @@ static const char *DescribeClose(void) {
 
 static void LogClose(const char *reason) {
   if (amtread || meltdown || killed) {
-    LockInc(&shared->c.fumbles);
+    CountInc(fumbles);
     INFOF("(stat) %s %s with %,ld unprocessed and %,d handled (%,d workers)",
           DescribeClient(), reason, amtread, messageshandled, shared->workers);
   } else {
@@ -5743,76 +7132,76 @@ static void EnterMeltdownMode(void) {
   WARNF("(srvr) server is melting down (%,d workers)", shared->workers);
   LOGIFNEG1(kill(0, SIGUSR2));
   shared->lastmeltdown = timespec_real();
-  ++shared->c.meltdowns;
+  CountInc(meltdowns);
 }
 
 static char *HandlePayloadDisconnect(void) {
-  LockInc(&shared->c.payloaddisconnects);
+  CountInc(payloaddisconnects);
   LogClose("payload disconnect");
   return ServeFailure(400, "Bad Request"); /* XXX */
 }
 
 static char *HandlePayloadDrop(void) {
-  LockInc(&shared->c.dropped);
+  CountInc(dropped);
   LogClose(DescribeClose());
   return ServeFailure(503, "Service Unavailable");
 }
 
 static char *HandleBadContentLength(void) {
-  LockInc(&shared->c.badlengths);
+  CountInc(badlengths);
   return ServeFailure(400, "Bad Content Length");
 }
 
 static char *HandleLengthRequired(void) {
-  LockInc(&shared->c.missinglengths);
+  CountInc(missinglengths);
   return ServeFailure(411, "Length Required");
 }
 
 static char *HandleVersionNotSupported(void) {
-  LockInc(&shared->c.http12);
+  CountInc(http12);
   return ServeFailure(505, "HTTP Version Not Supported");
 }
 
 static char *HandleConnectRefused(void) {
-  LockInc(&shared->c.connectsrefused);
+  CountInc(connectsrefused);
   return ServeFailure(501, "Not Implemented");
 }
 
 static char *HandleExpectFailed(void) {
-  LockInc(&shared->c.expectsrefused);
+  CountInc(expectsrefused);
   return ServeFailure(417, "Expectation Failed");
 }
 
 static char *HandleHugePayload(void) {
-  LockInc(&shared->c.hugepayloads);
+  CountInc(hugepayloads);
   return ServeFailure(413, "Payload Too Large");
 }
 
 static char *HandleTransferRefused(void) {
-  LockInc(&shared->c.transfersrefused);
+  CountInc(transfersrefused);
   return ServeFailure(501, "Not Implemented");
 }
 
 static char *HandleMapFailed(struct Asset *a, int fd) {
-  LockInc(&shared->c.mapfails);
+  CountInc(mapfails);
   WARNF("(srvr) mmap(%`'s) error: %m", a->file->path);
   close(fd);
   return ServeError(500, "Internal Server Error");
 }
 
 static void LogAcceptError(const char *s) {
-  LockInc(&shared->c.accepterrors);
+  CountInc(accepterrors);
   WARNF("(srvr) %s accept error: %s", DescribeServer(), s);
 }
 
 static char *HandleOpenFail(struct Asset *a) {
-  LockInc(&shared->c.openfails);
+  CountInc(openfails);
   WARNF("(srvr) open(%`'s) error: %m", a->file->path);
   if (errno == ENFILE) {
-    LockInc(&shared->c.enfiles);
+    CountInc(enfiles);
     return ServeError(503, "Service Unavailable");
   } else if (errno == EMFILE) {
-    LockInc(&shared->c.emfiles);
+    CountInc(emfiles);
     return ServeError(503, "Service Unavailable");
   } else {
     return ServeError(500, "Internal Server Error");
@@ -5821,23 +7210,23 @@ static char *HandleOpenFail(struct Asset *a) {
 
 static char *HandlePayloadReadError(void) {
   if (errno == ECONNRESET) {
-    LockInc(&shared->c.readresets);
+    CountInc(readresets);
     LogClose("payload reset");
     return ServeFailure(400, "Bad Request"); /* XXX */
   } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
-    LockInc(&shared->c.readtimeouts);
+    CountInc(readtimeouts);
     LogClose("payload read timeout");
     return ServeFailure(408, "Request Timeout");
   } else {
-    LockInc(&shared->c.readerrors);
+    CountInc(readerrors);
     INFOF("(clnt) %s payload read error: %m", DescribeClient());
     return ServeFailure(500, "Internal Server Error");
   }
 }
 
 static void HandleForkFailure(void) {
-  LockInc(&shared->c.forkerrors);
-  LockInc(&shared->c.dropped);
+  CountInc(forkerrors);
+  CountInc(dropped);
   EnterMeltdownMode();
   SendServiceUnavailable();
   close(client);
@@ -5845,21 +7234,39 @@ static void HandleForkFailure(void) {
 }
 
 static void HandleFrag(size_t got) {
-  LockInc(&shared->c.frags);
+  CountInc(frags);
   DEBUGF("(stat) %s fragged msg added %,ld bytes to %,ld byte buffer",
          DescribeClient(), amtread, got);
 }
 
 static void HandleReload(void) {
-  LockInc(&shared->c.reloads);
+  int i;
+  CountInc(reloads);
+  // prefork workers keep running, so they must reload on their own
+  if (preforkpids && !__isworker) {
+    for (i = 0; i < preforks; ++i) {
+      if (preforkpids[i]) {
+        LOGIFNEG1(kill(preforkpids[i], SIGUSR1));
+      }
+    }
+  }
+  FreeAssetFiles();
   LuaOnServerReload(Reindex());
   invalidated = false;
+  if (threads)
+    atomic_fetch_add(&luageneration, 1);
 }
 
 static void HandleHeartbeat(void) {
   size_t i;
   UpdateCurrentDate(timespec_real());
-  Reindex();
+  if (HasZipChanged()) {
+    LockThreadWorkers();
+    Reindex();
+    UnlockThreadWorkers();
+  }
+  RevalidateAssetFiles();
+  AdoptAssetFileHints();
   getrusage(RUSAGE_SELF, &shared->server);
 #ifndef STATIC
   CallSimpleHookIfDefined("OnServerHeartbeat");
@@ -5883,19 +7290,29 @@ static char *OpenAsset(struct Asset *a) {
     if (cpm.msg.method == kHttpHead) {
       cpm.content = 0;
       cpm.contentlength = size;
+    } else if (a->file->map) {
+      SendfileLater(a->file->fd, 0, a->file->map, size);
+      cpm.content = a->file->map;
+      cpm.contentlength = size;
     } else {
     OpenAgain:
       if ((fd = open(a->file->path.s, O_RDONLY)) != -1) {
         data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
         if (data != MAP_FAILED) {
-          LockInc(&shared->c.maps);
-          UnmapLater(fd, data, size);
+          CountInc(maps);
+          if (a->file->cached) {
+            a->file->fd = fd;
+            a->file->map = data;
+          } else {
+            UnmapLater(fd, data, size);
+          }
+          SendfileLater(fd, 0, data, size);
           cpm.content = data;
           cpm.contentlength = size;
         } else if ((st = gc(malloc(sizeof(struct stat)))) &&
                    fstat(fd, st) != -1 && (data = malloc(st->st_size))) {
           /* probably empty file or zipos handle */
-          LockInc(&shared->c.slurps);
+          CountInc(slurps);
           FreeLater(data);
           if (ReadAll(fd, data, st->st_size) != -1) {
             cpm.content = data;
@@ -5923,7 +7340,7 @@ static char *OpenAsset(struct Asset *a) {
 
 static char *ServeServerOptions(void) {
   char *p;
-  LockInc(&shared->c.serveroptions);
+  CountInc(serveroptions);
   p = SetStatus(200, "OK");
 #ifdef STATIC
   p = stpcpy(p, "Allow: GET, HEAD, OPTIONS\r\n");
@@ -5937,7 +7354,7 @@ static char *ServeServerOptions(void) {
 
 static void SendContinueIfNeeded(void) {
   if (cpm.msg.version >= 11 && HeaderEqualCase(kHttpExpect, "100-continue")) {
-    LockInc(&shared->c.continues);
+    CountInc(continues);
     SendContinue();
   }
 }
@@ -5945,13 +7362,13 @@ static void SendContinueIfNeeded(void) {
 static char *ReadMore(void) {
   size_t got;
   ssize_t rc;
-  LockInc(&shared->c.frags);
+  CountInc(frags);
   if ((rc = reader(client, inbuf.p + amtread, inbuf.n - amtread)) != -1) {
     if (!(got = rc))
       return HandlePayloadDisconnect();
     amtread += got;
   } else if (errno == EINTR) {
-    LockInc(&shared->c.readinterrupts);
+    CountInc(readinterrupts);
     if (killed || ((meltdown || terminated) &&
                    timespec_cmp(timespec_sub(timespec_real(), startread),
                                 (struct timespec){1}) >= 0)) {
@@ -6072,11 +7489,11 @@ static bool HasAtMostThisElement(int h, const char *s) {
 static char *HandleRequest(void) {
   char *p;
   if (cpm.msg.version == 11) {
-    LockInc(&shared->c.http11);
+    CountInc(http11);
   } else if (cpm.msg.version < 10) {
-    LockInc(&shared->c.http09);
+    CountInc(http09);
   } else if (cpm.msg.version == 10) {
-    LockInc(&shared->c.http10);
+    CountInc(http10);
   } else {
     return HandleVersionNotSupported();
   }
@@ -6104,7 +7521,7 @@ static char *HandleRequest(void) {
       !IsAcceptableHost(url.host.p, url.host.n) ||
       !IsAcceptablePort(url.port.p, url.port.n)) {
     free(url.params.p);
-    LockInc(&shared->c.urisrefused);
+    CountInc(urisrefused);
     return ServeFailure(400, "Bad URI");
   }
   char method[9] = {0};
@@ -6120,6 +7537,8 @@ static char *HandleRequest(void) {
   }
   FreeLater(url.params.p);
 #ifndef STATIC
+  if ((p = ServeCachedPage()))
+    return p;
   if (hasonhttprequest)
     return LuaOnHttpRequest();
 #endif
@@ -6145,7 +7564,7 @@ static char *Route(const char *host, size_t hostlen, const char *path,
   } else if (SlicesEqual(path, pathlen, "/statusz", 8)) {
     return ServeStatusz();
   } else {
-    LockInc(&shared->c.notfounds);
+    CountInc(notfounds);
     return ServeErrorWithPath(404, "Not Found", path, pathlen);
   }
 }
@@ -6166,7 +7585,7 @@ static char *RoutePath(const char *path, size_t pathlen) {
         return HandleFolder(path, pathlen);
       }
     } else {
-      LockInc(&shared->c.forbiddens);
+      CountInc(forbiddens);
       WARNF("(srvr) asset %`'.*s %#o isn't readable", pathlen, path, m);
       return ServeErrorWithPath(403, "Forbidden", path, pathlen);
     }
@@ -6227,7 +7646,7 @@ static char *HandleAsset(struct Asset *a, const char *path, size_t pathlen) {
     return ServeLua(a, path, pathlen);
 #endif
   if (cpm.msg.method == kHttpGet || cpm.msg.method == kHttpHead) {
-    LockInc(&shared->c.staticrequests);
+    CountInc(staticrequests);
     p = ServeAsset(a, path, pathlen);
     if (!cpm.gotxcontenttypeoptions) {
       p = stpcpy(p, "X-Content-Type-Options: nosniff\r\n");
@@ -6240,7 +7659,8 @@ static char *HandleAsset(struct Asset *a, const char *path, size_t pathlen) {
 
 static const char *GetContentType(struct Asset *a, const char *path, size_t n) {
   const char *r;
-  if (a->file && (r = GetContentTypeExt(a->file->path.s, a->file->path.n))) {
+  if (a->file && ((r = a->file->ct) ||
+                  (r = GetContentTypeExt(a->file->path.s, a->file->path.n)))) {
     return r;
   }
   return firstnonnull(
@@ -6265,33 +7685,27 @@ static char *ServeAsset(struct Asset *a, const char *path, size_t pathlen) {
   const char *ct;
   ct = GetContentType(a, path, pathlen);
   if (IsNotModified(a)) {
-    LockInc(&shared->c.notmodifieds);
+    CountInc(notmodifieds);
     p = SetStatus(304, "Not Modified");
   } else {
     if (!a->file) {
       cpm.content = (char *)ZIP_LFILE_CONTENT(zmap + a->lf);
       cpm.contentlength = GetZipCfileCompressedSize(zmap + a->cf);
+      SendfileLater(zfd, (uint8_t *)cpm.content - zmap, cpm.content,
+                    cpm.contentlength);
     } else if ((p = OpenAsset(a))) {
       return p;
     }
     if (IsCompressed(a)) {
-      if (ClientAcceptsGzip()) {
+      if (IsZstd(a) ? ClientAcceptsZstd() : ClientAcceptsGzip()) {
         p = ServeAssetPrecompressed(a);
       } else {
         p = ServeAssetDecompressed(a);
       }
     } else if (cpm.msg.version >= 11 && HasHeader(kHttpRange)) {
       p = ServeAssetRange(a);
-    } else if (!a->file) {
-      LockInc(&shared->c.identityresponses);
-      DEBUGF("(zip) ServeAssetZipIdentity(%`'s)", ct);
-      if (Verify(cpm.content, cpm.contentlength,
-                 ZIP_LFILE_CRC32(zmap + a->lf))) {
-        p = SetStatus(200, "OK");
-      } else {
-        return ServeError(500, "Internal Server Error");
-      }
     } else if (!IsTiny() && cpm.msg.method != kHttpHead && !IsSslCompressed() &&
+               (a->file || CanCacheGzip()) &&  // stored zip assets need cache
                ClientAcceptsGzip() && !ShouldAvoidGzip() &&
                !(a->file &&
                  IsNoCompressExt(a->file->path.s, a->file->path.n)) &&
@@ -6300,6 +7714,15 @@ static char *ServeAsset(struct Asset *a, const char *path, size_t pathlen) {
                  MeasureEntropy(cpm.content, 1000) < 7))) {
       VERBOSEF("serving compressed asset");
       p = ServeAssetCompressed(a);
+    } else if (!a->file) {
+      CountInc(identityresponses);
+      DEBUGF("(zip) ServeAssetZipIdentity(%`'s)", ct);
+      if (Verify(cpm.content, cpm.contentlength,
+                 ZIP_LFILE_CRC32(zmap + a->lf))) {
+        p = SetStatus(200, "OK");
+      } else {
+        return ServeError(500, "Internal Server Error");
+      }
     } else {
       p = ServeAssetIdentity(a, ct);
     }
@@ -6351,9 +7774,11 @@ static inline bool MustNotIncludeMessageBody(void) { /* RFC2616 § 4.4 */
 }
 
 static bool TransmitResponse(char *p) {
-  int iovlen;
+  ssize_t n;
+  int i, j, iovlen;
   struct iovec iov[4];
   long actualcontentlength;
+  i = -1;
   if (cpm.msg.version >= 10) {
     actualcontentlength = cpm.contentlength;
     if (cpm.gzipped) {
@@ -6377,7 +7802,7 @@ static bool TransmitResponse(char *p) {
       }
       iov[iovlen].iov_base = cpm.content;
       iov[iovlen].iov_len = cpm.contentlength;
-      ++iovlen;
+      i = iovlen++;
       if (cpm.gzipped) {
         iov[iovlen].iov_base = gzip_footer;
         iov[iovlen].iov_len = sizeof(gzip_footer);
@@ -6388,13 +7813,48 @@ static bool TransmitResponse(char *p) {
     iov[0].iov_base = cpm.content;
     iov[0].iov_len = cpm.contentlength;
     iovlen = 1;
+    i = 0;
+  }
+  if (i != -1 && CanSendfile()) {
+    // send headers, then file content, then gzip footer (if any)
+    for (n = j = 0; j < i; ++j)
+      n += iov[j].iov_len;
+    CorkClient(true);
+    if ((!i || Send(iov, i) == n) &&
+        SendContent(iov + i) == cpm.contentlength && i + 1 < iovlen) {
+      Send(iov + i + 1, iovlen - (i + 1));
+    }
+    CorkClient(false);
+  } else {
+    Send(iov, iovlen);
   }
-  Send(iov, iovlen);
-  LockInc(&shared->c.messageshandled);
+  CountInc(messageshandled);
   ++messageshandled;
   return true;
 }
 
+// lets a thread worker send its response to a slow client without
+// keeping the main thread from reloading assets in the meantime
+static void ReleaseReloadLock(void) {
+  if (holdingreloadlock) {
+    if ((pinnedzip = zipmapping))
+      atomic_fetch_add(&pinnedzip->refs, 1);
+    holdingreloadlock = false;
+    pthread_rwlock_unlock(&reloadlock);
+  }
+}
+
+// generators may run lua code, so thread workers lock while they do
+static ssize_t CallGenerator(struct iovec v[3]) {
+  ssize_t rc;
+  if (isthreadworker)
+    pthread_rwlock_rdlock(&reloadlock);
+  rc = cpm.generator(v);
+  if (isthreadworker)
+    pthread_rwlock_unlock(&reloadlock);
+  return rc;
+}
+
 static bool StreamResponse(char *p) {
   int rc;
   struct iovec iov[6];
@@ -6426,7 +7886,7 @@ static bool StreamResponse(char *p) {
     iov[3].iov_len = 0;
     iov[4].iov_base = 0;
     iov[4].iov_len = 0;
-    if ((rc = cpm.generator(iov + 2)) <= 0)
+    if ((rc = CallGenerator(iov + 2)) <= 0)
       break;
     if (cpm.msg.version >= 11) {
       s = chunkbuf;
@@ -6452,6 +7912,13 @@ static bool StreamResponse(char *p) {
   return true;
 }
 
+// a prefork worker serves one connection at a time, and on linux only
+// it will accept() the clients which the kernel queued on its listener
+static bool IsPreforkBacklogged(void) {
+  return preforks && __isworker && IsLinux() &&
+         poll(polls + 1, servers.n, 0) > 0;
+}
+
 static bool HandleMessageActual(void) {
   int rc;
   long reqtime, contime;
@@ -6466,7 +7933,7 @@ static bool HandleMessageActual(void) {
     }
     p = HandleRequest();
   } else {
-    LockInc(&shared->c.badmessages);
+    CountInc(badmessages);
     connectionclose = true;
     if ((p = DumpHexc(inbuf.p, MIN(amtread, 256), 0))) {
       INFOF("(clnt) %s sent garbage %s", DescribeClient(), p);
@@ -6476,9 +7943,12 @@ static bool HandleMessageActual(void) {
   if (!cpm.msgsize) {
     amtread = 0;
     connectionclose = true;
-    LockInc(&shared->c.synchronizationfailures);
+    CountInc(synchronizationfailures);
     DEBUGF("(clnt) could not synchronize message stream");
   }
+  if (!connectionclose && IsPreforkBacklogged()) {
+    connectionclose = true;  // don't make queued clients wait on keep-alive
+  }
   if (cpm.msg.version >= 10) {
     p = AppendCrlf(stpcpy(stpcpy(p, "Date: "), shared->currentdate));
     if (!cpm.branded)
@@ -6512,6 +7982,7 @@ static bool HandleMessageActual(void) {
            cpm.msg.uri.b - cpm.msg.uri.a, inbuf.p + cpm.msg.uri.a, reqtime,
            contime);
   }
+  ReleaseReloadLock();
   if (!cpm.generator) {
     return TransmitResponse(p);
   } else {
@@ -6521,9 +7992,20 @@ static bool HandleMessageActual(void) {
 
 static bool HandleMessage(void) {
   bool r;
+  if (isthreadworker) {
+    pthread_rwlock_rdlock(&reloadlock);
+    holdingreloadlock = true;
+  }
   ishandlingrequest = true;
   r = HandleMessageActual();
+  ReleaseReloadLock();
+  if (cpm.cacheclaim)
+    UnclaimPageCache();
   ishandlingrequest = false;
+  if (pinnedzip) {
+    DropZipMapping(pinnedzip);
+    pinnedzip = 0;
+  }
   return r;
 }
 
@@ -6542,7 +8024,8 @@ static bool IsSsl(unsigned char c) {
   return true;
 }
 
-static void HandleMessages(void) {
+// returns true if thread worker should poll connection for next message
+static bool HandleMessages(void) {
   bool once;
   ssize_t rc;
   size_t got;
@@ -6569,11 +8052,11 @@ static void HandleMessages(void) {
                 if (TlsSetup()) {
                   continue;
                 } else {
-                  return;
+                  return false;
                 }
               } else if (requiressl) {
                 INFOF("(clnt) %s didn't send an ssl hello", DescribeClient());
-                return;
+                return false;
               } else {
                 WipeServingKeys();
               }
@@ -6590,44 +8073,44 @@ static void HandleMessages(void) {
         if (!got) {
           NotifyClose();
           LogClose("disconnect");
-          return;
+          return false;
         }
       } else if (errno == EINTR) {
-        LockInc(&shared->c.readinterrupts);
+        CountInc(readinterrupts);
         errno = 0;
       } else if (errno == EAGAIN) {
-        LockInc(&shared->c.readtimeouts);
+        CountInc(readtimeouts);
         if (amtread)
           SendTimeout();
         NotifyClose();
         LogClose("read timeout");
-        return;
+        return false;
       } else if (errno == ECONNRESET) {
-        LockInc(&shared->c.readresets);
+        CountInc(readresets);
         LogClose("read reset");
-        return;
+        return false;
       } else {
-        LockInc(&shared->c.readerrors);
+        CountInc(readerrors);
         if (errno == EBADF) {  // don't warn on close/bad fd
           LogClose("read badf");
         } else {
           WARNF("(clnt) %s read error: %m", DescribeClient());
         }
-        return;
+        return false;
       }
       if (killed || (terminated && !amtread) ||
           (meltdown &&
            (!amtread || timespec_cmp(timespec_sub(timespec_real(), startread),
                                      (struct timespec){1}) >= 0))) {
         if (amtread) {
-          LockInc(&shared->c.dropped);
+          CountInc(dropped);
           SendServiceUnavailable();
         }
         NotifyClose();
         LogClose(DescribeClose());
-        return;
+        return false;
       }
-      if (invalidated) {
+      if (invalidated && !isthreadworker) {
         HandleReload();
       }
     }
@@ -6635,29 +8118,32 @@ static void HandleMessages(void) {
       amtread = 0;
       if (killed) {
         LogClose(DescribeClose());
-        return;
+        return false;
       } else if (connectionclose || terminated || meltdown) {
         NotifyClose();
         LogClose(DescribeClose());
-        return;
+        return false;
       }
     } else {
       CHECK_LT(cpm.msgsize, amtread);
-      LockInc(&shared->c.pipelinedrequests);
+      CountInc(pipelinedrequests);
       DEBUGF("(stat) %,ld pipelinedrequest bytes", amtread - cpm.msgsize);
       memmove(inbuf.p, inbuf.p + cpm.msgsize, amtread - cpm.msgsize);
       amtread -= cpm.msgsize;
       if (killed) {
         LogClose(DescribeClose());
-        return;
+        return false;
       } else if (connectionclose) {
         NotifyClose();
         LogClose(DescribeClose());
-        return;
+        return false;
       }
     }
     CollectGarbage();
-    if (invalidated) {
+    if (isthreadworker) {
+      if (!amtread)
+        return true;
+    } else if (invalidated) {
       HandleReload();
     }
   }
@@ -6707,13 +8193,49 @@ static int EnableSandbox(void) {
   }
 }
 
+// hands connection to the poll loop of thread worker until it's readable
+static void ParkConnection(void) {
+  struct Connection *c;
+  struct pollfd *p;
+  if (++parked.n > parked.c) {
+    parked.c = parked.n + (parked.n >> 1);
+    parked.p = xrealloc(parked.p, parked.c * sizeof(*parked.p));
+    polls = xrealloc(polls, (1 + servers.n + parked.c) * sizeof(*polls));
+  }
+  c = parked.p + parked.n - 1;
+  c->fd = client;
+  c->messages = messageshandled;
+  c->addrsize = clientaddrsize;
+  c->addr = clientaddr;
+  c->server = serveraddr;
+  c->start = startconnection;
+  c->idle = timespec_real();
+  p = polls + servers.n + parked.n;
+  p->fd = client;
+  p->events = POLLIN;
+  p->revents = 0;
+}
+
+// makes parked connection the one being served by this thread worker
+static void UnparkConnection(size_t i) {
+  struct Connection *c = parked.p + i;
+  client = c->fd;
+  messageshandled = c->messages;
+  clientaddrsize = c->addrsize;
+  clientaddr = c->addr;
+  serveraddr = c->server;
+  startconnection = c->start;
+  parked.p[i] = parked.p[--parked.n];
+  polls[1 + servers.n + i] = polls[1 + servers.n + parked.n];
+}
+
 static int HandleConnection(size_t i) {
   uint32_t ip;
   int pid, tok, rc = 0;
   clientaddrsize = sizeof(clientaddr);
   if ((client = accept4(servers.p[i].fd, (struct sockaddr *)&clientaddr,
                         &clientaddrsize, SOCK_CLOEXEC)) != -1) {
-    LockInc(&shared->c.accepts);
+    CountInc(accepts);
     GetClientAddr(&ip, 0);
     if (tokenbucket.cidr && tokenbucket.reject >= 0) {
       if (!IsTrustedIp(ip)) {
@@ -6721,20 +8243,20 @@ static int HandleConnection(size_t i) {
         if (tok <= tokenbucket.ban && tokenbucket.ban >= 0) {
           WARNF("(token) banning %hhu.%hhu.%hhu.%hhu who only has %d tokens",
                 ip >> 24, ip >> 16, ip >> 8, ip, tok);
-          LockInc(&shared->c.bans);
+          CountInc(bans);
           Blackhole(ip);
           close(client);
           return 0;
         } else if (tok <= tokenbucket.ignore && tokenbucket.ignore >= 0) {
           DEBUGF("(token) ignoring %hhu.%hhu.%hhu.%hhu who only has %d tokens",
                  ip >> 24, ip >> 16, ip >> 8, ip, tok);
-          LockInc(&shared->c.ignores);
+          CountInc(ignores);
           close(client);
           return 0;
         } else if (tok < tokenbucket.reject) {
           WARNF("(token) rejecting %hhu.%hhu.%hhu.%hhu who only has %d tokens",
                 ip >> 24, ip >> 16, ip >> 8, ip, tok);
-          LockInc(&shared->c.rejects);
+          CountInc(rejects);
           SendTooManyRequests();
           close(client);
           return 0;
@@ -6750,7 +8272,8 @@ static int HandleConnection(size_t i) {
       DEBUGF("(token) can't acquire accept() token for client");
     }
     startconnection = timespec_real();
-    if (UNLIKELY(maxworkers) && shared->workers >= maxworkers) {
+    if (UNLIKELY(maxworkers) && !preforks && !threads &&
+        shared->workers >= maxworkers) {
       EnterMeltdownMode();
       SendServiceUnavailable();
       close(client);
@@ -6765,6 +8288,17 @@ static int HandleConnection(size_t i) {
     if (uniprocess) {
       pid = -1;
       connectionclose = true;
+    } else if (isthreadworker) {
+      // the socket inherits O_NONBLOCK from the listener on bsd
+      if (!IsLinux())
+        fcntl(client, F_SETFL, 0);
+      ParkConnection();  // the first message is read when it arrives
+      return 0;
+    } else if (preforks) {
+      pid = -1;  // we're a prefork worker
+      meltdown = false;
+      connectionclose = false;
+      ++servedconnections;
     } else {
       switch ((pid = fork())) {
         case 0:
@@ -6827,40 +8361,40 @@ static int HandleConnection(size_t i) {
     CollectGarbage();
   } else {
     if (errno == EINTR || errno == EAGAIN) {
-      LockInc(&shared->c.acceptinterrupts);
+      CountInc(acceptinterrupts);
     } else if (errno == ENFILE) {
-      LockInc(&shared->c.enfiles);
+      CountInc(enfiles);
       LogAcceptError("enfile: too many open files");
       meltdown = true;
     } else if (errno == EMFILE) {
-      LockInc(&shared->c.emfiles);
+      CountInc(emfiles);
       LogAcceptError("emfile: ran out of open file quota");
       meltdown = true;
     } else if (errno == ENOMEM) {
-      LockInc(&shared->c.enomems);
+      CountInc(enomems);
       LogAcceptError("enomem: ran out of memory");
       meltdown = true;
     } else if (errno == ENOBUFS) {
-      LockInc(&shared->c.enobufs);
+      CountInc(enobufs);
       LogAcceptError("enobuf: ran out of buffer");
       meltdown = true;
     } else if (errno == ENONET) {
-      LockInc(&shared->c.enonets);
+      CountInc(enonets);
       LogAcceptError("enonet: network gone");
       polls[i].fd = -polls[i].fd;
     } else if (errno == ENETDOWN) {
-      LockInc(&shared->c.enetdowns);
+      CountInc(enetdowns);
       LogAcceptError("enetdown: network down");
       polls[i].fd = -polls[i].fd;
     } else if (errno == ECONNABORTED) {
-      LockInc(&shared->c.accepterrors);
-      LockInc(&shared->c.acceptresets);
+      CountInc(accepterrors);
+      CountInc(acceptresets);
       WARNF("(srvr) %s accept error: %s", DescribeServer(),
             "acceptreset: connection reset before accept");
     } else if (errno == ENETUNREACH || errno == EHOSTUNREACH ||
                errno == EOPNOTSUPP || errno == ENOPROTOOPT || errno == EPROTO) {
-      LockInc(&shared->c.accepterrors);
-      LockInc(&shared->c.acceptflakes);
+      CountInc(accepterrors);
+      CountInc(acceptflakes);
       WARNF("(srvr) accept error: %s ephemeral accept error: %m",
             DescribeServer());
     } else {
@@ -6942,11 +8476,13 @@ static int HandleReadline(void) {
 
 static int HandlePoll(int ms) {
   int rc, nfds;
-  size_t pollid, serverid;
-  if ((nfds = poll(polls, 1 + servers.n, ms)) != -1) {
+  size_t pollid, serverid, npolls;
+  // prefork or thread workers accept connections on behalf of main
+  npolls = (preforks && !__isworker) || threads ? 1 : 1 + servers.n;
+  if ((nfds = poll(polls, npolls, ms)) != -1) {
     if (nfds) {
       // handle pollid/o events
-      for (pollid = 0; pollid < 1 + servers.n; ++pollid) {
+      for (pollid = 0; pollid < npolls; ++pollid) {
         if (!polls[pollid].revents)
           continue;
         if (polls[pollid].fd < 0)
@@ -6982,9 +8518,9 @@ static int HandlePoll(int ms) {
     }
   } else {
     if (errno == EINTR || errno == EAGAIN) {
-      LockInc(&shared->c.pollinterrupts);
+      CountInc(pollinterrupts);
     } else if (errno == ENOMEM) {
-      LockInc(&shared->c.enomems);
+      CountInc(enomems);
       WARNF("(srvr) poll error: ran out of memory");
       meltdown = true;
     } else {
@@ -6995,6 +8531,27 @@ static int HandlePoll(int ms) {
   return 0;
 }
 
+// creates the listeners of every prefork worker up front, since workers
+// can't bind them after ChangeUser(), because the port is privileged or
+// the reuseport group is owned by another user. if a worker dies while
+// clients are queued on its listener, its replacement will serve them.
+static void ListenPrefork(struct Server *s) {
+  int i;
+  s->listeners = xcalloc(preforks, sizeof(*s->listeners));
+  for (i = 0; i < preforks; ++i) {
+    if ((s->listeners[i] = GoodSocket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC,
+                                      IPPROTO_TCP, true, &timeout)) == -1 ||
+        setsockopt(s->listeners[i], SOL_SOCKET, SO_REUSEPORT, &(int){1},
+                   sizeof(int)) ||
+        bind(s->listeners[i], (struct sockaddr *)&s->addr, sizeof(s->addr)) ||
+        listen(s->listeners[i], 10)) {
+      DIEF("(srvr) prefork listen error: %m");
+    }
+  }
+  if (!preforkpids)
+    preforkpids = xcalloc(preforks, sizeof(*preforkpids));
+}
+
 static void Listen(void) {
   char ipbuf[16];
   size_t i, j, n;
@@ -7021,8 +8578,11 @@ static void Listen(void) {
       servers.p[n].addr.sin_family = AF_INET;
       servers.p[n].addr.sin_port = htons(ports.p[j]);
       servers.p[n].addr.sin_addr.s_addr = htonl(ips.p[i]);
-      if ((servers.p[n].fd = GoodSocket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC,
-                                        IPPROTO_TCP, true, &timeout)) == -1) {
+      // thread workers race to accept() so none of them may block there
+      if ((servers.p[n].fd = GoodSocket(
+               AF_INET,
+               SOCK_STREAM | SOCK_CLOEXEC | (threads ? SOCK_NONBLOCK : 0),
+               IPPROTO_TCP, true, &timeout)) == -1) {
         DIEF("(srvr) socket: %m");
       }
       if (hasonserverlisten &&
@@ -7031,13 +8591,21 @@ static void Listen(void) {
         n--;  // skip this server instance
         continue;
       }
+      if (preforks && IsLinux() &&
+          setsockopt(servers.p[n].fd, SOL_SOCKET, SO_REUSEPORT, &(int){1},
+                     sizeof(int)) == -1) {
+        DIEF("(srvr) setsockopt(SO_REUSEPORT) error: %m");
+      }
 
       if (bind(servers.p[n].fd, (struct sockaddr *)&servers.p[n].addr,
                sizeof(servers.p[n].addr)) == -1) {
         DIEF("(srvr) bind error: %m: %hhu.%hhu.%hhu.%hhu:%hu", ips.p[i] >> 24,
              ips.p[i] >> 16, ips.p[i] >> 8, ips.p[i], ports.p[j]);
       }
-      if (listen(servers.p[n].fd, 10) == -1) {
+      // with SO_REUSEPORT each prefork worker listens on its own socket,
+      // and this one only reserves the address, which can't be listening
+      // or the kernel would queue connections to it that nobody takes
+      if (!(preforks && IsLinux()) && listen(servers.p[n].fd, 10) == -1) {
         DIEF("(srvr) listen error: %m");
       }
       addrsize = sizeof(servers.p[n].addr);
@@ -7045,6 +8613,9 @@ static void Listen(void) {
                       &addrsize) == -1) {
         DIEF("(srvr) getsockname error: %m");
       }
+      if (preforks && IsLinux()) {
+        ListenPrefork(servers.p + n);
+      }
       port = ntohs(servers.p[n].addr.sin_port);
       ip = ntohl(servers.p[n].addr.sin_addr.s_addr);
       if (ip == INADDR_ANY)
@@ -7072,7 +8643,307 @@ static void Listen(void) {
   }
 }
 
+// keeps the listener of the given worker slot and closes the others
+static void ListenPreforkWorker(int slot) {
+  int i;
+  size_t j;
+  if (!IsLinux())
+    return;  // accept from sockets inherited from the main process
+  for (j = 0; j < servers.n; ++j) {
+    close(servers.p[j].fd);
+    servers.p[j].fd = servers.p[j].listeners[slot];
+    polls[1 + j].fd = servers.p[j].fd;
+    for (i = 0; i < preforks; ++i) {
+      if (i != slot) {
+        close(servers.p[j].listeners[i]);
+      }
+    }
+  }
+}
+
+static bool IsPreforkWorkerSpent(long rss) {
+  struct rusage ru;
+  if (servedconnections >= preforkconnections) {
+    DEBUGF("(srvr) recycling worker after %,ld connections", servedconnections);
+    return true;
+  }
+  if (!getrusage(RUSAGE_SELF, &ru) &&
+      (ru.ru_maxrss - rss) * 1024 > preforkmemory) {
+    DEBUGF("(srvr) recycling worker after rss grew %,ldkb", ru.ru_maxrss - rss);
+    return true;
+  }
+  return false;
+}
+
+// serves connections until recycled or told to terminate
+static int PreforkWorker(void) {
+  long rss;
+  struct timespec t;
+  struct rusage ru;
+  rss = !getrusage(RUSAGE_SELF, &ru) ? ru.ru_maxrss : 0;
+  while (!terminated) {
+    errno = 0;
+    if (invalidated) {
+      HandleReload();
+    } else if (timespec_cmp(timespec_sub((t = timespec_real()), lastheartbeat),
+                            heartbeatinterval) >= 0) {
+      lastheartbeat = t;
+      Reindex();
+      RevalidateAssetFiles();
+    } else if (HandlePoll(timespec_tomillis(heartbeatinterval)) == -1) {
+      return -1;
+    } else if (IsPreforkWorkerSpent(rss)) {
+      CountInc(recycles);
+      break;
+    }
+  }
+  if (hasonworkerstop) {
+    CallSimpleHook("OnWorkerStop");
+  }
+  return ExitWorker();
+}
+
+static bool NeedsPreforkWorker(void) {
+  return preforks && !__isworker && shared->workers < preforks &&
+         timespec_cmp(timespec_sub(timespec_real(), lastpreforkfail),
+                      (struct timespec){1}) >= 0;
+}
+
+static int SpawnPreforkWorker(void) {
+  int pid, slot = 0;
+  if (preforkpids) {
+    while (preforkpids[slot]) {
+      if (++slot == preforks) {
+        return 0;  // an exited worker hasn't been reaped yet
+      }
+    }
+  }
+  switch ((pid = fork())) {
+    case 0:
+      __isworker = true;
+      polls[0].fd = -1;
+      if (!IsTiny() && systrace) {
+        kStartTsc = rdtsc();
+      }
+      TRACE_BEGIN;
+      ListenPreforkWorker(slot);
+      if (sandboxed) {
+        CHECK_NE(-1, EnableSandbox());
+      }
+      if (hasonworkerstart) {
+        CallSimpleHook("OnWorkerStart");
+      }
+      return PreforkWorker();
+    case -1:
+      CountInc(forkerrors);
+      WARNF("(srvr) can't fork prefork worker: %m");
+      lastpreforkfail = timespec_real();
+      return 0;
+    default:
+      LockInc(&shared->workers);
+      if (preforkpids) {
+        preforkpids[slot] = pid;
+      }
+      ReseedRng(&rng, "parent");
+      if (hasonprocesscreate) {
+        LuaOnProcessCreate(pid);
+      }
+      return 0;
+  }
+}
+
+// wakes up every second while a crashed prefork worker awaits respawn
+static int GetPollTimeout(int ms) {
+  if (preforks && shared->workers < preforks && (ms < 0 || ms > 1000))
+    return 1000;
+  return ms;
+}
+
+// serves message that arrived on parked connection, then parks it again
+static void ResumeConnection(size_t i) {
+  UnparkConnection(i);
+  connectionclose = false;
+  ishandlingconnection = true;
+  if (HandleMessages()) {
+    ParkConnection();
+  } else {
+    DEBUGF("(stat) %s closing after %,ldµs", DescribeClient(),
+           timespec_tomicros(timespec_sub(timespec_real(), startconnection)));
+    close(client);
+  }
+  ishandlingconnection = false;
+  CollectGarbage();
+}
+
+static void CloseConnection(size_t i, const char *reason) {
+  UnparkConnection(i);
+  LogClose(reason);
+  close(client);
+}
+
+// parked connections are held for the read timeout, unless -t asked
+// for tcp keepalive instead, which has the kernel find dead clients
+static bool IsConnectionExpired(struct Connection *c, struct timespec now) {
+  return timeout.tv_sec >= 0 && (timeout.tv_sec || timeout.tv_usec) &&
+         timespec_cmp(timespec_sub(now, c->idle),
+                      timeval_totimespec(timeout)) >= 0;
+}
+
+static void HandleThreadWorkerPoll(void) {
+  size_t i;
+  struct timespec now;
+  // wakes up every second to notice termination and expire connections
+  if (poll(polls + 1, servers.n + parked.n, 1000) != -1) {
+    for (i = 0; i < servers.n; ++i) {
+      if (polls[1 + i].revents && polls[1 + i].fd > 0) {
+        serveraddr = &servers.p[i].addr;
+        ishandlingconnection = true;
+        HandleConnection(i);
+        ishandlingconnection = false;
+      }
+    }
+    now = timespec_real();
+    for (i = parked.n; i--;) {
+      if (polls[1 + servers.n + i].revents) {
+        ResumeConnection(i);
+      } else if (IsConnectionExpired(parked.p + i, now)) {
+        CountInc(readtimeouts);
+        CloseConnection(i, "read timeout");
+      }
+    }
+  } else {
+    if (errno == EINTR || errno == EAGAIN) {
+      CountInc(pollinterrupts);
+    } else if (errno == ENOMEM) {
+      CountInc(enomems);
+      WARNF("(srvr) poll error: ran out of memory");
+    } else {
+      DIEF("(srvr) poll error: %m");
+    }
+    errno = 0;
+  }
+}
+
+// gives thread worker a copy of the lua state made by .init.lua, which
+// is made again whenever the main thread reloads its own state
+static void CloneThreadWorkerLua(lua_State *L) {
+#ifndef STATIC
+  if (GL) {
+    if (hasonworkerstop) {
+      CallSimpleHook("OnWorkerStop");
+    }
+    lua_close(GL);
+    YL = 0;
+  }
+  pthread_rwlock_rdlock(&reloadlock);
+  lua_repl_lock();
+  GL = LuaClone(L);
+  lua_repl_unlock();
+  pthread_rwlock_unlock(&reloadlock);
+  if (hasonworkerstart) {
+    CallSimpleHook("OnWorkerStart");
+  }
+#endif
+}
+
+// revalidates -D assets this thread cached, as heartbeat does for main
+static void HandleThreadWorkerHeartbeat(void) {
+  pthread_rwlock_rdlock(&reloadlock);
+  RevalidateAssetFiles();
+  pthread_rwlock_unlock(&reloadlock);
+}
+
+static void *ThreadWorker(void *arg) {
+  size_t i;
+  struct timespec t, last;
+  int generation = -1;
+  isthreadworker = true;
+  reader = read;
+  writer = WritevAll;
+  hdrbuf.n = 4 * 1024;
+  hdrbuf.p = xmalloc(hdrbuf.n);
+  inbuf_actual.n = maxpayloadsize;
+  inbuf_actual.p = xmalloc(inbuf_actual.n);
+  inbuf = inbuf_actual;
+  polls = xmalloc((1 + servers.n) * sizeof(*polls));
+  polls[0].fd = -1;
+  for (i = 0; i < servers.n; ++i) {
+    polls[1 + i].fd = servers.p[i].fd;
+    polls[1 + i].events = POLLIN;
+    polls[1 + i].revents = 0;
+  }
+  LockInc(&shared->workers);
+  last = timespec_real();
+  while (!terminated) {
+    errno = 0;
+    if (generation != atomic_load(&luageneration)) {
+      generation = atomic_load(&luageneration);
+      FreeAssetFiles();
+      CloneThreadWorkerLua(arg);
+    } else if (timespec_cmp(timespec_sub((t = timespec_real()), last),
+                            heartbeatinterval) >= 0) {
+      last = t;
+      HandleThreadWorkerHeartbeat();
+    } else {
+      HandleThreadWorkerPoll();
+    }
+  }
+  while (parked.n) {
+    CloseConnection(parked.n - 1, DescribeClose());
+  }
+#ifndef STATIC
+  if (GL) {
+    if (hasonworkerstop) {
+      CallSimpleHook("OnWorkerStop");
+    }
+    lua_close(GL);
+  }
+#endif
+  LockDec(&shared->workers);
+  FreeAssetFiles();
+  CollectGarbage();
+  Free(&parked.p), parked.n = parked.c = 0;
+  Free(&freelist.p), freelist.n = freelist.c = 0;
+  Free(&unmaplist.p), unmaplist.n = unmaplist.c = 0;
+  Free(&inbuf_actual.p), inbuf_actual.n = inbuf_actual.c = 0;
+  Free(&hdrbuf.p), hdrbuf.n = hdrbuf.c = 0;
+  Free(&cpm.outbuf);
+  Free(&polls);
+  return 0;
+}
+
+static void SpawnThreadWorkers(void) {
+  int i, rc;
+  sigset_t mask, old;
+  pthread_attr_t attr;
+  threadworkers = xcalloc(threads, sizeof(*threadworkers));
+  // signals are left for the main thread, which runs the event loop
+  sigfillset(&mask);
+  pthread_sigmask(SIG_BLOCK, &mask, &old);
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, 1024 * 1024);
+  for (i = 0; i < threads; ++i) {
+    if ((rc = pthread_create(threadworkers + i, &attr, ThreadWorker, GL))) {
+      DIEF("(srvr) can't create thread worker: %s", strerror(rc));
+    }
+  }
+  pthread_attr_destroy(&attr);
+  pthread_sigmask(SIG_SETMASK, &old, 0);
+  INFOF("(srvr) serving with %d threads", threads);
+}
+
+static void JoinThreadWorkers(void) {
+  int i;
+  if (!threadworkers)
+    return;
+  for (i = 0; i < threads; ++i) {
+    pthread_join(threadworkers[i], 0);
+  }
+  Free(&threadworkers);
+}
+
 static void HandleShutdown(void) {
+  JoinThreadWorkers();
   CloseServerFds();
   INFOF("(srvr) received %s", strsignal(shutdownsig));
   if (shutdownsig != SIGINT && shutdownsig != SIGQUIT) {
@@ -7096,19 +8967,24 @@ int EventLoop(int ms) {
       ReapZombies();
       lua_repl_unlock();
     } else if (invalidated) {
+      LockThreadWorkers();
       lua_repl_lock();
       HandleReload();
       lua_repl_unlock();
+      UnlockThreadWorkers();
     } else if (meltdown) {
       lua_repl_lock();
       EnterMeltdownMode();
       lua_repl_unlock();
       meltdown = false;
+    } else if (NeedsPreforkWorker()) {
+      if (SpawnPreforkWorker() == -1)
+        break;
     } else if (timespec_cmp(timespec_sub((t = timespec_real()), lastheartbeat),
                             heartbeatinterval) >= 0) {
       lastheartbeat = t;
       HandleHeartbeat();
-    } else if (HandlePoll(ms) == -1) {
+    } else if (HandlePoll(GetPollTimeout(ms)) == -1) {
       break;
     }
   }
@@ -7189,7 +9065,9 @@ static void TlsInit(void) {
 
   LoadCertificates();
   mbedtls_ssl_conf_sni(&conf, TlsRoute, 0);
+  mbedtls_ssl_conf_session_cache(&conf, 0, TlsGetSession, TlsSetSession);
   mbedtls_ssl_conf_dbg(&conf, TlsDebug, 0);
+  mbedtls_ssl_conf_export_keys_cb(&conf, ExportKernelTlsKeys, &ktls);
   mbedtls_ssl_conf_dbg(&confcli, TlsDebug, 0);
   mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &rng);
   mbedtls_ssl_conf_rng(&confcli, mbedtls_ctr_drbg_random, &rngcli);
@@ -7270,6 +9148,8 @@ static void GetOpts(int argc, char *argv[]) {
         CASE('t', ProgramTimeout(ParseInt(optarg)));
         CASE('h', PrintUsage(1, EXIT_SUCCESS));
         CASE('M', ProgramMaxPayloadSize(ParseInt(optarg)));
+        CASE('N', ProgramPrefork(ParseInt(optarg)));
+        CASE('Y', ProgramThreads(ParseInt(optarg)));
 #if !IsTiny()
       case 'f':
         funtrace = true;
@@ -7371,6 +9251,20 @@ void RedBean(int argc, char *argv[]) {
 #endif
   LuaInit();
   oldloglevel = __log_level;
+  if (preforks && (uniprocess || IsWindows())) {
+    WARNF("(cfg) prefork isn't available in uniprocess mode or on windows");
+    preforks = 0;
+  }
+  if (threads && (uniprocess || preforks)) {
+    WARNF("(cfg) threads can't be combined with prefork or uniprocess mode");
+    threads = 0;
+  }
+  InitGzipCache();
+  InitPageCache();
+  if (threads && !unsecure) {
+    WARNF("(cfg) thread workers disable ssl, including https in Fetch()");
+    unsecure = true;
+  }
   if (uniprocess) {
     shared->workers = 1;
   }
@@ -7403,6 +9297,9 @@ void RedBean(int argc, char *argv[]) {
   inbuf = inbuf_actual;
   isinitialized = true;
   CallSimpleHookIfDefined("OnServerStart");
+  if (threads) {
+    SpawnThreadWorkers();
+  }
 #ifdef STATIC
   EventLoop(timespec_tomillis(heartbeatinterval));
 #else